@@ -0,0 +1,56 @@
+#ifndef ADDRESSLAYOUT_H
+#define ADDRESSLAYOUT_H
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defines */
+#define ADDRESS_BITS 20 // Bits of a main memory word address
+
+/* Types */
+// Address_Layout - The split of a word address into the word of its block, the set of a cache and the tag above them.
+// The memory and the bus use the layout of a single set, the block of the address is then everything above the offset.
+typedef struct {
+    uint32_t block_words; // Words per block, a power of 2
+    uint32_t offset_bits; // Bits of the word in the block
+    uint32_t offset_mask;
+    uint32_t set_bits;    // Bits of the set index
+    uint32_t set_mask;
+    uint32_t tag_shift;   // Position of the tag, offset_bits + set_bits
+    uint32_t tag_bits;    // Bits of the tag, the rest of the address
+    uint32_t tag_mask;
+} Address_Layout;
+
+/* Functions Prototypes */
+// Compute the layout of blocks of block_words words grouped in num_sets sets, both powers of 2.
+// Returns false if they aren't, or if they don't fit in an address.
+bool AddressLayout_Init(Address_Layout* layout, uint32_t block_words, uint32_t num_sets);
+
+// Check if a value is a power of 2
+bool AddressLayout_IsPowerOf2(uint32_t value);
+
+/* Inline Functions */
+static inline uint32_t Address_Offset(const Address_Layout* layout, uint32_t address) {
+    return address & layout->offset_mask;
+}
+
+static inline uint32_t Address_Set(const Address_Layout* layout, uint32_t address) {
+    return (address >> layout->offset_bits) & layout->set_mask;
+}
+
+static inline uint32_t Address_Tag(const Address_Layout* layout, uint32_t address) {
+    return (address >> layout->tag_shift) & layout->tag_mask;
+}
+
+// Address of the first word of the block with the given tag and set
+static inline uint32_t Address_Block(const Address_Layout* layout, uint32_t tag, uint32_t set) {
+    return (tag << layout->tag_shift) | (set << layout->offset_bits);
+}
+
+// Address of a word of the block that holds the address
+static inline uint32_t Address_Word(const Address_Layout* layout, uint32_t address, uint32_t offset) {
+    return (address & ~layout->offset_mask) | (offset & layout->offset_mask);
+}
+
+#endif // ADDRESSLAYOUT_H
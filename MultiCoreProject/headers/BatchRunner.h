@@ -0,0 +1,14 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+/* Includes */
+#include "./SimConfig.h"
+
+/* Functions Prototypes */
+// Run every workload of the batch list on a pool of config->jobs threads, returns the number of failed workloads.
+// Each line of the list is a directory with the default file names, optionally followed by options that
+// override the ones given on the command line. Empty lines and lines starting with '#' are skipped.
+// A line longer than 1023 characters is reported and skipped, and counts as a failed workload.
+int BatchRunner_Run(const SimConfig* config);
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,61 @@
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include "./sim.h"
+#include "./OpcodeHandlers.h"
+
+/* Types */
+// Block_Op_Kind - The operation of a translated instruction, a single case of the block executor
+typedef enum {
+    BLOCK_OP_ADD,
+    BLOCK_OP_SUB,
+    BLOCK_OP_AND,
+    BLOCK_OP_OR,
+    BLOCK_OP_XOR,
+    BLOCK_OP_MUL,
+    BLOCK_OP_SLL,
+    BLOCK_OP_SRA,
+    BLOCK_OP_SRL,
+    BLOCK_OP_BEQ,
+    BLOCK_OP_BNE,
+    BLOCK_OP_BLT,
+    BLOCK_OP_BGT,
+    BLOCK_OP_BLE,
+    BLOCK_OP_BGE,
+    BLOCK_OP_JAL,
+    BLOCK_OP_LW,
+    BLOCK_OP_SW,
+    BLOCK_OP_HALT,
+    BLOCK_OP_NOP        // Unassigned opcode, changes nothing
+} Block_Op_Kind;
+
+// Block_Op - A translated instruction: its operation and operands, without a handler or parameter block
+typedef struct {
+    uint8_t kind;   // Block_Op_Kind
+    uint8_t rd;
+    uint8_t rs;
+    uint8_t rt;
+    uint8_t wb_reg; // Register that receives rd of a branch, PC_REG for JAL
+    uint32_t imm;   // Value of the immediate register during the instruction
+} Block_Op;
+
+// Block_Cache - The basic blocks of an instruction memory, translated on their first execution.
+// A block runs from its start to the first branch, JAL or HALT, plus the delay slot of a branch,
+// and never crosses the end of the instruction memory. Blocks starting inside a block share its ops.
+typedef struct {
+    const Decoded_Instruction* decoded;            // Instruction memory decoded at load
+    Block_Op ops[INSTRUCTIONMEMORYSIZE];           // Translated instruction of every address
+    uint16_t block_length[INSTRUCTIONMEMORYSIZE];  // Number of instructions of the block starting at the address (0 - not translated)
+} Block_Cache;
+
+/* Functions Prototypes */
+// Start with no block translated
+void BlockCache_Init(Block_Cache* cache, const Decoded_Instruction* decoded);
+
+// Get the ops of the block starting at pc, translating it on a miss. The length of the block is returned in length
+const Block_Op* BlockCache_Lookup(Block_Cache* cache, uint32_t pc, uint32_t* length);
+
+#endif // BLOCKCACHE_H
@@ -0,0 +1,88 @@
+#ifndef BUSARBITER_H
+#define BUSARBITER_H
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "./sim.h"
+
+/* Defines */
+#define MAX_BUS_WEIGHT 16                  // Grants of the heaviest core for each grant of a core of weight 1
+#define BUS_ARBITER_STRIDE 720720          // Pass of a grant of weight 1, divisible by every weight up to MAX_BUS_WEIGHT
+#define BUS_ARBITER_NO_REQUEST UINT32_MAX  // A core with an empty queue, and the pick when every queue is empty
+#define BUS_WAIT_BUCKETS 12                // 0, 1, 2-3, 4-7, ..., 512-1023 and 1024 or more cycles
+
+/* Types */
+// Bus_Arbiter_Policy - The core whose queue sends the next transaction on the bus
+typedef enum {
+    BUS_ARBITER_AGE,         // The oldest transaction, the lower core first on a tie (the arrival order of a single queue)
+    BUS_ARBITER_ROUND_ROBIN, // The next core with a transaction after the last one granted (the arbitration of the specification)
+    BUS_ARBITER_FIXED,       // The lowest core with a transaction
+    BUS_ARBITER_WEIGHTED     // The core furthest behind its share of the grants, the shares follow the weights
+} Bus_Arbiter_Policy;
+
+// Bus_Arbiter_Config - Policy of the arbiter and the weights of the cores
+typedef struct {
+    Bus_Arbiter_Policy policy;
+    uint32_t weights[MAX_NUM_OF_CORES]; // Weighted policy, 1 to MAX_BUS_WEIGHT
+} Bus_Arbiter_Config;
+
+// Bus_Arbiter_Core - The request of a core and its grants
+typedef struct {
+    uint32_t head_cycle;      // Bus cycle in which the first transaction of its queue was queued (BUS_ARBITER_NO_REQUEST - empty)
+    uint64_t pass;            // Weighted policy, the virtual time of its next grant
+    uint32_t stride;          // Advance of the pass on each grant, the lower the weight the longer
+    uint32_t grants;          // Transactions that won the bus
+    uint64_t wait_cycles;     // Cycles they waited in the queue
+    uint32_t max_wait;
+    uint32_t wait_histogram[BUS_WAIT_BUCKETS];
+} Bus_Arbiter_Core;
+
+// Bus_Arbiter - Picks among the queues of the cores the one whose transaction goes next
+typedef struct {
+    Bus_Arbiter_Policy policy;
+    Bus_Arbiter_Core* cores;
+    uint32_t num_cores;
+    uint32_t last_core;       // Core of the last grant, round robin looks at the next one first
+    uint64_t virtual_time;    // Weighted policy, the pass of the last grant, a core that starts to request joins at it
+} Bus_Arbiter;
+
+/* Functions Prototypes */
+// Fill the configuration with the age policy and a weight of 1 for every core. The specification arbitrates round
+// robin, age is the default to keep the reference outputs, which were produced with a single queue.
+void BusArbiter_DefaultConfig(Bus_Arbiter_Config* config);
+
+// Parse a policy name (age, rr, fixed, weighted), returns false if it is unknown
+bool BusArbiter_ParsePolicy(const char* name, Bus_Arbiter_Policy* policy);
+
+// Parse the comma separated weights of the cores from core 0 (1 to MAX_BUS_WEIGHT), the cores after the list keep
+// their weight. Returns false if the list is invalid.
+bool BusArbiter_ParseWeights(const char* list, Bus_Arbiter_Config* config);
+
+// Start with empty queues for num_cores cores
+bool BusArbiter_Init(Bus_Arbiter* arbiter, const Bus_Arbiter_Config* config, uint32_t num_cores);
+
+// Release the state of the cores
+void BusArbiter_Free(Bus_Arbiter* arbiter);
+
+// The queue of the core was empty and got a transaction in the cycle
+void BusArbiter_Request(Bus_Arbiter* arbiter, uint32_t core, uint32_t cycle);
+
+// The core whose transaction goes next, BUS_ARBITER_NO_REQUEST if every queue is empty. Nothing changes until the grant.
+uint32_t BusArbiter_Pick(const Bus_Arbiter* arbiter);
+
+// The first transaction of the queue of the core left it in the cycle, next_head_cycle is the cycle in which the next one
+// was queued (BUS_ARBITER_NO_REQUEST - none). A transaction counts as a grant, a delay packet only moves the queue.
+void BusArbiter_Grant(Bus_Arbiter* arbiter, uint32_t core, uint32_t cycle, uint32_t next_head_cycle, bool is_transaction);
+
+// Number of transactions of the core that won the bus
+uint32_t BusArbiter_Grants(const Bus_Arbiter* arbiter, uint32_t core);
+
+// Number of cycles the transactions of the core waited in its queue
+uint64_t BusArbiter_WaitCycles(const Bus_Arbiter* arbiter, uint32_t core);
+
+// Print the longest wait of the core and the histogram of the waits of its transactions
+void BusArbiter_PrintWaits(const Bus_Arbiter* arbiter, uint32_t core, FILE* file);
+
+#endif // BUSARBITER_H
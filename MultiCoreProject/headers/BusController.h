@@ -5,17 +5,20 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include "./TraceWriter.h"
+#include "./AddressLayout.h"
+#include "./Directory.h"
+#include "./BusArbiter.h"
 
 // relevant structs and enums
 /*************************************************************************************/
 // Bus originator - Enumerates the entities that can initiate a bus transaction
+// The cores are numbered 0 .. (number of cores - 1)
 typedef enum
 {
 	core0,
-	core1,
-	core2,
-	core3,
-	main_memory,
+	main_memory = 0xFFFE, // printed to the bus trace as the number of cores
 	invalid_caller = 0xFFFF
 } Bus_transaction_caller;
 
@@ -38,6 +41,7 @@ typedef struct
 	uint32_t bus_addr;
 	uint32_t bus_data;
 	bool bus_shared;
+	bool cache_to_cache; // a dirty block passed from its owner to the requester (MOESI), the memory isn't written
 } bus_transaction;
 
 // Bus_core_cache - Represents the cache interface of a core
@@ -47,6 +51,42 @@ typedef struct
 	void* bus_cache_data;
 } Bus_core_cache;
 
+// state_of_transaction - Enumerates the states of a bus transaction
+typedef enum
+{
+	idle,
+	wait_cmd,
+	operation,
+	finally,
+} state_of_transaction;
+
+// A miss queues at most two transactions at once: the flush of its victim and its read, or a busRdX and its delay.
+// The cache submits nothing else until they are done.
+#define BUS_ENTRIES_PER_MISS 2
+
+// bus_submission_slot - Holds the transactions a core submitted during the current cycle,
+// and after it while the bus queue has no room for them.
+// Each slot has a single writer (its core) and is read by the bus only after the cores
+// finished the cycle, so no lock is needed even when the cores run on different threads.
+// A core submits only while it has no transaction pending, so the slot holds at most the entries of one miss.
+#define SUBMISSION_SLOT_SIZE BUS_ENTRIES_PER_MISS
+typedef struct
+{
+	bus_transaction items[SUBMISSION_SLOT_SIZE];
+	uint32_t count;
+} bus_submission_slot;
+
+#define MAX_BUS_QUEUE_SIZE 4096
+
+// queue_for_bus - Represents the queue of the bus transactions of a core, the entries are taken from a pool
+typedef struct _queue_for_bus
+{
+	bus_transaction item;
+	uint32_t queued_iteration; // bus iteration that queued the transaction
+	struct _queue_for_bus* prev;
+	struct _queue_for_bus* next;
+} queue_for_bus;
+
 /*************************************************************************************/
 
 
@@ -54,28 +94,137 @@ typedef struct
 typedef bool (*SharedData_Callback)(void* bus_cache_data, bus_transaction* packet, bool* is_modified);
 typedef bool (*SnoopingCache_Callback)(void* bus_cache_data, bus_transaction* packet, uint8_t address_offset);
 typedef bool (*GetCacheResponse_Callback)(void* bus_cache_data, bus_transaction* packet, uint8_t* address_offset);
-typedef bool (*Mem_Callback)(bus_transaction* packet, bool direct_transaction);
+typedef bool (*Mem_Callback)(void* memory, bus_transaction* packet, bool direct_transaction, uint32_t cycle);
+typedef uint32_t (*MemLatency_Callback)(void* memory);
+typedef void (*MemSkip_Callback)(void* memory, uint32_t cycles);
+typedef bool (*Prefetch_Callback)(void* bus_cache_data);
+typedef bool (*MemRequest_Callback)(void* memory, const bus_transaction* packet, uint32_t cycle);
+typedef bool (*MemResponse_Callback)(void* memory, uint32_t cycle, bus_transaction* packet);
+typedef uint32_t (*MemNextResponse_Callback)(void* memory, uint32_t cycle);
+
+
+#define NO_READ_IN_FLIGHT UINT32_MAX // a core without a read in the memory of the split bus
+
+// Bus_Controller - The state of a bus and the interfaces of the caches and the memory on it
+typedef struct
+{
+	uint32_t num_of_cores;
+	Address_Layout layout; // words of a block, a transaction moves one word per cycle
+	Bus_core_cache* core_cache;
+	Trace_Stream* trace;
+
+	// callbacks functions
+	SharedData_Callback shared_data_callback;
+	SnoopingCache_Callback snooping_cache_callback;
+	GetCacheResponse_Callback get_cache_response_callback;
+	Prefetch_Callback prefetch_callback; // NULL when the caches don't prefetch
+	uint32_t prefetch_next; // core asked first for a prefetch on the next free bus cycle
+	void* memory;
+	Mem_Callback mem_callback;
+	MemLatency_Callback mem_latency_callback;
+	MemSkip_Callback mem_skip_callback;
+	MemRequest_Callback mem_request_callback; // the split bus queues a read in the memory
+	MemResponse_Callback mem_response_callback; // and takes it back when its block is ready
+	MemNextResponse_Callback mem_next_response_callback;
+	Directory* directory; // Caches that hold each block, NULL when the bus broadcasts the queries and the snoops to every cache
+	bool directory_coherence; // Only the caches that hold the block answer the shared query (otherwise the directory is a snoop filter)
+
+	// transaction state
+	bool is_transaction_active;
+	bool is_first_access_shared; // first time a shared line is detected for the current transaction
+	state_of_transaction* transaction_state_per_core;
+	uint32_t* queued_per_core; // transactions of each core in the queue, a core with one left waits after its transaction is done
+	bus_transaction ongoing_transaction;
+	uint8_t addr_offset;
+	uint32_t iteration_count;
+
+	// split transactions: a read the memory serves frees the bus after its request, the block is sent when it is ready
+	bool split_transactions;
+	bool is_response; // the ongoing transaction sends the block of a read to its originator
+	uint32_t* read_in_flight; // per core, the block of its read in the memory (NO_READ_IN_FLIGHT - none)
+	bool* is_delay_after_read; // per core, the delay packet of its busRdX waits for the block, the write uses the delay
+	bool is_block_sent; // the last iteration sent the last word of a read, its core may need the next one to use it
+
+	// result of the shared query of the current transaction, valid while the directory version is the same
+	bool is_shared_result_valid;
+	int32_t shared_result_version;
+	bool shared_result;
+	bool modified_result;
+
+	// snoop statistics: a round of queries or snoops would call every cache, only some of them are called
+	uint32_t snoop_rounds;
+	uint32_t* snoop_calls; // per core
+
+	// per-core submission slots, drained into the queues when there is room for all the transactions of a slot
+	bus_submission_slot* submission_slots;
+	bool* is_submission_blocked; // per core, its slot waits for room in the queues
+	uint32_t drain_first; // core whose slot is drained first, the first one that waited for room
+
+	// per-core fifo queues, the arbiter picks the core whose oldest transaction goes next and keeps the waiting statistics
+	queue_for_bus** head_of_queue; // newest transaction of each core
+	queue_for_bus** tail_of_queue; // oldest transaction of each core
+	uint32_t queued_transactions; // in all the queues, the delay packets included
+	uint32_t queue_capacity; // entries of the pool, shared by the queues of the cores
+	queue_for_bus* queue_pool;
+	queue_for_bus* free_entries; // unused entries of the pool, linked by next
+	Bus_Arbiter arbiter;
+} Bus_Controller;
 
 
 // bus implementation functions
-void Bus_InitializeCache(Bus_core_cache cache_interface);
-void ConfigureCacheCallbacks_for_bus(SharedData_Callback signal_callback, 
+bool Bus_Init(Bus_Controller* bus, uint32_t num_of_cores, uint32_t block_words, const Bus_Arbiter_Config* arbiter_config,
+			  uint32_t queue_capacity, Trace_Stream* trace);
+void Bus_Shutdown(Bus_Controller* bus);
+void Bus_InitializeCache(Bus_Controller* bus, Bus_core_cache cache_interface);
+void ConfigureCacheCallbacks_for_bus(Bus_Controller* bus,
+								SharedData_Callback signal_callback, 
 								SnoopingCache_Callback snooping_callback, 
 								GetCacheResponse_Callback response_callback);
-void ConfigureMemoryCallback_for_bus(Mem_Callback callback);
+void ConfigurePrefetchCallback_for_bus(Bus_Controller* bus, Prefetch_Callback callback);
+void ConfigureMemoryCallback_for_bus(Bus_Controller* bus, void* memory, Mem_Callback callback);
+void ConfigureMemoryTimingCallbacks_for_bus(Bus_Controller* bus, MemLatency_Callback latency_callback, MemSkip_Callback skip_callback);
+void ConfigureDirectory_for_bus(Bus_Controller* bus, Directory* directory, bool directory_coherence);
+void ConfigureSplitMemoryCallbacks_for_bus(Bus_Controller* bus, MemRequest_Callback request_callback,
+								MemResponse_Callback response_callback, MemNextResponse_Callback next_response_callback);
+void ConfigureSplitTransactions_for_bus(Bus_Controller* bus, bool split_transactions);
 
 
 // Create a new transaction on the bus
-void AddTransaction_to_bus(bus_transaction packet);
+void AddTransaction_to_bus(Bus_Controller* bus, bus_transaction packet);
 
 // Check if the bus is in transaction
-bool IsBusInTransaction(Bus_transaction_caller originator);
+bool IsBusInTransaction(Bus_Controller* bus, Bus_transaction_caller originator);
 
 // Check if the bus is waiting for transaction
-bool IsBusWaitForTransaction(Bus_transaction_caller originator);
+bool IsBusWaitForTransaction(Bus_Controller* bus, Bus_transaction_caller originator);
+
+// Check if the transaction of the originator is queued or on the bus (not yet finished)
+bool IsBusTransactionPending(Bus_Controller* bus, Bus_transaction_caller originator);
+
+// Check if the transactions of the originator wait for room in the bus queue
+bool IsBusQueueFull(Bus_Controller* bus, Bus_transaction_caller originator);
+
+// Check if the bus has no transaction queued, submitted or running
+bool Bus_IsIdle(Bus_Controller* bus);
 
 // Iterate the bus
-void Run_Bus_Iteration(void);
+void Run_Bus_Iteration(Bus_Controller* bus);
 
-#endif // BUSCONTROLLER_H
+// Number of coming bus iterations that only count the memory latency (0 if something may happen)
+uint32_t Bus_CyclesToNextEvent(Bus_Controller* bus);
 
+// Advance the bus and the memory over iterations that only count the memory latency
+void Bus_FastForward(Bus_Controller* bus, uint32_t cycles);
+
+// Number of shared queries and snoops that reached the cache of the core, and that the directory spared it
+uint32_t Bus_SnoopsReceived(Bus_Controller* bus, uint32_t core);
+uint32_t Bus_SnoopsFiltered(Bus_Controller* bus, uint32_t core);
+
+// Number of transactions of the core that the arbiter granted, and the bus iterations they waited in its queue
+uint32_t Bus_TransactionsStarted(Bus_Controller* bus, uint32_t core);
+uint64_t Bus_QueueCycles(Bus_Controller* bus, uint32_t core);
+
+// Print the longest wait of the transactions of the core in its queue and the histogram of their waits
+void Bus_PrintQueueWaits(Bus_Controller* bus, uint32_t core, FILE* file);
+
+#endif // BUSCONTROLLER_H
@@ -6,35 +6,63 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include "./BusController.h"
+#include "./ReplacementPolicy.h"
+#include "./AddressLayout.h"
+#include "./Prefetcher.h"
 
 /* Defines */
-#define CACHE_SIZE 256 // 256 words
-#define BLOCK_SIZE 4  // 4 words
-#define NUM_BLOCKS (CACHE_SIZE / BLOCK_SIZE) // 64 blocks as 256/4 = 64
+#define DEFAULT_CACHE_SIZE 256 // 256 words
+#define DEFAULT_BLOCK_SIZE 4  // 4 words, 256/4 = 64 lines
+#define MIN_CACHE_SIZE 64 // Words, the cache size is a power of 2 in this range
+#define MAX_CACHE_SIZE 65536
+#define MIN_BLOCK_SIZE 1 // Words, the block size is a power of 2 in this range
+#define MAX_BLOCK_SIZE 32
+#define MAX_CACHE_WAYS 64 // The PLRU tree of a set is a 64 bit word
+#define MAX_VICTIM_LINES 16 // Lines of the victim buffer, 0 turns it off
+#define CACHE_NO_LINE UINT32_MAX // No line of the set holds the block
 
 /* Types & Consts*/
 typedef enum {
-    // MESI protocol states
+    // MESI protocol states, MOESI adds the Owned state
     MESI_STATE_INVALID,
     MESI_STATE_SHARED,
     MESI_STATE_EXCLUSIVE,
     MESI_STATE_MODIFIED,
+    MESI_STATE_OWNED, // Dirty and shared, the owner supplies the block and writes it back on eviction
 
     number_of_states //TODO: check if this is needed
     }MESIState;
 
 typedef enum {
-    // Cache IDs for each core among the 4 cores
-    CACHE_ID_CORE0,
-    CACHE_ID_CORE1,
-    CACHE_ID_CORE2,
-    CACHE_ID_CORE3
+    // Coherence protocols of the data caches
+    COHERENCE_MESI,  // A Modified block read by another cache is written back to the memory
+    COHERENCE_MOESI  // It becomes Owned and is passed cache to cache, the memory is written on eviction
+} Coherence_Protocol;
+
+typedef enum {
+    // Cache IDs match the core IDs, 0 .. (number of cores - 1)
+    CACHE_ID_CORE0
 }Cache_Id_enum;
 
+// Cache_Config - The organization of the data caches
+typedef struct {
+    uint32_t size_words;           // Data words of a cache, a power of 2
+    uint32_t block_words;          // Words per line, a power of 2, also the burst of a bus transaction
+    uint32_t ways;                 // Lines per set, a power of 2 up to the number of lines (1 - direct mapped)
+    Replacement_Policy_Id policy;  // Chooses the way to evict when every way of the set is valid
+    uint32_t victim_lines;         // Lines of the fully associative victim buffer (0 - none)
+    uint32_t prefetch_distance;    // Accesses ahead of a stride the prefetcher fetches (0 - no prefetching)
+    Coherence_Protocol protocol;   // MESI (default) or MOESI
+} Cache_Config;
+
+// TSRAM - The tag and the MESI state of every line, line = set * ways + way.
+// The tags and the states are separate arrays, so the ways of a set are compared in a single pass.
+// The lines of the victim buffer follow the lines of the sets, their tag is the whole block number
+// (the address above the offset). The last one holds a block the buffer evicted until its flush ends.
 typedef struct {
-    uint16_t tag : 12;   // 12 bits for the tag
-    uint8_t mesi : 2;    // 2 bits for MESI state
-} TSRAMLine;
+    uint32_t* tag;
+    uint8_t* mesi;
+} TSRAM;
 
 typedef struct {
     uint32_t data;
@@ -46,24 +74,56 @@ typedef struct {
     uint32_t read_misses;
     uint32_t write_hits;
     uint32_t write_misses;
+    uint32_t victim_hits; // Misses served by the victim buffer
 } tracking_info;
 
 typedef struct {
-    Cache_Id_enum id; // Cache ID: 0-3
-    TSRAMLine tsram[NUM_BLOCKS]; // Tag and state SRAM
-    DRAMLine dram[CACHE_SIZE]; // Data SRAM
+    Cache_Id_enum id; // Cache ID, same as the core ID
+    Bus_Controller* bus; // The bus the cache snoops and sends its transactions to
+    TSRAM tsram; // Tag and state SRAM
+    DRAMLine* dram; // Data SRAM, the block of a line starts at line * block_words
     tracking_info tracking_info; // Cache performance tracking
     bool isStalled; // Flag to indicate if the cache is stalled
+    bool miss_occurred_read; // Distinct between read hit to hit after miss that doesn't count as read hit
+    bool miss_occurred_write; // Distinct between write hit to hit after miss that doesn't count as write hit
+    Address_Layout layout; // Offset, set and tag fields of the addresses
+    uint32_t size_words; // Words of the data SRAM
+    uint32_t num_lines; // Lines of the TSRAM
+    uint32_t ways; // Lines per set
+    uint32_t victim_lines; // Lines of the victim buffer, from line num_lines on
+    uint32_t victim_next; // Next line of the victim buffer to evict when every line is valid (FIFO)
+    uint32_t fill_line; // Line the pending busRd or busRdX fills, the victim of the miss or the upgraded line
+    Coherence_Protocol protocol; // Coherence protocol of the caches
+    cmd_on_the_bus fill_cmd; // busRd or busRdX of the pending fill
+    bool owned_upgrade; // The pending busRdX upgrades an Owned line, which keeps its data while it stays Owned
+    const Replacement_Policy* replacement; // Replacement policy of the sets
+    uint8_t* replacement_state; // Per line state of the policy
+    uint64_t* replacement_tree; // Per set state of the policy
+    uint32_t replacement_random; // Random generator of the policy
+    Prefetcher prefetcher; // Stride prefetcher, trained by the loads and stores
+    uint8_t* prefetched; // Per line: filled by a prefetch and not accessed yet
+    bool prefetch_in_flight; // The transaction of the cache on the bus is a prefetch
+    bool prefetch_late; // An access waited for the prefetch in flight
+    uint32_t prefetch_address; // Block of the prefetch in flight
+    uint8_t* dirty_lines; // Per set, its Modified and Owned lines, kept for the snoop filter of the bus
 } Cache_Data;
 
 
 
 /* Functions Prototypes */
-void CacheController_Init(Cache_Data *cache_data, Cache_Id_enum id);
-void Cache_InitializeBusCallbacks(void);
+void Cache_DefaultConfig(Cache_Config* config);
+bool Cache_CheckConfig(const Cache_Config* config); // Print the error and return false if the organization isn't supported
+bool Cache_ParseProtocol(const char* name, Coherence_Protocol* protocol); // "mesi" or "moesi"
+bool CacheController_Init(Cache_Data *cache_data, Cache_Id_enum id, Bus_Controller* bus, const Cache_Config* config);
+void CacheController_Free(Cache_Data* cache_data);
+void Cache_InitializeBusCallbacks(Bus_Controller* bus);
 void print_Cache_Data(Cache_Data* cache_data, FILE* file_dram, FILE* file_tsram);
-bool Write_Data_to_Cache(Cache_Data* cache_data, uint32_t address, uint32_t data);
-bool Read_Data_from_Cache(Cache_Data* cache_data, uint32_t address, uint32_t* data);
+bool Write_Data_to_Cache(Cache_Data* cache_data, uint16_t pc, uint32_t address, uint32_t data);
+bool Read_Data_from_Cache(Cache_Data* cache_data, uint16_t pc, uint32_t address, uint32_t* data);
+bool Cache_IsWaitingForBus(Cache_Data* cache_data);
+bool Cache_IsWaitingForBusQueue(Cache_Data* cache_data); // The transactions of the cache wait for room in the bus queue
+void Cache_StopPrefetching(Cache_Data* cache_data); // The core halted, the predicted blocks are dropped
+uint32_t Cache_FunctionalAccess(Cache_Data* cache_data, uint32_t address, bool is_write, uint32_t data);
 
 
 #endif // CACHECONTROLLER_H_
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef COREWORKERS_H
+#define COREWORKERS_H
+
+/* Includes */
+#include <stdbool.h>
+#include "./ProcessorCore.h"
+#include "./SimThreads.h"
+
+/* Types */
+struct _Core_Workers;
+
+typedef struct {
+    struct _Core_Workers* owner; // The workers group of the thread
+    int worker_id;               // Steps the cores worker_id, worker_id + num_workers, ...
+} Core_Worker;
+
+typedef struct _Core_Workers {
+    ProcessorCore* cores;
+    int num_cores;
+    int num_workers;
+    Core_Worker* workers;
+    SimThread* threads;
+    SimBarrier cycle_start;
+    SimBarrier cycle_end;
+    SimAtomic stop_workers;
+} Core_Workers;
+
+/* Functions Prototypes */
+// Start the worker threads, core i is stepped by thread (i % num_threads), the calling thread is thread 0.
+// The threads are limited to the number of cores and of host processors.
+bool CoreWorkers_Start(Core_Workers* group, ProcessorCore* cores, int num_cores, int num_threads);
+
+// Run a single cycle of every core and wait for all of them (the per-cycle barrier)
+void CoreWorkers_RunCycle(Core_Workers* group);
+
+// Stop and join the worker threads
+void CoreWorkers_Stop(Core_Workers* group);
+
+#endif // COREWORKERS_H
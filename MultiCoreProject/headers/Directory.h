@@ -0,0 +1,64 @@
+#ifndef DIRECTORY_H
+#define DIRECTORY_H
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include "./AddressLayout.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* Defines */
+#define DIRECTORY_PAGE_BITS 10 // 1K blocks per page
+#define DIRECTORY_PAGE_SIZE (1 << DIRECTORY_PAGE_BITS)
+
+/* Types */
+// Directory - The caches that hold each block of the main memory, a bit per core (up to 64 cores).
+// On the snooping bus it is the snoop filter, which also needs the caches with a dirty line in each set.
+typedef struct {
+    uint64_t** pages;      // Sharer vectors of the blocks, a page is allocated when one of its blocks is first cached
+    uint32_t num_pages;
+    Address_Layout layout; // Blocks and sets of the caches
+    uint64_t* dirty_sets;  // Per set, the caches that have a Modified or Owned line in it
+    uint64_t all_cores;    // Every core of the machine
+    bool out_of_memory;    // A page couldn't be allocated, the blocks of missing pages are then held by every core
+    volatile int32_t version; // Incremented by every change of the vectors or of a cache line, the bus reuses its queries until then
+} Directory;
+
+/* Functions Prototypes */
+// Start with no cached block, for num_cores cores and caches of num_sets sets of blocks of block_words words (powers of 2)
+bool Directory_Init(Directory* directory, uint32_t num_cores, uint32_t block_words, uint32_t num_sets);
+
+// Release the pages
+void Directory_Free(Directory* directory);
+
+// Record that the cache of the core holds, or no longer holds, the block of the address
+void Directory_SetSharer(Directory* directory, uint32_t address, uint32_t core, bool is_sharer);
+
+// The caches that hold the block of the address
+uint64_t Directory_Sharers(const Directory* directory, uint32_t address);
+
+// Record that the cache of the core has, or no longer has, a dirty line in the set
+void Directory_SetDirtySet(Directory* directory, uint32_t set, uint32_t core, bool is_dirty);
+
+// The caches that have a dirty line in the set of the address
+uint64_t Directory_DirtyCaches(const Directory* directory, uint32_t address);
+
+// A line of a cache changed its block or its state
+void Directory_LineChanged(Directory* directory);
+
+/* Inline Functions */
+// Remove the lowest core from the sharers and return it, the sharers must not be 0
+static inline uint32_t Directory_TakeSharer(uint64_t* sharers) {
+#ifdef _MSC_VER
+    unsigned long core;
+    _BitScanForward64(&core, *sharers);
+#else
+    uint32_t core = (uint32_t)__builtin_ctzll(*sharers);
+#endif
+    *sharers &= *sharers - 1;
+    return (uint32_t)core;
+}
+
+#endif // DIRECTORY_H
@@ -0,0 +1,82 @@
+#ifndef DRAM_H
+#define DRAM_H
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Defines */
+#define MAX_DRAM_BANKS 64
+#define MAX_DRAM_ROW_WORDS 65536
+#define MAX_DRAM_LATENCY 1024
+#define DEFAULT_DRAM_ROW_WORDS 256          // 1KB rows
+#define DEFAULT_DRAM_ROW_HIT_LATENCY 8      // Column access of the open row
+#define DEFAULT_DRAM_ROW_MISS_LATENCY 16    // Activation of a row in a precharged bank, then the column access
+#define DEFAULT_DRAM_ROW_CONFLICT_LATENCY 24 // Precharge of the open row, then the activation and the column access
+
+/* Types */
+// Dram_Config - Organization and timing of the banked main memory
+typedef struct {
+    uint32_t banks;                // Number of banks, a power of 2 (0 - a single unit with a fixed latency)
+    uint32_t row_words;            // Words in a row of a bank, a power of 2 of at least a block
+    uint32_t row_hit_latency;      // Cycles until the first word of a block when its row is open
+    uint32_t row_miss_latency;     // When no row of the bank is open
+    uint32_t row_conflict_latency; // When another row of the bank is open
+} Dram_Config;
+
+// Dram_Bank - The row buffer of a bank and its counters
+typedef struct {
+    bool is_row_open;
+    uint32_t open_row;       // Row held in the row buffer
+    uint32_t busy_until;     // Cycle from which the bank can start the next access
+    uint32_t accesses;       // Reads and writes of blocks
+    uint32_t row_hits;
+    uint32_t row_misses;
+    uint32_t row_conflicts;
+    uint64_t busy_cycles;    // Cycles in which the bank served an access
+} Dram_Bank;
+
+// Dram - Banks of the main memory that serve blocks concurrently, each with an open row buffer, rows interleaved over the banks
+typedef struct {
+    Dram_Config config;
+    Dram_Bank* banks;        // NULL when the memory has a single unit
+    uint32_t column_bits;    // Bits of the word in a row, a row lies in a single bank
+    uint32_t bank_bits;
+    uint32_t bank_mask;
+    uint32_t row_shift;      // Position of the row, above the bank and the column
+} Dram;
+
+/* Functions Prototypes */
+// Fill the configuration with the single unit memory and the default timing of the banks
+void Dram_DefaultConfig(Dram_Config* config);
+
+// Parse the "hit,miss,conflict" latencies, returns false if the list is invalid
+bool Dram_ParseTiming(const char* timing, Dram_Config* config);
+
+// Check the organization for blocks of block_words words, printing the error if it is invalid
+bool Dram_CheckConfig(const Dram_Config* config, uint32_t block_words);
+
+// Start with every bank precharged and free, the configuration was checked by Dram_CheckConfig
+bool Dram_Init(Dram* dram, const Dram_Config* config);
+
+// Release the banks
+void Dram_Free(Dram* dram);
+
+// Bank of the address: the bits above the column, XORed with the groups of bank bits of the row
+uint32_t Dram_BankOf(const Dram* dram, uint32_t address);
+
+// Cycle from which the bank can start an access
+uint32_t Dram_FreeCycle(const Dram* dram, uint32_t bank);
+
+// Check if the row of the address is open in its bank
+bool Dram_IsRowOpen(const Dram* dram, uint32_t address);
+
+// Access the block of the address from the cycle, returns the cycle at which its first word is available.
+// The access waits for the bank to finish the previous one, then leaves the row of the block open.
+uint32_t Dram_Access(Dram* dram, uint32_t address, uint32_t cycle);
+
+// Print the accesses, the row buffer outcomes and the utilization of each bank over a run of the given cycles
+void Dram_PrintStats(const Dram* dram, FILE* file, uint32_t cycles);
+
+#endif // DRAM_H
@@ -3,14 +3,12 @@
 
 #include <stdio.h>
 #include "./sim.h" 
-
-extern FILE* MemIn;
-extern FILE* MemOut;
-extern FILE* BusTrace;
+#include "./MemImage.h"
+#include "./SimConfig.h"
 
 typedef struct
 {
-	FILE* instructionMemoryFile;  // File for instruction memory input
+	Mem_Image instructionMemory;  // Instruction memory image (text or binary)
 	FILE* registerOutputFile;     // File for register values output
 	FILE* executionTraceFile;     // File for execution trace
 	FILE* dataCacheFile;          // File for data cache content (DSRAM)
@@ -18,10 +16,22 @@ typedef struct
 	FILE* coreStatsFile;     // File for core statistics output
 } CoreFileHandles;
 
-extern CoreFileHandles coreFileHandlesArray[NUM_OF_CORES];
+typedef struct
+{
+	Mem_Image MemIn;              // Main memory input image (text or binary)
+	FILE* MemOut;                 // File for main memory output
+	FILE* BusTrace;               // File for bus trace
+	FILE* DramStats;              // File for the statistics of the memory banks (NULL - not requested)
+	CoreFileHandles* coreFileHandlesArray; // One entry per core
+	uint32_t numOfCores;          // Number of entries in coreFileHandlesArray
+} SimFiles;
 
 /* Global Functions*/
-int OpenRequiredFiles(char* argv[], int argc); // Open all required files
-void closeFiles(); // Close all files
+// Open all required files and load the memory images. Without file arguments the default names are opened in the
+// directory (NULL - working directory), preferring the binary images (imem0.bin, memin.bin) over the text ones.
+// The binary trace formats use the default names coreNtrace.bin and bustrace.bin.
+// The statistics of the memory banks are written to dramstats.txt in the directory.
+int OpenRequiredFiles(SimFiles* files, char* argv[], int argc, const SimConfig* config, const char* directory);
+void closeFiles(SimFiles* files); // Close all files
 
 #endif // FilesManager_H
@@ -0,0 +1,40 @@
+#ifndef FUNCTIONALSIM_H
+#define FUNCTIONALSIM_H
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include "./ProcessorCore.h"
+#include "./MainMemory.h"
+
+/* Types */
+// Functional_Core - Architectural state of a core that runs without the pipeline, the registers stay in the ProcessorCore
+typedef struct {
+    uint32_t pc;           // PC of the next instruction to execute
+    uint32_t next_pc;      // PC of the instruction after it, the target when the next instruction is in a branch delay slot
+    bool halted;           // The core executed HALT
+    uint64_t instructions; // Number of executed instructions
+    bool warm_caches;      // Loads and stores go through the data cache of the core instead of the main memory
+} Functional_Core;
+
+/* Functions Prototypes */
+// Start the core at its current PC with no branch pending
+void FunctionalCore_Init(Functional_Core* state, const ProcessorCore* core);
+
+// Resume from the current PC of the core, after the pipeline ran it, keeping the instruction count
+void FunctionalCore_Sync(Functional_Core* state, const ProcessorCore* core);
+
+// Execute until the next instruction is not in a branch delay slot, so the pipeline can start from the PC. Returns the number executed
+uint32_t FunctionalCore_LeaveDelaySlot(Functional_Core* state, ProcessorCore* core, Main_Memory* memory);
+
+// Execute up to max_instructions instructions of the core directly against the main memory, returns the number executed
+uint32_t FunctionalCore_Run(Functional_Core* state, ProcessorCore* core, Main_Memory* memory, uint32_t max_instructions);
+
+// Run the cores in turns of quantum instructions until each ran max_instructions or all halted. Returns the total number of instructions
+uint64_t FunctionalSim_RunTurns(Functional_Core* states, ProcessorCore* cores, uint32_t numOfCores, Main_Memory* memory,
+    uint32_t quantum, uint64_t max_instructions);
+
+// Run all the cores until they halt, switching core every quantum instructions. Returns the total number of instructions
+uint64_t FunctionalSim_Run(ProcessorCore* cores, uint32_t numOfCores, Main_Memory* memory, uint32_t quantum);
+
+#endif // FUNCTIONALSIM_H
@@ -2,22 +2,46 @@
 #define MAINMEMORY_H
 
 #include "./sim.h"
+#include "./BusController.h"
+#include "./MemImage.h"
+#include "./Dram.h"
+#include "./MemoryController.h"
 #include <stdio.h>
 #define MAIN_MEMORY_SIZE (1 << 20) // 2^20
+#define MAIN_MEMORY_PAGE_BITS 10 // 1K words per page
+#define MAIN_MEMORY_PAGE_SIZE (1 << MAIN_MEMORY_PAGE_BITS)
+#define MAIN_MEMORY_NUM_OF_PAGES (MAIN_MEMORY_SIZE / MAIN_MEMORY_PAGE_SIZE)
 
 
+#define MAIN_MEMORY_LATENCY 16 // Cycles until the first word of a block, then a word per cycle (without banks)
+
+// Memory_Read - A read of the split transaction bus, waiting in the memory for its block
 typedef struct {
-    // used to track the main memory performance
-    uint8_t offset : 2;  // 2 bits for index, 4 words per block
-    uint32_t block : 18;  // 18 bits left for block
-} AddressFields;
+    bus_transaction request; // The busRd or busRdX, its originator is the cache that takes the block
+    uint32_t readyCycle; // Bus cycle from which the block can be sent
+} Memory_Read;
 
-typedef union {
-    uint32_t address;       // Raw 20-bit address
-    AddressFields fields;   // Decomposed fields
-} MemoryAddress;
+typedef struct {
+    uint32_t* pages[MAIN_MEMORY_NUM_OF_PAGES]; // Pages of the main memory, allocated on the first non zero write
+    const uint32_t* image; // Initial contents, read in place for the pages that were not written (e.g. a mapped memin image)
+    uint32_t imageWords; // Number of words in the initial contents
+    uint32_t highestWritten; // One past the highest address that may hold a non zero value
+    uint32_t numOfCycles; // Number of cycles taken by the current transaction
+    uint32_t latency; // Cycles of the current transaction until its first word, then a word per cycle
+    uint32_t blockWords; // Words of the blocks of the bus
+    bool isMemoryBusy; // Flag to indicate if the memory is busy
+    Memory_Read* pendingReads; // Reads of the split transaction bus, oldest first (at most one per core)
+    uint32_t numOfPendingReads;
+    uint32_t maxPendingReads;
+    Dram dram; // Banks and row buffers that time the accesses (no banks - the fixed latency)
+    Memory_Controller controller; // Queue of the accesses of the banks and their scheduler
+} Main_Memory;
 
-void MainMemoryInit(); // Initialize the main memory
-void MainMemoryPrint(FILE* file); // Print the main memory contents
+bool MainMemoryInit(Main_Memory* memory, Bus_Controller* bus, const Mem_Image* memin, const Dram_Config* dram, const Mc_Config* controller); // Initialize the main memory, the image must outlive it
+void MainMemoryPrint(Main_Memory* memory, FILE* file); // Print the main memory contents
+void MainMemoryPrintStats(Main_Memory* memory, FILE* file, uint32_t cycles); // Print the statistics of the banks over the cycles of the run
+void MainMemoryFree(Main_Memory* memory); // Release the main memory
+uint32_t MainMemoryRead(Main_Memory* memory, uint32_t address); // Read a word without the bus latency
+bool MainMemoryWrite(Main_Memory* memory, uint32_t address, uint32_t value); // Write a word without the bus latency, false if a page can't be allocated
 
 #endif // MAINMEMORY_H_
@@ -0,0 +1,43 @@
+#ifndef MEMIMAGE_H
+#define MEMIMAGE_H
+
+/* Includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Defines */
+// A binary image is a 16 bytes header followed by the words in little endian order
+#define MEM_IMAGE_MAGIC "MCSIMIMG"
+#define MEM_IMAGE_MAGIC_LENGTH 8
+#define MEM_IMAGE_VERSION 1
+
+/* Types */
+typedef struct {
+    char magic[MEM_IMAGE_MAGIC_LENGTH]; // MEM_IMAGE_MAGIC
+    uint32_t version;                   // MEM_IMAGE_VERSION
+    uint32_t numOfWords;                // Number of words that follow the header
+} Mem_Image_Header;
+
+// Mem_Image - Words of an instruction or data memory image, loaded from a hex text or a binary file
+typedef struct {
+    const uint32_t* words; // Words of the image, points into the mapping or the parsed buffer
+    uint32_t numOfWords;   // Number of words in the image
+    bool isBinary;         // True if the words are mapped from a binary image
+    uint32_t* buffer;      // Words parsed from a text image (NULL for a binary image)
+    void* mapping;         // Mapped view of a binary image (NULL for a text image)
+    size_t mappingSize;    // Size of the mapped view in bytes
+} Mem_Image;
+
+/* Functions Prototypes */
+// Load up to maxWords words from the file, the format is detected by the header. Binary images are mapped without copying.
+bool MemImage_Load(Mem_Image* image, FILE* file, uint32_t maxWords);
+
+// Unmap or free the words of the image
+void MemImage_Release(Mem_Image* image);
+
+// Convert a hex text image to a binary one, or a binary image back to hex text, depending on the input format
+int MemImage_Convert(const char* inputPath, const char* outputPath);
+
+#endif // MEMIMAGE_H
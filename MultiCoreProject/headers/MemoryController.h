@@ -0,0 +1,98 @@
+#ifndef MEMORYCONTROLLER_H
+#define MEMORYCONTROLLER_H
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "./Dram.h"
+
+/* Defines */
+#define MAX_MC_QUEUE_SIZE 256
+#define DEFAULT_MC_QUEUE_SIZE 16          // Requests waiting for their banks
+#define DEFAULT_MC_STARVATION_CAP 256     // Cycles after which the oldest request of a bank goes first (0 - no cap)
+#define MC_NOT_SERVED UINT32_MAX          // Ready cycle of a request that still waits in the queue
+
+/* Types */
+// Mc_Policy - The order in which a free bank serves the requests that wait for it
+typedef enum {
+    MC_POLICY_FCFS,    // The oldest request
+    MC_POLICY_FR_FCFS, // A request of the open row, then the oldest
+    MC_POLICY_FAIR     // A request of the core that got the fewest bank cycles, then as FR-FCFS
+} Mc_Policy;
+
+// Mc_Config - Queue and scheduling of the memory controller
+typedef struct {
+    Mc_Policy policy;
+    uint32_t queue_size;      // Requests the queue holds, a full queue sends its oldest request to its bank
+    uint32_t starvation_cap;  // Cycles a request may wait before it goes first in its bank (0 - no cap)
+} Mc_Config;
+
+// Mc_Request - A block access waiting for its bank
+typedef struct {
+    uint32_t address;
+    uint32_t core;      // Core of the transaction (the number of cores or more - none)
+    uint32_t arrival;   // Cycle in which the request reached the controller
+    bool is_read;
+    bool is_tracked;    // The core waits for the ready cycle of the request, a posted write has none
+} Mc_Request;
+
+// Mc_Core - The requests of a core
+typedef struct {
+    uint32_t ready_cycle;     // Cycle of the first word of its tracked request (MC_NOT_SERVED - still queued)
+    uint32_t reads;           // Reads served
+    uint64_t read_cycles;     // Cycles from the arrival of the reads to their first word
+    uint64_t service_cycles;  // Bank cycles of all its requests, the fair policy serves the lowest first
+} Mc_Core;
+
+// Memory_Controller - The request queue in front of the banks and its scheduler
+typedef struct {
+    Mc_Config config;
+    Dram* dram;
+    Mc_Request* queue;        // Oldest first
+    uint32_t count;
+    Mc_Core* cores;
+    uint32_t num_cores;
+    uint64_t requests;        // Requests sent to the banks
+    uint64_t wait_cycles;     // Cycles the requests waited in the queue, the sum of its occupancy over the cycles
+    uint32_t max_occupancy;
+    uint32_t full_issues;     // Requests sent because the queue was full
+    uint32_t starved_issues;  // Requests sent by the starvation cap instead of the policy choice
+} Memory_Controller;
+
+/* Functions Prototypes */
+// Fill the configuration with FR-FCFS and the default queue and cap
+void MemoryController_DefaultConfig(Mc_Config* config);
+
+// Parse a policy name (fcfs, frfcfs, fair), returns false if it is unknown
+bool MemoryController_ParsePolicy(const char* name, Mc_Policy* policy);
+
+// Check the configuration, printing the error if it is invalid
+bool MemoryController_CheckConfig(const Mc_Config* config);
+
+// Start with an empty queue in front of the banks of the memory
+bool MemoryController_Init(Memory_Controller* controller, const Mc_Config* config, Dram* dram, uint32_t num_cores);
+
+// Release the queue
+void MemoryController_Free(Memory_Controller* controller);
+
+// Queue an access of the block of the address in the cycle. A tracked request records its ready cycle for its core.
+void MemoryController_Request(Memory_Controller* controller, uint32_t address, uint32_t core, bool is_read, bool is_tracked, uint32_t cycle);
+
+// Let the banks that are free before the cycle pick their requests
+void MemoryController_Advance(Memory_Controller* controller, uint32_t cycle);
+
+// Let the banks pick their requests until the tracked request of the core is served, returns its ready cycle.
+// No request may arrive until then, as with the atomic bus that waits for the block.
+uint32_t MemoryController_Serve(Memory_Controller* controller, uint32_t core);
+
+// Ready cycle of the tracked request of the core, MC_NOT_SERVED while it waits in the queue
+uint32_t MemoryController_ReadyCycle(const Memory_Controller* controller, uint32_t core);
+
+// Cycle of the next pick of a bank, UINT32_MAX if the queue is empty
+uint32_t MemoryController_NextDecision(const Memory_Controller* controller);
+
+// Print the occupancy of the queue and the average read latency of each core over a run of the given cycles
+void MemoryController_PrintStats(const Memory_Controller* controller, FILE* file, uint32_t cycles);
+
+#endif // MEMORYCONTROLLER_H
@@ -32,7 +32,35 @@ typedef enum
     HALT = 20           /**< Halt operation */
 } OpcodeFunctions;
 
+// Class of an opcode, decides the pipeline stage that executes it
+typedef enum
+{
+    OPCLASS_ALU = 0,        /**< Arithmetic, logic and shift operations, executed in EXECUTE */
+    OPCLASS_BRANCH,         /**< Branches and JAL, resolved in DECODE */
+    OPCLASS_MEMORY,         /**< LW and SW, executed in MEM */
+    OPCLASS_HALT,           /**< HALT, stops the fetch in DECODE */
+    OPCLASS_INVALID         /**< Unassigned opcode, does nothing */
+} OpcodeClass;
+
+typedef struct OpcodeParams OpcodeParams;
+
+// An instruction word decoded once when the instruction memory is loaded
 typedef struct
+{
+    uint8_t opcode;         /**< Opcode field */
+    uint8_t op_class;       /**< OpcodeClass of the opcode */
+    uint8_t rd;             /**< Destination register index */
+    uint8_t rs;             /**< Source register index */
+    uint8_t rt;             /**< Target register index */
+    uint8_t wb_reg;         /**< Register written in WRITE_BACK: PC_REG for JAL, rd otherwise */
+    uint16_t write_mask;    /**< Bit of rd, 0 for the zero and immediate registers which cause no hazard */
+    uint16_t read_mask;     /**< Bits of the registers the instruction reads: rs, rt and rd unless it is ALU or LW */
+    uint16_t read_mask_rs_rt; /**< Bits of rs and rt only */
+    uint32_t imm;           /**< Value loaded into the immediate register */
+    void (*operation)(OpcodeParams* params); /**< Handler of the opcode, NULL if it has none */
+} Decoded_Instruction;
+
+struct OpcodeParams
 {
     uint32_t *rd;           /**< Pointer to the destination register */
     uint32_t rs;            /**< Source register value */
@@ -40,7 +68,7 @@ typedef struct
     uint32_t *memory_p;     /**< Pointer to memory (if needed) */
     uint16_t *pc;           /**< Program counter (10 bits) */
     bool *halt;             /**< Flag to indicate whether to halt execution */
-} OpcodeParams;
+};
 
 
 /* Function Prototypes */
@@ -62,6 +90,7 @@ void branchGreaterEqual(OpcodeParams* params);
 void jump(OpcodeParams* params);
 bool IsOpcodeBranch(uint16_t opcode);
 bool IsOpcodeMemory(uint16_t opcode);
+void DecodeInstruction(uint32_t cmd, Decoded_Instruction* decoded);
 
 /* Map opcode to function */
 static void (*OpcodeFunctionTable[NUMBER_OPCODES])(OpcodeParams* params) = {
@@ -36,43 +36,51 @@ typedef enum
 } Pipe_figstate;
 
 //A struct that represents a stage in the pipeline - 
-//it contains the state of the stage, the program counter, the instruction, the result of the execution
-//and the operation to be performed
+//it contains the state of the stage, the program counter, the decoded instruction (with the operation
+//to be performed) and the result of the execution
 
 typedef struct
 {
 	Pipe_figstate state;
 	uint16_t pc;
-	Format_of_instruction instruction;
+	const Decoded_Instruction* decoded;
 	uint32_t result_of_execution;
-	void (*operation)(OpcodeParams* params);
 } Pipe_instruction_stage;
 
 
 // A struct that represents the statistics of the pipeline -
-// it contains the number of decode stalls and memory stalls
+// it contains the number of decode stalls and memory stalls, and of the memory stalls
+// in which the transactions of the cache waited for room in the bus queue
 
 typedef struct
 {
 	uint32_t stalls_in_decode;
 	uint32_t stalls_in_mem;
+	uint32_t stalls_in_bus_queue;
 } Pipe_Stats;
 
 // A struct that represents the pipeline - it contains the halted flag, the data hazard stall flag, the memory stall flag, 
-// the pointers to the instructions and the core registers, the cache data, the stages of the pipeline,
-// the opcode parameters and the statistics
+// the flag of an instruction held in decode by a data hazard that wasn't decoded yet,
+// the drain flags (stop fetching at the next instruction boundary and let the older instructions complete),
+// the pointers to the decoded instructions and the core registers, the cache data, the stages of the pipeline,
+// the opcode parameters, the statistics and the decoded zero word held by the stages before the first fetch
 
 typedef struct
 {
 	bool is_halted;
 	bool data_stall;
 	bool mem_stall;
-	uint32_t *insturcionts_pnt;
+	bool decode_pending;
+	bool drain_requested;
+	bool is_draining;
+	bool last_decoded_branch;
+	const Decoded_Instruction* insturcionts_pnt;
 	uint32_t* regs_pnt;
 	Cache_Data data_in_cache;
 	Pipe_instruction_stage stages_in_pipe[PIPE_SIZE];
 	OpcodeParams params_of_op;
 	Pipe_Stats stats;
+	Decoded_Instruction empty_instruction;
 }Pipe_fig;
 
 
@@ -94,5 +102,20 @@ void BubbleStage(Pipe_instruction_stage* dest, const Pipe_instruction_stage* src
 // flush all the stages of the pipeline
 bool Pipe_Flush(Pipe_fig* pipeline);
 
+// check if the pipeline is stalled in the MEM stage until the bus serves its cache
+bool Pipe_IsWaitingForMemory(Pipe_fig* pipeline);
+
+// account for cycles in which the pipeline stays stalled in the MEM stage
+void Pipe_SkipMemStallCycles(Pipe_fig* pipeline, uint32_t cycles);
+
+// empty the pipeline and start fetching at the current PC, the cache and the stats are kept
+void Pipe_Restart(Pipe_fig* pipeline);
+
+// stop fetching before the next instruction that isn't in a branch delay slot, the PC is left at that instruction
+void Pipe_RequestDrain(Pipe_fig* pipeline);
+
+// check if a drain completed, every instruction before the PC finished
+bool Pipe_IsDrained(Pipe_fig* pipeline);
+
 
 #endif // __PipelineController_H__
\ No newline at end of file
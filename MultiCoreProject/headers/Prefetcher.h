@@ -0,0 +1,60 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defines */
+#define PREFETCH_TABLE_SIZE 16     // Entries of the stride table, indexed by the low bits of the PC
+#define PREFETCH_QUEUE_SIZE 8      // Candidate blocks waiting for a free bus cycle, the oldest is dropped when full
+#define PREFETCH_CONFIDENCE 2      // Repeats of a stride before it is prefetched
+#define MAX_PREFETCH_DISTANCE 256  // Accesses ahead of the stream
+
+/* Types */
+// Stride_Entry - The last access of a load or store instruction and the stride between its accesses
+typedef struct {
+    bool valid;
+    uint16_t pc;            // Instruction of the entry
+    uint32_t last_address;  // Address of its last access
+    int32_t stride;         // Difference between its last two addresses
+    uint8_t confidence;     // Saturating count of repeats of the stride
+    uint32_t last_block;    // Last block it queued, a stream queues each block once
+} Stride_Entry;
+
+// Prefetch_Stats - The counters of a prefetcher
+typedef struct {
+    uint32_t issued;  // Prefetches that started on the bus
+    uint32_t useful;  // Prefetched blocks that a load or store accessed before they were evicted
+    uint32_t late;    // Useful prefetches that the access found still on the bus
+} Prefetch_Stats;
+
+// Prefetcher - A per PC stride prefetcher of a data cache
+typedef struct {
+    uint32_t distance;      // Accesses ahead of the stream (0 - off)
+    uint32_t offset_bits;   // Bits of the word in a block, the prefetches are of whole blocks
+    Stride_Entry table[PREFETCH_TABLE_SIZE];
+    uint32_t queue[PREFETCH_QUEUE_SIZE]; // Candidate block addresses, oldest first
+    uint32_t queue_head;
+    uint32_t queue_count;
+    uint16_t trained_pc;    // Last access trained on, the retries of a stalled access don't train again
+    uint32_t trained_address;
+    bool has_trained;
+    bool stopped;           // The core halted, no access will use a prefetch
+    Prefetch_Stats stats;
+} Prefetcher;
+
+/* Functions Prototypes */
+// Start with an empty table, distance 0 turns the prefetcher off
+void Prefetcher_Init(Prefetcher* prefetcher, uint32_t distance, uint32_t offset_bits);
+
+// Learn from the access of the instruction at pc, queueing the block distance strides ahead once the stride repeats
+void Prefetcher_Train(Prefetcher* prefetcher, uint16_t pc, uint32_t address);
+
+// Take the oldest queued block address, returns false if there is none
+bool Prefetcher_Next(Prefetcher* prefetcher, uint32_t* block_address);
+
+// Drop the queued blocks and stop training, the statistics are kept
+void Prefetcher_Stop(Prefetcher* prefetcher);
+
+#endif // PREFETCHER_H
@@ -7,11 +7,12 @@
 #include <string.h>
 #include "FilesManager.h"
 #include "PipelineController.h"
+#include "TraceWriter.h"
+#include "BlockCache.h"
 
 /* typedef & Consts */
 /* Defines */
 #define REGISTERCOUNT 16 // 16 registers per core
-#define INSTRUCTIONMEMORYSIZE 1024 // 1K words
 
 /* typedef */
 typedef struct{
@@ -20,21 +21,31 @@ typedef struct{
 } tracking_info_core;
 
 typedef struct {
-    uint32_t coreId; // Between 0 and 3
+    uint32_t coreId; // Between 0 and the number of cores - 1
     uint32_t pc; // Program Counter, 10 bits as the address space is 1K words long
     uint32_t registers[REGISTERCOUNT]; // 16 registers, each register is 32 bits
     uint32_t instruction_memory[INSTRUCTIONMEMORYSIZE]; // 1K words, each word is 32 bits
+    Decoded_Instruction decoded_instructions[INSTRUCTIONMEMORYSIZE]; // The instruction memory decoded at load
+    Block_Cache block_cache; // Basic blocks of the instruction memory translated for the functional mode
     CoreFileHandles fileHandles; // File handles for the core
+    Trace_Stream* trace; // Stream of the execution trace
     Pipe_fig pipelineController;
     bool isHalted; // Flag to indicate if the core is halted
     tracking_info_core tracking_info_core;
 } ProcessorCore;
 
 /* Functions Prototypes */
-void ProcessorCore_Init(ProcessorCore* core, uint32_t coreId);
+bool ProcessorCore_Init(ProcessorCore* core, uint32_t coreId, Bus_Controller* bus, const Cache_Config* cache_config);
+void ProcessorCore_Free(ProcessorCore* core);
 void core_run_single_cycle(ProcessorCore* c);
 void Core_Shutdown(ProcessorCore* core);
+void Core_PrintRegisters(ProcessorCore* core);
 bool core_is_halted(ProcessorCore* core);
+bool core_can_fast_forward(ProcessorCore* core);
+void core_fast_forward(ProcessorCore* core, uint32_t cycles);
+void core_restart(ProcessorCore* core);
+void core_request_drain(ProcessorCore* core);
+bool core_is_drained(ProcessorCore* core);
 
 
 #endif // ProcessorCore_H
\ No newline at end of file
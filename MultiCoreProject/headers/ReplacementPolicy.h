@@ -0,0 +1,42 @@
+#ifndef REPLACEMENTPOLICY_H
+#define REPLACEMENTPOLICY_H
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Types & Consts */
+// Replacement_Policy_Id - The policies that choose the way a set-associative cache evicts
+typedef enum {
+    REPLACEMENT_LRU,    // Least recently used
+    REPLACEMENT_PLRU,   // Tree pseudo LRU
+    REPLACEMENT_RANDOM, // Pseudo random way
+    REPLACEMENT_SRRIP,  // Static re-reference interval prediction, 2 bits per line
+    NUM_OF_REPLACEMENT_POLICIES
+} Replacement_Policy_Id;
+
+// Replacement_Set - The replacement state of one set, the storage belongs to the cache
+typedef struct {
+    uint8_t* line_state; // Per way: the LRU age or the SRRIP re-reference prediction
+    uint64_t* tree;      // PLRU tree of the set, bit n is node n (ways - 1 nodes)
+    uint32_t* random;    // State of the random generator of the cache
+    uint32_t ways;       // Number of ways, a power of 2
+} Replacement_Set;
+
+// Replacement_Policy - The callbacks of a policy
+typedef struct {
+    const char* name;
+    void (*init)(Replacement_Set* set);                 // Initial state of an empty set
+    void (*on_hit)(Replacement_Set* set, uint32_t way);  // The way was accessed
+    void (*on_fill)(Replacement_Set* set, uint32_t way); // A block was brought into the way
+    uint32_t (*victim)(Replacement_Set* set);            // Choose the way to evict when every way is valid
+} Replacement_Policy;
+
+/* Functions Prototypes */
+// Get the callbacks of a policy
+const Replacement_Policy* Replacement_GetPolicy(Replacement_Policy_Id id);
+
+// Find a policy by its name ("lru", "plru", "random", "srrip"), returns false if there is none
+bool Replacement_ParsePolicy(const char* name, Replacement_Policy_Id* id);
+
+#endif // REPLACEMENTPOLICY_H
@@ -0,0 +1,52 @@
+#ifndef SAMPLEDSIM_H
+#define SAMPLEDSIM_H
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "./SimContext.h"
+
+/* Types */
+// Sample_Metric_Id - The per core metrics measured in every detailed window
+typedef enum {
+    SAMPLE_CPI,
+    SAMPLE_READ_MISS_RATE,
+    SAMPLE_WRITE_MISS_RATE,
+    SAMPLE_MEM_STALL_PER_INSTRUCTION,
+    SAMPLE_DECODE_STALL_PER_INSTRUCTION,
+    NUM_OF_SAMPLE_METRICS
+} Sample_Metric_Id;
+
+// Sample_Metric - The running sums of the values a metric took in the windows
+typedef struct {
+    uint32_t count;        // Number of windows in which the metric was defined
+    double sum;            // Sum of the values
+    double sum_of_squares; // Sum of the squared values
+} Sample_Metric;
+
+// Sampled_Core_Stats - The samples of a core and the instructions it ran in both modes
+typedef struct {
+    Sample_Metric metrics[NUM_OF_SAMPLE_METRICS];
+    uint64_t instructions;
+} Sampled_Core_Stats;
+
+// Sampled_Stats - The samples of all the cores of a sampled simulation
+typedef struct _Sampled_Stats {
+    uint32_t windows;          // Number of measured windows
+    Sampled_Core_Stats* cores; // Array of the per core samples
+    uint32_t numOfCores;       // Number of cores in the array
+} Sampled_Stats;
+
+/* Functions Prototypes */
+// Run the machine until all the cores are halted, alternating functional periods with detailed windows.
+// The samples are kept in the context for SampledSim_Report, returns false if they can't be allocated
+bool SampledSim_Run(SimContext* context);
+
+// Write the estimates of a core and their 95% confidence intervals to its stats file
+void SampledSim_Report(const Sampled_Stats* samples, uint32_t coreId, FILE* file);
+
+// Release the samples
+void SampledSim_Free(Sampled_Stats* samples);
+
+#endif // SAMPLEDSIM_H
@@ -0,0 +1,56 @@
+#ifndef SIMCONFIG_H
+#define SIMCONFIG_H
+
+/* Includes */
+#include <stdbool.h>
+#include <stdint.h>
+#include "./TraceWriter.h"
+#include "./CacheController.h"
+#include "./Dram.h"
+#include "./MemoryController.h"
+#include "./BusArbiter.h"
+
+/* Types & Consts */
+#define DEFAULT_FUNCTIONAL_QUANTUM 100 // Instructions per turn of a core in the functional mode
+#define DEFAULT_SAMPLE_WARMUP 2000 // Detailed cycles before each measured window of the sampled simulation
+#define DEFAULT_SAMPLE_WINDOW 1000 // Measured detailed cycles of each window of the sampled simulation
+
+typedef struct {
+    bool fast_forward; // Skip cycles where every live core only waits for the memory latency
+    bool functional; // Execute the instructions without the pipeline, the caches and the bus (only memout and regout are written)
+    uint32_t quantum; // Number of instructions a core runs before the next core in the functional mode
+    uint32_t sample_period; // Instructions each core runs functionally between the detailed windows (0 - no sampling)
+    uint32_t sample_warmup; // Detailed cycles that warm the pipeline and the bus before a window is measured
+    uint32_t sample_window; // Detailed cycles measured in each window
+    uint32_t num_cores; // Number of cores of the simulated machine
+    Cache_Config cache; // Organization of the data caches
+    bool directory_coherence; // Send the transactions only to the caches that a directory lists as holding the block, instead of every cache
+    bool snoop_filter; // Skip the snoops of the caches that can't answer, the outputs are the same
+    bool snoop_stats; // Append the snoops each cache received and was spared to statsN.txt
+    bool split_bus; // Free the bus between the request of a read and its block, the memory serves several reads at once
+    bool bus_stats; // Append the bus transactions of each core and the cycles they waited in the queue to statsN.txt
+    Bus_Arbiter_Config arbiter; // Policy that picks the core whose transaction goes next on the bus
+    uint32_t bus_queue_size; // Transactions the bus queues hold together, the cores wait for room when they are full (0 - a miss of every core)
+    Dram_Config dram; // Banks and row timing of the main memory
+    Mc_Config controller; // Request queue and scheduling policy of the banks
+    bool dram_stats; // Write the accesses, the row buffer hits and the utilization of each bank to dramstats.txt
+    uint32_t threads;  // Number of host threads that step the cores (1 - step them on the main thread)
+    const char* batch_file; // List of workloads to run in one process (NULL - run a single simulation)
+    uint32_t jobs; // Number of simulations the batch runs at the same time
+    bool convert; // Convert the memory image given in the file arguments instead of simulating
+    bool decode_trace; // Decode the binary trace given in the file arguments instead of simulating
+    Trace_Format trace_format; // Format of the core and bus traces
+    Trace_Options trace_options; // Cycles and cores that are traced
+    bool query_trace; // Print a cycle window of the binary trace given in the file arguments instead of simulating
+    uint32_t query_first_cycle; // First cycle of the window
+    uint32_t query_last_cycle;  // Last cycle of the window
+} SimConfig;
+
+/* Functions Prototypes */
+// Fill the configuration with the default values
+void SimConfig_Default(SimConfig* config);
+
+// Parse the "--option" arguments and remove them from argv, leaving only the file arguments
+int ParseSimOptions(SimConfig* config, int* argc, char* argv[]);
+
+#endif // SIMCONFIG_H
@@ -0,0 +1,48 @@
+#ifndef SIMCONTEXT_H
+#define SIMCONTEXT_H
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include "./SimConfig.h"
+#include "./FilesManager.h"
+#include "./MainMemory.h"
+#include "./BusController.h"
+#include "./Directory.h"
+#include "./ProcessorCore.h"
+#include "./CoreWorkers.h"
+#include "./TraceWriter.h"
+
+/* Types */
+// SimContext - A complete simulated machine, independent of any other context in the process
+typedef struct {
+    SimConfig config;      // Options of the simulation
+    SimFiles files;        // Input and output files
+    Main_Memory memory;    // Shared main memory
+    Bus_Controller bus;    // Shared bus of the cores
+    Directory sharer_directory; // Caches that hold each block, for the directory coherence and the snoop filter
+    ProcessorCore* cores;  // Array of cores
+    uint32_t numOfCores;   // Number of cores in the array
+    Core_Workers workers;  // Threads that step the cores
+    Trace_Writer tracer;   // Streams of the core and bus traces
+    struct _Sampled_Stats* samples; // Samples of the detailed windows of a sampled simulation (NULL - not sampled)
+} SimContext;
+
+/* Functions Prototypes */
+// Open the files and initialize the machine. Without file arguments the default names are used in the directory
+int SimContext_Init(SimContext* context, const SimConfig* config, char* argv[], int argc, const char* directory);
+
+// Run the machine until all the cores are halted
+void SimContext_Run(SimContext* context);
+
+// Run a single cycle of the bus and the cores, or jump over cycles that only count the memory latency.
+// Advances at most max_cycles (at least 1), returns the number of cycles advanced
+uint32_t SimContext_Step(SimContext* context, uint32_t max_cycles);
+
+// Write the outputs, close the files and release the machine
+void SimContext_Finish(SimContext* context);
+
+// Init, run and finish a single simulation, returns 0 on success
+int SimContext_RunWorkload(const SimConfig* config, char* argv[], int argc, const char* directory);
+
+#endif // SIMCONTEXT_H
@@ -0,0 +1,49 @@
+#ifndef SIMTHREADS_H
+#define SIMTHREADS_H
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* Types & Consts */
+#ifdef _MSC_VER
+typedef HANDLE SimThread;
+typedef volatile LONG SimAtomic;
+typedef volatile LONG64 SimAtomicBits;
+#else
+typedef pthread_t SimThread;
+typedef volatile int SimAtomic;
+typedef volatile uint64_t SimAtomicBits;
+#endif
+
+typedef void (*SimThread_Entry)(void* arg);
+
+typedef struct {
+    SimAtomic arrived;    // Number of threads that reached the barrier in the current generation
+    SimAtomic generation; // Incremented by the last thread to release the others
+    int parties;          // Number of threads that meet at the barrier
+} SimBarrier;
+
+/* Functions Prototypes */
+bool SimThread_Create(SimThread* thread, SimThread_Entry entry, void* arg);
+void SimThread_Join(SimThread thread);
+void SimThread_Yield(void);
+void SimThread_Sleep(uint32_t milliseconds);
+int SimThread_HardwareConcurrency(void);
+
+int SimAtomic_Load(SimAtomic* value);
+void SimAtomic_Store(SimAtomic* value, int new_value);
+int SimAtomic_Increment(SimAtomic* value); // Returns the incremented value
+void SimAtomic_SetBits(SimAtomicBits* value, uint64_t bits);   // Set the bits, the other bits may change at the same time
+void SimAtomic_ClearBits(SimAtomicBits* value, uint64_t bits);
+
+// Spinning barrier, cheap enough to be crossed every simulated cycle
+void SimBarrier_Init(SimBarrier* barrier, int parties);
+void SimBarrier_Wait(SimBarrier* barrier);
+
+#endif // SIMTHREADS_H
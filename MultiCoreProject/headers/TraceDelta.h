@@ -0,0 +1,54 @@
+#ifndef TRACEDELTA_H
+#define TRACEDELTA_H
+
+/* Includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "./TraceWriter.h"
+
+/* Defines */
+#define TRACE_DELTA_KEYFRAME_INTERVAL 1024 // Records between two keyframes
+#define TRACE_DELTA_INDEX_MAGIC "MCSIMIDX"
+
+/* Types */
+// Entry of the keyframe index, written after the records
+typedef struct {
+    uint32_t cycle;     // Cycle of the keyframe
+    uint32_t reserved;
+    uint64_t offset;    // Offset of the keyframe from the start of the file
+} Trace_Keyframe;
+
+// Last bytes of a complete delta trace file
+typedef struct {
+    uint64_t index_offset;  // Offset of the keyframe index, which is also the end of the records
+    uint32_t num_keyframes; // Number of entries in the index
+    uint32_t interval;      // TRACE_DELTA_KEYFRAME_INTERVAL
+    char magic[TRACE_FILE_MAGIC_LENGTH]; // TRACE_DELTA_INDEX_MAGIC
+} Trace_Delta_Trailer;
+
+// Trace_Delta_Encoder - State of the delta encoding of a core trace, owned by the writer thread
+struct Trace_Delta_Encoder {
+    Core_Trace_Record previous; // Last encoded record
+    uint64_t records;           // Number of encoded records
+    uint64_t offset;            // Bytes written to the file so far
+    Trace_Keyframe* index;      // Keyframes written so far
+    uint32_t num_keyframes;
+    uint32_t index_capacity;
+};
+
+/* Functions Prototypes */
+// Start encoding after the file header
+void TraceDelta_Init(Trace_Delta_Encoder* encoder);
+
+// Append a record: a keyframe every TRACE_DELTA_KEYFRAME_INTERVAL records, otherwise the changes from the previous record
+bool TraceDelta_Encode(Trace_Delta_Encoder* encoder, FILE* file, const Core_Trace_Record* record);
+
+// Write the keyframe index and the trailer, and release the encoder
+void TraceDelta_Finish(Trace_Delta_Encoder* encoder, FILE* file);
+
+// Print the records of cycles first_cycle .. last_cycle in the text format. The file is positioned after the header.
+// The keyframe index is used to seek close to first_cycle, a file without index is decoded from the start.
+uint32_t TraceDelta_Decode(FILE* input, FILE* output, uint32_t first_cycle, uint32_t last_cycle);
+
+#endif // TRACEDELTA_H
@@ -0,0 +1,154 @@
+#ifndef TRACEWRITER_H
+#define TRACEWRITER_H
+
+/* Includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "./sim.h"
+#include "./SimThreads.h"
+
+/* Defines */
+#define TRACE_NUM_OF_STAGES 5 // Fetch, decode, execute, mem and write back
+#define TRACE_NUM_OF_REGS (NUM_OF_REGS - START_MUTABLE_REG) // Registers printed in a core trace line
+#define TRACE_NO_PC UINT16_MAX // Stage without an instruction, printed as "---"
+#define TRACE_FILE_MAGIC "MCSIMTRC"
+#define TRACE_FILE_MAGIC_LENGTH 8
+#define TRACE_FILE_VERSION 1
+
+// 64 bit file positions, traces of long runs exceed 2 GB
+#ifdef _MSC_VER
+#define TRACE_SEEK _fseeki64
+#define TRACE_TELL _ftelli64
+#else
+#define TRACE_SEEK fseeko
+#define TRACE_TELL ftello
+#endif
+
+/* Types */
+typedef enum {
+    TRACE_FORMAT_TEXT,   // coreNtrace.txt and bustrace.txt, written on the simulation threads
+    TRACE_FORMAT_BINARY, // Fixed size records, written by a background thread and decoded with --decode-trace
+    TRACE_FORMAT_DELTA   // As binary, with the core traces encoded as changes from the previous cycle (see TraceDelta)
+} Trace_Format;
+
+typedef enum {
+    TRACE_KIND_CORE,
+    TRACE_KIND_BUS,
+    TRACE_KIND_CORE_DELTA
+} Trace_Kind;
+
+// Header at the start of a binary trace file
+typedef struct {
+    char magic[TRACE_FILE_MAGIC_LENGTH]; // TRACE_FILE_MAGIC
+    uint32_t version;                    // TRACE_FILE_VERSION
+    uint32_t kind;                       // Trace_Kind of the records that follow
+} Trace_File_Header;
+
+// A line of coreNtrace.txt
+typedef struct {
+    uint32_t cycle;
+    uint16_t stage_pc[TRACE_NUM_OF_STAGES]; // TRACE_NO_PC for an empty stage
+    uint16_t reserved;
+    uint32_t regs[TRACE_NUM_OF_REGS];       // Registers R2 to R15 at the start of the cycle
+} Core_Trace_Record;
+
+// A line of bustrace.txt
+typedef struct {
+    uint32_t cycle;
+    uint16_t origid;
+    uint8_t bus_cmd;
+    uint8_t bus_shared;
+    uint32_t bus_addr;
+    uint32_t bus_data;
+} Bus_Trace_Record;
+
+// Trace_Options - Which cycles and cores are traced
+typedef struct {
+    uint32_t start_cycle;   // First traced cycle
+    uint32_t stop_cycle;    // Last traced cycle
+    uint64_t core_mask;     // Bit per traced core
+    bool bus_enabled;       // Trace the bus
+    uint32_t sample_period; // Trace one cycle of every sample_period (1 - every cycle)
+    bool has_trigger_pc;    // Start tracing after a core fetches trigger_pc
+    uint16_t trigger_pc;
+    bool has_trigger_addr;  // Start tracing after a bus transaction on trigger_addr
+    uint32_t trigger_addr;
+} Trace_Options;
+
+// Trace_Filter - The options and the state of the triggers, shared by the streams of a simulation
+typedef struct {
+    Trace_Options options;
+    bool has_trigger;       // True if the tracing waits for a trigger
+    SimAtomic triggered;    // Cycle of the trigger + 1, 0 until it fires
+} Trace_Filter;
+
+typedef struct Trace_Delta_Encoder Trace_Delta_Encoder;
+
+// Trace_Stream - Output of a single trace file. In binary format the records go through a single producer,
+// single consumer ring that the writer thread drains to the file.
+typedef struct {
+    FILE* file;          // Trace file, NULL if the stream is not used
+    Trace_Format format;
+    Trace_Kind kind;
+    uint32_t record_size;
+    uint8_t* ring;       // capacity records
+    uint32_t capacity;   // Power of two
+    SimAtomic head;      // Next record to produce, modulo 2 * capacity
+    SimAtomic tail;      // Next record to write, modulo 2 * capacity
+    bool has_writer;     // False if the writer thread could not start, the producer then writes a full ring itself
+    Trace_Delta_Encoder* delta; // Encoder of a delta core trace, NULL for fixed size records
+    bool enabled;        // False if the options exclude the stream
+    Trace_Filter* filter; // Cycles to trace, shared with the other streams
+} Trace_Stream;
+
+// Trace_Writer - The trace streams of a simulation and the thread that writes them
+typedef struct {
+    Trace_Stream* streams;  // One stream per core followed by the bus stream
+    uint32_t num_of_cores;
+    SimThread thread;
+    bool thread_started;
+    SimAtomic stop;
+    Trace_Filter filter;
+} Trace_Writer;
+
+/* Functions Prototypes */
+// Fill the options to trace every cycle of every core and of the bus
+void Trace_DefaultOptions(Trace_Options* options);
+
+// Create the streams over the already opened trace files, starting the writer thread for the binary format
+bool TraceWriter_Start(Trace_Writer* writer, Trace_Format format, const Trace_Options* options, FILE** core_files, uint32_t num_of_cores, FILE* bus_file);
+
+// Write the remaining records, stop the writer thread and release the streams. The files stay open.
+void TraceWriter_Stop(Trace_Writer* writer);
+
+Trace_Stream* TraceWriter_CoreStream(Trace_Writer* writer, uint32_t core);
+Trace_Stream* TraceWriter_BusStream(Trace_Writer* writer);
+
+// Check whether the line of a cycle is written to the stream, callers skip preparing the line otherwise
+bool Trace_IsCycleTraced(Trace_Stream* stream, uint32_t cycle);
+
+// Fire the triggers, the tracing starts on the cycle that follows
+void Trace_CheckPcTrigger(Trace_Stream* stream, uint32_t cycle, uint16_t fetch_pc);
+void Trace_CheckAddressTrigger(Trace_Stream* stream, uint32_t cycle, uint32_t bus_addr);
+
+// Trace a core cycle, the stage PCs after the cycle and the registers before it
+void Trace_WriteCore(Trace_Stream* stream, uint32_t cycle, const uint16_t* stage_pc, const uint32_t* regs);
+
+// Trace the consecutive cycles first_cycle .. first_cycle + count - 1 of a core that stays in the same state
+void Trace_WriteCoreRepeated(Trace_Stream* stream, uint32_t first_cycle, uint32_t count, const uint16_t* stage_pc, const uint32_t* regs);
+
+// Trace a bus transaction
+void Trace_WriteBus(Trace_Stream* stream, uint32_t cycle, uint32_t origid, uint32_t bus_cmd, uint32_t bus_addr, uint32_t bus_data, bool bus_shared);
+
+// Decode a binary trace file into the text format
+int Trace_Decode(const char* inputPath, const char* outputPath);
+
+// Print the lines of cycles first_cycle .. last_cycle of a binary core trace
+int Trace_Query(const char* inputPath, uint32_t first_cycle, uint32_t last_cycle, FILE* output);
+
+// Print a record in the text format
+void Trace_PrintCoreRecord(FILE* file, const Core_Trace_Record* record);
+void Trace_PrintBusRecord(FILE* file, const Bus_Trace_Record* record);
+
+#endif // TRACEWRITER_H
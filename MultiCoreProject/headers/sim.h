@@ -10,7 +10,9 @@
 #include <stdbool.h>
 
 
-#define NUM_OF_CORES 4
+#define DEFAULT_NUM_OF_CORES 4 // Number of cores when not given in the options
+#define MAX_NUM_OF_CORES 64 // Upper limit of the run time number of cores
+#define INSTRUCTIONMEMORYSIZE 1024 // 1K words of instruction memory per core
 #define NUM_OF_REGS 16
 #define IMM_REG  1
 #define ZERO_REG 0
@@ -0,0 +1,47 @@
+/*!
+******************************************************************************
+file AddressLayout.c
+
+The split of a main memory address into offset, set and tag fields.
+
+The geometry of the caches is chosen at run time, so the fields are shifts and
+masks computed once from the block size and the number of sets, instead of
+bit-field structs. The caches, the bus and the memory share the computation.
+*****************************************************************************/
+
+/* Includes */
+#include "../headers/AddressLayout.h"
+
+/* Static Functions */
+static uint32_t log2_of(uint32_t value); // Bits of a power of 2
+
+/* Functions implementations */
+static uint32_t log2_of(uint32_t value) {
+    uint32_t bits = 0;
+    while ((1u << bits) < value) {
+        bits++;
+    }
+    return bits;
+}
+
+bool AddressLayout_IsPowerOf2(uint32_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+bool AddressLayout_Init(Address_Layout* layout, uint32_t block_words, uint32_t num_sets) {
+    if (!AddressLayout_IsPowerOf2(block_words) || !AddressLayout_IsPowerOf2(num_sets)) {
+        return false;
+    }
+    layout->block_words = block_words;
+    layout->offset_bits = log2_of(block_words);
+    layout->offset_mask = block_words - 1;
+    layout->set_bits = log2_of(num_sets);
+    layout->set_mask = num_sets - 1;
+    layout->tag_shift = layout->offset_bits + layout->set_bits;
+    if (layout->tag_shift > ADDRESS_BITS) {
+        return false;
+    }
+    layout->tag_bits = ADDRESS_BITS - layout->tag_shift;
+    layout->tag_mask = (1u << layout->tag_bits) - 1;
+    return true;
+}
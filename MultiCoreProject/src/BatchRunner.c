@@ -0,0 +1,214 @@
+/*!
+******************************************************************************
+file BatchRunner.c
+
+Runs a list of workloads in one process on a pool of threads.
+
+Every workload gets its own SimContext, so the simulations share nothing but 
+the code. This saves the process start up of a sim.exe per workload.
+*****************************************************************************/
+
+/* Includes */
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "../headers/BatchRunner.h"
+#include "../headers/SimContext.h"
+#include "../headers/SimThreads.h"
+
+/* Defines */
+#define BATCH_LINE_LENGTH 1024
+#define BATCH_MAX_ARGS 32
+
+/* Types */
+typedef struct {
+    char line[BATCH_LINE_LENGTH]; // The line of the list, split in place into the arguments
+    char* argv[BATCH_MAX_ARGS + 1]; // Program name followed by the options of the workload
+    int argc;
+    const char* directory; // Directory of the input and output files
+    int status; // 0 if the workload ran successfully
+} batch_workload;
+
+typedef struct {
+    const SimConfig* config; // Options shared by all the workloads
+    batch_workload** workloads; // Allocated one by one, the arguments of a workload point into its line
+    int num_workloads;
+    int num_rejected; // Lines of the list that were too long to run
+    SimAtomic next_workload; // Index of the next workload to take (+1)
+} batch_pool;
+
+/* Static Functions */
+static int read_workloads(const char* path, batch_workload*** workloads, int* rejected);
+static void free_workloads(batch_workload** workloads, int count);
+static bool is_whole_line(FILE* list, const char* line);
+static bool split_workload(batch_workload* workload);
+static void run_workload(const SimConfig* base_config, batch_workload* workload);
+static void pool_worker(void* arg);
+
+/* Functions implementations */
+static bool split_workload(batch_workload* workload) {
+    // Split the line into the directory and the options, return false if the line is empty or a comment
+    char* cursor = workload->line;
+    workload->argc = 0;
+    workload->argv[workload->argc++] = "sim";
+    workload->directory = NULL;
+    while (*cursor != '\0') {
+        while (isspace((unsigned char)*cursor)) {
+            *cursor++ = '\0';
+        }
+        if (*cursor == '\0' || (*cursor == '#' && workload->directory == NULL)) {
+            break;
+        }
+        if (workload->directory == NULL) {
+            workload->directory = cursor;
+        } else if (workload->argc < BATCH_MAX_ARGS) {
+            workload->argv[workload->argc++] = cursor;
+        }
+        while (*cursor != '\0' && !isspace((unsigned char)*cursor)) {
+            cursor++;
+        }
+    }
+    workload->argv[workload->argc] = NULL;
+    return workload->directory != NULL;
+}
+
+
+static bool is_whole_line(FILE* list, const char* line) {
+    // Check if fgets read the whole line, otherwise skip the rest of it
+    if (strchr(line, '\n') != NULL) {
+        return true;
+    }
+    int next = fgetc(list);
+    if (next == EOF || next == '\n') {
+        return true; // The last line of the list, or a line that filled the buffer exactly
+    }
+    while (next != EOF && next != '\n') {
+        next = fgetc(list);
+    }
+    return false;
+}
+
+
+static void free_workloads(batch_workload** workloads, int count) {
+    for (int i = 0; i < count; i++) {
+        free(workloads[i]);
+    }
+    free(workloads);
+}
+
+
+static int read_workloads(const char* path, batch_workload*** workloads, int* rejected) {
+    // Read the list into an array of workloads, returns the number of workloads or -1 on failure.
+    // The lines that are too long are skipped and counted in rejected.
+    FILE* list = fopen(path, "r");
+    if (list == NULL) {
+        printf("Error: Failed to open the batch list %s.\n", path);
+        return -1;
+    }
+
+    int count = 0;
+    int capacity = 0;
+    int line_number = 0;
+    batch_workload* workload = NULL;
+    *workloads = NULL;
+    *rejected = 0;
+    for (;;) {
+        // The line is read and split in its own allocation, which doesn't move when the array grows
+        if (workload == NULL && (workload = malloc(sizeof(batch_workload))) == NULL) {
+            break;
+        }
+        if (fgets(workload->line, sizeof(workload->line), list) == NULL) {
+            break;
+        }
+        line_number++;
+        if (!is_whole_line(list, workload->line)) {
+            printf("Error: Line %d of the batch list %s is longer than %d characters.\n", line_number, path, BATCH_LINE_LENGTH - 1);
+            (*rejected)++;
+            continue;
+        }
+        if (!split_workload(workload)) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = (capacity == 0) ? 16 : capacity * 2;
+            batch_workload** grown = realloc(*workloads, capacity * sizeof(batch_workload*));
+            if (grown == NULL) {
+                break;
+            }
+            *workloads = grown;
+        }
+        workload->status = 0;
+        (*workloads)[count++] = workload;
+        workload = NULL;
+    }
+    bool is_complete = feof(list) && !ferror(list);
+    fclose(list);
+    free(workload);
+    if (!is_complete) {
+        printf("Error: Failed to read the batch list %s.\n", path);
+        free_workloads(*workloads, count);
+        *workloads = NULL;
+        return -1;
+    }
+    return count;
+}
+
+
+static void run_workload(const SimConfig* base_config, batch_workload* workload) {
+    // Apply the options of the line on top of the shared ones and run the simulation
+    SimConfig config = *base_config;
+    config.batch_file = NULL;
+    if (ParseSimOptions(&config, &workload->argc, workload->argv) != 0 || workload->argc != 1) {
+        printf("Error: Invalid options for the workload %s.\n", workload->directory);
+        workload->status = 1;
+        return;
+    }
+    workload->status = SimContext_RunWorkload(&config, workload->argv, workload->argc, workload->directory);
+}
+
+
+static void pool_worker(void* arg) {
+    // Take the workloads one by one until the list is done
+    batch_pool* pool = (batch_pool*)arg;
+    for (int index = SimAtomic_Increment(&pool->next_workload) - 1; index < pool->num_workloads;
+         index = SimAtomic_Increment(&pool->next_workload) - 1) {
+        run_workload(pool->config, pool->workloads[index]);
+    }
+}
+
+
+int BatchRunner_Run(const SimConfig* config) {
+    batch_pool pool = { .config = config, .next_workload = 0 };
+    pool.num_workloads = read_workloads(config->batch_file, &pool.workloads, &pool.num_rejected);
+    if (pool.num_workloads < 0) {
+        return 1;
+    }
+
+    // The calling thread is one of the workers
+    int num_threads = ((int)config->jobs > pool.num_workloads) ? pool.num_workloads : (int)config->jobs;
+    SimThread* threads = calloc(num_threads > 1 ? num_threads : 1, sizeof(SimThread));
+    int started = 1;
+    for (; threads != NULL && started < num_threads; started++) {
+        if (!SimThread_Create(&threads[started], pool_worker, &pool)) {
+            break;
+        }
+    }
+    pool_worker(&pool);
+    for (int i = 1; threads != NULL && i < started; i++) {
+        SimThread_Join(threads[i]);
+    }
+    free(threads);
+
+    // Summary of the batch
+    int failed = pool.num_rejected;
+    for (int i = 0; i < pool.num_workloads; i++) {
+        printf("Workload %s: %s\n", pool.workloads[i]->directory, pool.workloads[i]->status == 0 ? "done" : "failed");
+        failed += (pool.workloads[i]->status != 0) ? 1 : 0;
+    }
+    free_workloads(pool.workloads, pool.num_workloads);
+    return failed;
+}
@@ -0,0 +1,80 @@
+/*!
+******************************************************************************
+file BlockCache.c
+
+Basic block translation of the instruction memory for the functional mode.
+
+Each instruction of a block becomes a Block_Op, the operation kind and the
+operands the executor switches on directly, instead of calling the handler of
+OpcodeHandlers.c through a parameter block. A block is translated when it is
+first executed and stays for the rest of the run, as the instruction memory is
+read only once it is loaded.
+*****************************************************************************/
+
+/* Includes */
+#include <string.h>
+#include "../headers/BlockCache.h"
+
+/* Static Functions */
+static void translate_instruction(const Decoded_Instruction* decoded, Block_Op* op); // Build the op of an instruction
+static uint32_t translate_block(Block_Cache* cache, uint32_t start); // Translate the block starting at an address, returns its length
+
+/* Functions implementations */
+static void translate_instruction(const Decoded_Instruction* decoded, Block_Op* op) {
+    op->rd = decoded->rd;
+    op->rs = decoded->rs;
+    op->rt = decoded->rt;
+    op->wb_reg = decoded->wb_reg;
+    op->imm = decoded->imm;
+
+    // The opcodes of the ALU, branches and memory map one to one to the first kinds
+    switch (decoded->op_class) {
+    case OPCLASS_ALU:
+    case OPCLASS_BRANCH:
+    case OPCLASS_MEMORY:
+        op->kind = decoded->opcode;
+        break;
+    case OPCLASS_HALT:
+        op->kind = BLOCK_OP_HALT;
+        break;
+    default:
+        op->kind = BLOCK_OP_NOP;
+        break;
+    }
+}
+
+static uint32_t translate_block(Block_Cache* cache, uint32_t start) {
+    uint32_t address = start;
+    while (address < INSTRUCTIONMEMORYSIZE) {
+        const Decoded_Instruction* decoded = &cache->decoded[address];
+        translate_instruction(decoded, &cache->ops[address]);
+        address++;
+        if (decoded->op_class == OPCLASS_HALT) {
+            break;
+        }
+        if (decoded->op_class == OPCLASS_BRANCH) {
+            // The delay slot runs before the target, it closes the block
+            if (address < INSTRUCTIONMEMORYSIZE) {
+                translate_instruction(&cache->decoded[address], &cache->ops[address]);
+                address++;
+            }
+            break;
+        }
+    }
+    cache->block_length[start] = (uint16_t)(address - start);
+    return address - start;
+}
+
+void BlockCache_Init(Block_Cache* cache, const Decoded_Instruction* decoded) {
+    cache->decoded = decoded;
+    memset(cache->block_length, 0, sizeof(cache->block_length));
+}
+
+const Block_Op* BlockCache_Lookup(Block_Cache* cache, uint32_t pc, uint32_t* length) {
+    uint32_t start = pc & (INSTRUCTIONMEMORYSIZE - 1);
+    *length = cache->block_length[start];
+    if (*length == 0) {
+        *length = translate_block(cache, start);
+    }
+    return &cache->ops[start];
+}
@@ -0,0 +1,195 @@
+/*!
+******************************************************************************
+file BusArbiter.c
+
+Arbitration of the bus between the request queues of the cores.
+
+Each core queues its transactions in its own queue, and when the bus is free
+the arbiter picks the core whose first transaction goes next: the oldest one
+(age, the order of a single queue shared by the cores), the next core after
+the last one granted (round robin), the lowest core (fixed priority), or the
+core that is furthest behind its share of the grants (weighted). The
+weighted policy is stride scheduling: each grant moves the pass of the core
+by a stride inversely proportional to its weight, and the lowest pass goes
+next, so a core of weight 2 wins the bus twice as often as a core of weight 1
+while both have transactions. A core whose queue was empty joins at the pass
+of the last grant, it gets no credit for the cycles it didn't use the bus.
+
+Round robin is the arbitration of the specification. The age policy is the
+default only because it reproduces the reference outputs of the asm tests.
+
+The arbiter records the grants of each core and the cycles their
+transactions waited, in a histogram of powers of 2, so that the starvation of
+a core by a policy shows in its statistics.
+*****************************************************************************/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include "../headers/BusArbiter.h"
+
+/* Static Functions */
+static bool is_preferred(const Bus_Arbiter* arbiter, uint32_t core, uint32_t picked); // Check if the core goes before the picked one
+static uint32_t wait_bucket(uint32_t wait_cycles); // Histogram bucket of a wait
+
+/* Functions implementations */
+void BusArbiter_DefaultConfig(Bus_Arbiter_Config* config) {
+    config->policy = BUS_ARBITER_AGE;
+    for (uint32_t i = 0; i < MAX_NUM_OF_CORES; i++) {
+        config->weights[i] = 1;
+    }
+}
+
+
+bool BusArbiter_ParsePolicy(const char* name, Bus_Arbiter_Policy* policy) {
+    if (strcmp(name, "age") == 0) {
+        *policy = BUS_ARBITER_AGE;
+    } else if (strcmp(name, "rr") == 0) {
+        *policy = BUS_ARBITER_ROUND_ROBIN;
+    } else if (strcmp(name, "fixed") == 0) {
+        *policy = BUS_ARBITER_FIXED;
+    } else if (strcmp(name, "weighted") == 0) {
+        *policy = BUS_ARBITER_WEIGHTED;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+bool BusArbiter_ParseWeights(const char* list, Bus_Arbiter_Config* config) {
+    // Comma separated weights, from core 0
+    const char* item = list;
+    for (uint32_t core = 0; core < MAX_NUM_OF_CORES; core++) {
+        char* end = NULL;
+        unsigned long weight = strtoul(item, &end, 0);
+        if (end == item || weight == 0 || weight > MAX_BUS_WEIGHT || (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        config->weights[core] = (uint32_t)weight;
+        if (*end == '\0') {
+            return true;
+        }
+        item = end + 1;
+    }
+    return false; // More weights than cores
+}
+
+
+bool BusArbiter_Init(Bus_Arbiter* arbiter, const Bus_Arbiter_Config* config, uint32_t num_cores) {
+    memset(arbiter, 0, sizeof(Bus_Arbiter));
+    arbiter->policy = config->policy;
+    arbiter->num_cores = num_cores;
+    arbiter->last_core = num_cores - 1; // Round robin starts from core 0
+    arbiter->cores = calloc(num_cores, sizeof(Bus_Arbiter_Core));
+    if (arbiter->cores == NULL) {
+        return false;
+    }
+    for (uint32_t i = 0; i < num_cores; i++) {
+        arbiter->cores[i].head_cycle = BUS_ARBITER_NO_REQUEST;
+        arbiter->cores[i].stride = BUS_ARBITER_STRIDE / config->weights[i];
+    }
+    return true;
+}
+
+
+void BusArbiter_Free(Bus_Arbiter* arbiter) {
+    free(arbiter->cores);
+    arbiter->cores = NULL;
+}
+
+
+void BusArbiter_Request(Bus_Arbiter* arbiter, uint32_t core, uint32_t cycle) {
+    Bus_Arbiter_Core* requester = &arbiter->cores[core];
+    requester->head_cycle = cycle;
+    if (requester->pass < arbiter->virtual_time) {
+        requester->pass = arbiter->virtual_time;
+    }
+}
+
+
+static bool is_preferred(const Bus_Arbiter* arbiter, uint32_t core, uint32_t picked) {
+    // The cores are looked at in the order of the policy, a later one goes first only if it is better
+    const Bus_Arbiter_Core* candidate = &arbiter->cores[core];
+    const Bus_Arbiter_Core* best = &arbiter->cores[picked];
+    switch (arbiter->policy) {
+    case BUS_ARBITER_WEIGHTED:
+        if (candidate->pass != best->pass) {
+            return candidate->pass < best->pass;
+        }
+        return candidate->head_cycle < best->head_cycle;
+    case BUS_ARBITER_AGE:
+        return candidate->head_cycle < best->head_cycle;
+    default:
+        return false;
+    }
+}
+
+
+uint32_t BusArbiter_Pick(const Bus_Arbiter* arbiter) {
+    uint32_t picked = BUS_ARBITER_NO_REQUEST;
+    for (uint32_t i = 0; i < arbiter->num_cores; i++) {
+        // Round robin starts from the core after the last grant, the other policies from core 0
+        uint32_t core = (arbiter->policy == BUS_ARBITER_ROUND_ROBIN) ? (arbiter->last_core + 1 + i) % arbiter->num_cores : i;
+        if (arbiter->cores[core].head_cycle == BUS_ARBITER_NO_REQUEST) {
+            continue;
+        }
+        if (picked == BUS_ARBITER_NO_REQUEST || is_preferred(arbiter, core, picked)) {
+            picked = core;
+        }
+    }
+    return picked;
+}
+
+
+static uint32_t wait_bucket(uint32_t wait_cycles) {
+    // Bucket b holds the waits from 2^(b-1) to 2^b - 1, the last one every longer wait
+    uint32_t bucket = 0;
+    while ((wait_cycles >> bucket) != 0 && bucket < BUS_WAIT_BUCKETS - 1) {
+        bucket++;
+    }
+    return bucket;
+}
+
+
+void BusArbiter_Grant(Bus_Arbiter* arbiter, uint32_t core, uint32_t cycle, uint32_t next_head_cycle, bool is_transaction) {
+    Bus_Arbiter_Core* granted = &arbiter->cores[core];
+    if (is_transaction) {
+        uint32_t wait_cycles = cycle - granted->head_cycle;
+        granted->grants++;
+        granted->wait_cycles += wait_cycles;
+        granted->max_wait = (wait_cycles > granted->max_wait) ? wait_cycles : granted->max_wait;
+        granted->wait_histogram[wait_bucket(wait_cycles)]++;
+        arbiter->last_core = core;
+        arbiter->virtual_time = granted->pass;
+        granted->pass += granted->stride;
+    }
+    granted->head_cycle = next_head_cycle;
+}
+
+
+uint32_t BusArbiter_Grants(const Bus_Arbiter* arbiter, uint32_t core) {
+    return arbiter->cores[core].grants;
+}
+
+
+uint64_t BusArbiter_WaitCycles(const Bus_Arbiter* arbiter, uint32_t core) {
+    return arbiter->cores[core].wait_cycles;
+}
+
+
+void BusArbiter_PrintWaits(const Bus_Arbiter* arbiter, uint32_t core, FILE* file) {
+    const Bus_Arbiter_Core* waiter = &arbiter->cores[core];
+    fprintf(file, "bus_max_wait %u\n", waiter->max_wait);
+    for (uint32_t bucket = 0; bucket < BUS_WAIT_BUCKETS; bucket++) {
+        uint32_t first = (bucket == 0) ? 0 : (1u << (bucket - 1));
+        uint32_t last = (bucket == 0) ? 0 : (1u << bucket) - 1;
+        if (bucket == BUS_WAIT_BUCKETS - 1) {
+            fprintf(file, "bus_wait_%u_up %u\n", first, waiter->wait_histogram[bucket]);
+        } else if (first == last) {
+            fprintf(file, "bus_wait_%u %u\n", first, waiter->wait_histogram[bucket]);
+        } else {
+            fprintf(file, "bus_wait_%u_%u %u\n", first, last, waiter->wait_histogram[bucket]);
+        }
+    }
+}
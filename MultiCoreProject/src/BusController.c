@@ -4,6 +4,16 @@ file BusController.c
 
 Implementation of the BUS functionality.
 
+The bus serves one transaction at a time, from its request to the last word of
+the block. Each core queues its transactions in its own queue, and the
+arbiter picks the core whose oldest transaction goes next. The split
+transaction bus frees itself after the request of a read that the memory
+serves: the memory holds the reads of several cores, and sends the block of
+each one to its originator once the latency has elapsed and the bus has no
+other data to move. The caches snoop the request, and a transaction of a
+block with a read in the memory waits until that read is done, so the
+caches see the transactions of each block in the order of their requests.
+
 *****************************************************************************/
 
 // include the necessary header files
@@ -12,140 +22,116 @@ Implementation of the BUS functionality.
 #include <stdio.h>
 
 #include "../headers/BusController.h"
-#include "../headers/FilesManager.h"
 #include "../headers/sim.h" 
 #include "../headers/CacheController.h"
 
-/* structs definitions */
-
-// structs
-/**********************************************************************************/
-// mem_adder - Represents the address of a memory block
-typedef struct {
-    // used to track the main memory performance
-    uint8_t offset : 2;  // 2 bits for index, 4 words per block
-    uint32_t block : 18;  // 18 bits left for block
-} AddressFields;
-
-typedef union {
-    uint32_t address;       // Raw 20-bit address
-    AddressFields fields;   // Decomposed fields
-} MemoryAddress;
-// state_of_transaction - Enumerates the states of a bus transaction
-typedef enum
-{
-	idle,
-	wait_cmd,
-	operation,
-	finally,
-} state_of_transaction;
-
-
-// queue_for_bus - Represents a queue for bus transactions
-typedef struct _queue_for_bus
-{
-	bus_transaction item;
-	struct _queue_for_bus* prev;
-	struct _queue_for_bus* next;
-} queue_for_bus;
-/**********************************************************************************/
-
-
-/* variables definitions */
-/**********************************************************************************/
-static Bus_core_cache gCoreCache[NUM_OF_CORES];
-
-// callbacks functions
-static SharedData_Callback	gSharedData_Callback;
-static SnoopingCache_Callback	gSnoopingCache_Callback;
-static GetCacheResponse_Callback	gGetCacheResponse_Callback;
-static Mem_Callback		gMemCallback;
-
-// global variables
-static bool gIsBusTransactionActive;
-static state_of_transaction gTransactionStatePerCore[NUM_OF_CORES] = { 0, 0, 0, 0 };
-static bus_transaction gOngoingTransaction;
-static uint8_t gBusAddrOffset;
-static uint32_t iterationCount = 0;
-
-// bus fifo queue variables
-static queue_for_bus* head_of_queue;
-static queue_for_bus* tail_of_queue;
-
-/**********************************************************************************/
-
 // functions declarations
 /**********************************************************************************/
-bool is_queue_empty(void);
-bool queue_enqueue(bus_transaction item);
-bool queue_dequeue(bus_transaction* item);
-
-static void print_to_bustrace(bus_transaction TransactionPacket);
-static bool is_any_cache_snoop(bus_transaction* TransactionPacket);
-static bool is_shared_line(bus_transaction* TransactionPacket, bool* is_data_modified);
+bool is_queue_empty(Bus_Controller* bus);
+bool queue_enqueue(Bus_Controller* bus, bus_transaction item);
+bool queue_dequeue(Bus_Controller* bus, uint32_t core, bus_transaction* item);
+
+static void print_to_bustrace(Bus_Controller* bus, bus_transaction TransactionPacket);
+static void drain_submission_slots(Bus_Controller* bus);
+static bool is_any_cache_snoop(Bus_Controller* bus, bus_transaction* TransactionPacket);
+static bool is_shared_line(Bus_Controller* bus, bus_transaction* TransactionPacket, bool* is_data_modified);
+static void start_prefetch(Bus_Controller* bus);
+static uint64_t caches_of_block(Bus_Controller* bus, uint32_t address, bool is_query);
+static bool start_response(Bus_Controller* bus);
+static bool is_read_in_flight(Bus_Controller* bus, uint32_t address);
+static uint32_t cycles_to_next_response(Bus_Controller* bus);
+static bool is_delay_after_block(Bus_Controller* bus);
+static uint32_t next_core_of_queue(Bus_Controller* bus);
 
 /**********************************************************************************/
 
 
-// Implemantation of the bus fifo queue for transactions
+// Implemantation of the bus fifo queues for transactions, one per core
 /**********************************************************************************/
-/* check whether the queu is empty */
-bool is_queue_empty(void)
+/* check whether the queues are empty */
+bool is_queue_empty(Bus_Controller* bus)
 {
-    bool isempty = head_of_queue == NULL;
+    bool isempty = bus->queued_transactions == 0;
 	return isempty;
 }
 
-/* enqueue a transaction to the queue */
-bool queue_enqueue(bus_transaction transaction)
+/* enqueue a transaction to the queue of the core that submitted it, in an entry of the pool */
+bool queue_enqueue(Bus_Controller* bus, bus_transaction transaction)
 {
-	queue_for_bus* item = malloc(sizeof(queue_for_bus));
-	if (item == NULL) { // if the allocation failed then return false
+	queue_for_bus* item = bus->free_entries;
+	if (item == NULL) { // if the pool is used up then return false, the slots are drained only when it has room
 		return false;
 	}
+	bus->free_entries = item->next;
 
+	// a delay packet carries no originator, it goes to the queue of the core that sent it, after its transaction
+	uint32_t core = (transaction.origid == invalid_caller) ? transaction.original_caller : transaction.origid;
 	item->prev = NULL;
 	item->next = NULL;
 	item->item = transaction;
-
-	if (is_queue_empty())
-	{ // if the queue is empty then the head and tail are the same
-		head_of_queue = item;
-		tail_of_queue = item;
+	item->queued_iteration = bus->iteration_count;
+	if (transaction.origid < bus->num_of_cores)
+		bus->queued_per_core[transaction.origid]++;
+	bus->queued_transactions++;
+
+	if (bus->head_of_queue[core] == NULL)
+	{ // if the queue is empty then the head and tail are the same, and the core starts to request the bus
+		bus->head_of_queue[core] = item;
+		bus->tail_of_queue[core] = item;
+		BusArbiter_Request(&bus->arbiter, core, item->queued_iteration);
 	}
 	else
 	{ // if the queue is not empty then the new item is the head
-		head_of_queue->prev = item;
-		item->next = head_of_queue;
-		head_of_queue = item;
+		bus->head_of_queue[core]->prev = item;
+		item->next = bus->head_of_queue[core];
+		bus->head_of_queue[core] = item;
 	}
 	return true;
 }
 
-/* dequeue a transaction from the queue */
-bool queue_dequeue(bus_transaction* transaction)
+/* dequeue the oldest transaction from the queue of the core */
+bool queue_dequeue(Bus_Controller* bus, uint32_t core, bus_transaction* transaction)
 {
-	if (tail_of_queue == NULL) { // if the queue is empty then return false
+	if (bus->tail_of_queue[core] == NULL) { // if the queue is empty then return false
 		return false;
 	}
 
 	// get the item from the tail of the queue and update the tail to the previous item
-	queue_for_bus* item = tail_of_queue;
-	tail_of_queue = item->prev;
+	queue_for_bus* item = bus->tail_of_queue[core];
+	bus->tail_of_queue[core] = item->prev;
 
-	if (tail_of_queue == NULL) { 
-		head_of_queue = NULL;
+	if (bus->tail_of_queue[core] == NULL) { 
+		bus->head_of_queue[core] = NULL;
 	}
 	else
-		tail_of_queue->next = NULL;
+		bus->tail_of_queue[core]->next = NULL;
 
-	item->prev = NULL;
 	*transaction = item->item;
+	bus->queued_transactions--;
+	if (transaction->origid < bus->num_of_cores)
+	{ // the delay packets are not counted
+		bus->queued_per_core[transaction->origid]--;
+	}
+	uint32_t next_head_iteration = (bus->tail_of_queue[core] == NULL) ? BUS_ARBITER_NO_REQUEST : bus->tail_of_queue[core]->queued_iteration;
+	BusArbiter_Grant(&bus->arbiter, core, bus->iteration_count, next_head_iteration, transaction->origid != invalid_caller);
 
-	free(item);
+	// return the entry to the pool
+	item->prev = NULL;
+	item->next = bus->free_entries;
+	bus->free_entries = item;
 	return true;
 }
 
+/* the core whose transaction goes next on the bus: the delay packet of a busRdX right after its transaction,
+   otherwise the choice of the arbiter. BUS_ARBITER_NO_REQUEST if the queues are empty */
+static uint32_t next_core_of_queue(Bus_Controller* bus)
+{
+	uint32_t last_core = bus->arbiter.last_core;
+	if (bus->tail_of_queue[last_core] != NULL && bus->tail_of_queue[last_core]->item.origid == invalid_caller)
+		return last_core;
+	return BusArbiter_Pick(&bus->arbiter);
+}
+
 /**********************************************************************************/
 
 
@@ -153,69 +139,335 @@ bool queue_dequeue(bus_transaction* transaction)
 /**********************************************************************************/
 
 /* print info of the bus stats: iteration number, originator id, command, address, data, shared */
-static void print_to_bustrace(bus_transaction TransactionPacket)
+static void print_to_bustrace(Bus_Controller* bus, bus_transaction TransactionPacket)
 {
-	fprintf(BusTrace, "%d %d %d %05X %08X %d\n", iterationCount, TransactionPacket.origid, TransactionPacket.bus_cmd, 
+	// the main memory is numbered right after the last core
+	uint32_t origid = (TransactionPacket.origid == main_memory) ? bus->num_of_cores : (uint32_t)TransactionPacket.origid;
+	Trace_WriteBus(bus->trace, bus->iteration_count, origid, TransactionPacket.bus_cmd, 
 		TransactionPacket.bus_addr, TransactionPacket.bus_data, TransactionPacket.bus_shared);
 }
 
-/* check if any cache has a response for the bus transaction */
-static bool is_any_cache_snoop(bus_transaction* TransactionPacket)
+/* move the transactions submitted by the cores to their queues. the transactions of a slot are queued together
+   (a busRdX with its delay), and a slot without room waits, as do the slots after it, so that the first core
+   that waited for room is the first one to get it */
+static void drain_submission_slots(Bus_Controller* bus)
+{
+	uint32_t first_blocked = bus->num_of_cores;
+	for (uint32_t k = 0; k < bus->num_of_cores; k++)
+	{
+		uint32_t i = (bus->drain_first + k) % bus->num_of_cores;
+		bus_submission_slot* slot = &bus->submission_slots[i];
+		if (slot->count == 0)
+			continue;
+		if (first_blocked < bus->num_of_cores || bus->queue_capacity - bus->queued_transactions < slot->count)
+		{
+			first_blocked = (first_blocked < bus->num_of_cores) ? first_blocked : i;
+			bus->is_submission_blocked[i] = true;
+			continue;
+		}
+		for (uint32_t j = 0; j < slot->count; j++)
+			queue_enqueue(bus, slot->items[j]);
+		slot->count = 0;
+		bus->is_submission_blocked[i] = false;
+	}
+	if (first_blocked < bus->num_of_cores)
+		bus->drain_first = first_blocked;
+}
+
+/* the caches a transaction of the address is sent to, in core id order: every cache without a directory,
+   otherwise the caches that hold the block. the shared query of the snooping bus also goes to the caches
+   with a dirty line in the set of the block, which answer that it is modified */
+static uint64_t caches_of_block(Bus_Controller* bus, uint32_t address, bool is_query)
+{
+	bus->snoop_rounds++;
+	if (bus->directory == NULL)
+		return (bus->num_of_cores == 64) ? UINT64_MAX : ((1ull << bus->num_of_cores) - 1);
+	uint64_t caches = Directory_Sharers(bus->directory, address);
+	if (is_query && !bus->directory_coherence)
+		caches |= Directory_DirtyCaches(bus->directory, address);
+	return caches;
+}
+
+/* check if any cache has a response for the bus transaction.
+   every cache snoops the requested command, the copy of the cache that supplies the data replaces the transaction
+   (with MOESI an Owned block has Shared copies, which must still see the busRdX after the owner answered) */
+static bool is_any_cache_snoop(Bus_Controller* bus, bus_transaction* TransactionPacket)
 {
 	bool is_there_responding = false;
+	bus_transaction requested = *TransactionPacket;
 
-	for (int i = 0; i < NUM_OF_CORES; i++)
-		is_there_responding = is_there_responding | gSnoopingCache_Callback(gCoreCache[i].bus_cache_data, TransactionPacket, gBusAddrOffset);
+	uint64_t caches = caches_of_block(bus, requested.bus_addr, false);
+	while (caches != 0)
+	{
+		uint32_t i = Directory_TakeSharer(&caches);
+		bus->snoop_calls[i]++;
+		bus_transaction snooped = requested;
+		is_there_responding = is_there_responding | bus->snooping_cache_callback(bus->core_cache[i].bus_cache_data, &snooped, bus->addr_offset);
+		if (snooped.bus_cmd != requested.bus_cmd || snooped.origid != requested.origid || snooped.bus_data != requested.bus_data)
+			*TransactionPacket = snooped;
+	}
 	
 	return is_there_responding;
 }
 
 
-/* determinate if the current transaction involves shared data across cores */
-static bool is_shared_line(bus_transaction* TransactionPacket, bool* is_data_modified)
+/* determinate if the current transaction involves shared data across cores.
+   with a directory the result is computed once per transaction, and again only after a cache line changed */
+static bool is_shared_line(Bus_Controller* bus, bus_transaction* TransactionPacket, bool* is_data_modified)
 {
 	bool is_shared = false;
 	bool call_back_result = false;
 
-	for (int i = 0; i < NUM_OF_CORES; i++){
-		//((Cache_Data*)(gCoreCache[i].bus_cache_data))->id = gCoreCache[i].core_id;
-		call_back_result = gSharedData_Callback(gCoreCache[i].bus_cache_data, TransactionPacket, is_data_modified);
+	if (bus->directory != NULL && bus->is_shared_result_valid && bus->shared_result_version == bus->directory->version)
+	{
+		bus->snoop_rounds++;
+		*is_data_modified |= bus->modified_result;
+		return bus->shared_result;
+	}
+
+	bool is_modified = false;
+	uint64_t caches = caches_of_block(bus, TransactionPacket->bus_addr, true);
+	if (bus->directory != NULL && TransactionPacket->origid < bus->num_of_cores)
+		caches &= ~(1ull << TransactionPacket->origid); // the cache of the originator doesn't answer
+	while (caches != 0){
+		uint32_t i = Directory_TakeSharer(&caches);
+		bus->snoop_calls[i]++;
+		call_back_result = bus->shared_data_callback(bus->core_cache[i].bus_cache_data, TransactionPacket, &is_modified);
 		is_shared |= call_back_result;
 	}
+
+	if (bus->directory != NULL)
+	{
+		bus->is_shared_result_valid = true;
+		bus->shared_result_version = bus->directory->version;
+		bus->shared_result = is_shared;
+		bus->modified_result = is_modified;
+	}
+	*is_data_modified |= is_modified;
 	return is_shared;
 }
+
+/* give the split bus to the read whose block the memory has ready, its words are sent from this iteration.
+   the caches snooped its request already */
+static bool start_response(Bus_Controller* bus)
+{
+	if (!bus->mem_response_callback(bus->memory, bus->iteration_count, &bus->ongoing_transaction))
+		return false;
+
+	bus->is_transaction_active = true;
+	bus->is_response = true;
+	bus->is_first_access_shared = false; // the block follows the request that was already on the bus
+	bus->is_shared_result_valid = false;
+	bus->addr_offset = 0;
+	return true;
+}
+
+/* check if a core has a read of the block of the address in the memory */
+static bool is_read_in_flight(Bus_Controller* bus, uint32_t address)
+{
+	uint32_t block = Address_Word(&bus->layout, address, 0);
+	for (uint32_t i = 0; i < bus->num_of_cores; i++)
+	{
+		if (bus->read_in_flight[i] == block)
+			return true;
+	}
+	return false;
+}
+
+/* check if the split bus leaves the iteration after the block of a read to its core: for the delay packet of a busRdX,
+   and when the next transaction in the queue is of the same block, which would take the block before the core used it */
+static bool is_delay_after_block(Bus_Controller* bus)
+{
+	uint32_t core = bus->ongoing_transaction.origid;
+	bool is_delay = bus->is_delay_after_read[core];
+	bus->is_delay_after_read[core] = false;
+	uint32_t next_core = next_core_of_queue(bus);
+	if (next_core != BUS_ARBITER_NO_REQUEST && bus->tail_of_queue[next_core]->item.origid != invalid_caller)
+		is_delay |= Address_Word(&bus->layout, bus->tail_of_queue[next_core]->item.bus_addr, 0) == Address_Word(&bus->layout, bus->ongoing_transaction.bus_addr, 0);
+	return is_delay;
+}
+
+/* number of coming iterations in which the split bus has nothing to do but wait for the first read of the memory */
+static uint32_t cycles_to_next_response(Bus_Controller* bus)
+{
+	// a queued transaction or a prefetch may use the free bus
+	if (bus->is_transaction_active || !is_queue_empty(bus) || bus->prefetch_callback != NULL)
+		return 0;
+	for (uint32_t i = 0; i < bus->num_of_cores; i++)
+	{
+		if (bus->submission_slots[i].count != 0)
+			return 0;
+	}
+
+	uint32_t ready_iteration = bus->mem_next_response_callback(bus->memory, bus->iteration_count);
+	if (ready_iteration == UINT32_MAX || ready_iteration <= bus->iteration_count + 1)
+		return 0;
+	return ready_iteration - bus->iteration_count - 1;
+}
+
+/* on a free bus cycle, let the first cache that has a prefetch submit it, starting after the last one served.
+   the cores are not running during the bus iteration, so the cache may write to the submission slot of its core */
+static void start_prefetch(Bus_Controller* bus)
+{
+	if (bus->prefetch_callback == NULL)
+		return;
+
+	for (uint32_t i = 0; i < bus->num_of_cores; i++)
+	{
+		uint32_t core = (bus->prefetch_next + i) % bus->num_of_cores;
+		if (bus->prefetch_callback(bus->core_cache[core].bus_cache_data))
+		{
+			bus->prefetch_next = (core + 1) % bus->num_of_cores;
+			return;
+		}
+	}
+}
 /**********************************************************************************/
 
 
 /* Implementation of the bus functionality */
 /**********************************************************************************/
+/* allocate the per-core state of the bus and the pool of the queues, queue_capacity 0 leaves room for a miss of every core */
+bool Bus_Init(Bus_Controller* bus, uint32_t num_of_cores, uint32_t block_words, const Bus_Arbiter_Config* arbiter_config,
+			  uint32_t queue_capacity, Trace_Stream* trace)
+{
+	memset(bus, 0, sizeof(Bus_Controller));
+	bus->num_of_cores = num_of_cores;
+	if (!AddressLayout_Init(&bus->layout, block_words, 1))
+		return false;
+	bus->trace = trace;
+	bus->is_first_access_shared = true;
+	bus->core_cache = calloc(num_of_cores, sizeof(Bus_core_cache));
+	bus->transaction_state_per_core = calloc(num_of_cores, sizeof(state_of_transaction));
+	bus->queued_per_core = calloc(num_of_cores, sizeof(uint32_t));
+	bus->submission_slots = calloc(num_of_cores, sizeof(bus_submission_slot));
+	bus->snoop_calls = calloc(num_of_cores, sizeof(uint32_t));
+	bus->read_in_flight = malloc(num_of_cores * sizeof(uint32_t));
+	bus->is_delay_after_read = calloc(num_of_cores, sizeof(bool));
+	bus->head_of_queue = calloc(num_of_cores, sizeof(queue_for_bus*));
+	bus->tail_of_queue = calloc(num_of_cores, sizeof(queue_for_bus*));
+	bus->is_submission_blocked = calloc(num_of_cores, sizeof(bool));
+	bus->queue_capacity = (queue_capacity == 0) ? BUS_ENTRIES_PER_MISS * num_of_cores : queue_capacity;
+	bus->queue_pool = calloc(bus->queue_capacity, sizeof(queue_for_bus));
+	bus->ongoing_transaction.origid = invalid_caller;
+	if (bus->read_in_flight != NULL)
+	{
+		for (uint32_t i = 0; i < num_of_cores; i++)
+			bus->read_in_flight[i] = NO_READ_IN_FLIGHT;
+	}
+	for (uint32_t i = 0; bus->queue_pool != NULL && i < bus->queue_capacity; i++)
+	{
+		bus->queue_pool[i].next = bus->free_entries;
+		bus->free_entries = &bus->queue_pool[i];
+	}
+	return bus->core_cache != NULL && bus->transaction_state_per_core != NULL && bus->queued_per_core != NULL && bus->submission_slots != NULL && bus->snoop_calls != NULL &&
+		bus->read_in_flight != NULL && bus->is_delay_after_read != NULL && bus->head_of_queue != NULL && bus->tail_of_queue != NULL &&
+		bus->is_submission_blocked != NULL && bus->queue_pool != NULL && BusArbiter_Init(&bus->arbiter, arbiter_config, num_of_cores);
+}
+
+/* release the per-core state of the bus and the pool of the queues */
+void Bus_Shutdown(Bus_Controller* bus)
+{
+	free(bus->core_cache);
+	free(bus->transaction_state_per_core);
+	free(bus->queued_per_core);
+	free(bus->submission_slots);
+	free(bus->snoop_calls);
+	free(bus->read_in_flight);
+	free(bus->is_delay_after_read);
+	free(bus->head_of_queue);
+	free(bus->tail_of_queue);
+	free(bus->is_submission_blocked);
+	free(bus->queue_pool);
+	BusArbiter_Free(&bus->arbiter);
+	bus->core_cache = NULL;
+	bus->transaction_state_per_core = NULL;
+	bus->queued_per_core = NULL;
+	bus->submission_slots = NULL;
+	bus->snoop_calls = NULL;
+	bus->read_in_flight = NULL;
+	bus->is_delay_after_read = NULL;
+	bus->head_of_queue = NULL;
+	bus->tail_of_queue = NULL;
+	bus->is_submission_blocked = NULL;
+	bus->queue_pool = NULL;
+	bus->free_entries = NULL;
+	bus->queued_transactions = 0;
+}
+
 /* register the cache interface */
-void Bus_InitializeCache(Bus_core_cache cache_info)
+void Bus_InitializeCache(Bus_Controller* bus, Bus_core_cache cache_info)
 {
-	gCoreCache[cache_info.core_id] = cache_info;
+	bus->core_cache[cache_info.core_id] = cache_info;
 }
 
 /* register the callbacks for the bus */
-void ConfigureCacheCallbacks_for_bus(SharedData_Callback first_callback,
+void ConfigureCacheCallbacks_for_bus(Bus_Controller* bus,
+								SharedData_Callback first_callback,
 								SnoopingCache_Callback second_callback,
 								GetCacheResponse_Callback third_callback)
 {
-	gSharedData_Callback = first_callback;
-	gSnoopingCache_Callback = second_callback;
-	gGetCacheResponse_Callback = third_callback;
+	bus->shared_data_callback = first_callback;
+	bus->snooping_cache_callback = second_callback;
+	bus->get_cache_response_callback = third_callback;
+}
+
+/* register the callback that gives the prefetches of a cache */
+void ConfigurePrefetchCallback_for_bus(Bus_Controller* bus, Prefetch_Callback callback)
+{
+	bus->prefetch_callback = callback;
 }
 
 /* register the memory callback */
-void ConfigureMemoryCallback_for_bus(Mem_Callback callback)
+void ConfigureMemoryCallback_for_bus(Bus_Controller* bus, void* memory, Mem_Callback callback)
+{
+	bus->memory = memory;
+	bus->mem_callback = callback;
+}
+
+/* send the transactions only to the caches that the directory lists as holding the block.
+   without directory_coherence the directory is a snoop filter, the caches answer as on a snooping bus */
+void ConfigureDirectory_for_bus(Bus_Controller* bus, Directory* directory, bool directory_coherence)
+{
+	bus->directory = directory;
+	bus->directory_coherence = directory_coherence;
+}
+
+/* register the memory callbacks that hold the reads of the split bus */
+void ConfigureSplitMemoryCallbacks_for_bus(Bus_Controller* bus, MemRequest_Callback request_callback,
+								MemResponse_Callback response_callback, MemNextResponse_Callback next_response_callback)
+{
+	bus->mem_request_callback = request_callback;
+	bus->mem_response_callback = response_callback;
+	bus->mem_next_response_callback = next_response_callback;
+}
+
+/* separate the request of the reads that the memory serves from the transfer of their block */
+void ConfigureSplitTransactions_for_bus(Bus_Controller* bus, bool split_transactions)
+{
+	bus->split_transactions = split_transactions;
+}
+
+/* register the memory timing callbacks used to fast forward the memory latency */
+void ConfigureMemoryTimingCallbacks_for_bus(Bus_Controller* bus, MemLatency_Callback latency_callback, MemSkip_Callback skip_callback)
 {
-	gMemCallback = callback;
+	bus->mem_latency_callback = latency_callback;
+	bus->mem_skip_callback = skip_callback;
 }
 
-/* add a new transaction to the bus transaction queue */
-void AddTransaction_to_bus(bus_transaction transaction)
+/* add a new transaction to the submission slot of its core, the bus queues it on its next iteration */
+void AddTransaction_to_bus(Bus_Controller* bus, bus_transaction transaction)
 {
-	// add the transaction to the queue
-	queue_enqueue(transaction);
+	// a delay packet carries no originator, it goes to the slot of the core that sent it
+	Bus_transaction_caller submitter = (transaction.origid == invalid_caller) ? transaction.original_caller : transaction.origid;
+	bus_submission_slot* slot = &bus->submission_slots[submitter];
+	if (slot->count >= SUBMISSION_SLOT_SIZE)
+	{
+		// the core submitted while its miss was pending, dropping the transaction would leave it waiting forever
+		printf("Error: Core %d submitted more than %d transactions to the bus at once\n", submitter, SUBMISSION_SLOT_SIZE);
+		abort();
+	}
+	slot->items[slot->count++] = transaction;
 
 	// if the transaction is invalid then return
 	if (transaction.origid == invalid_caller){
@@ -223,112 +475,243 @@ void AddTransaction_to_bus(bus_transaction transaction)
 	}
 
 	// set the state of the transaction initiated by the specified core to waiting
-	gTransactionStatePerCore[transaction.origid] = wait_cmd;
+	bus->transaction_state_per_core[transaction.origid] = wait_cmd;
 }
 
 /* check if the bus is currently in transaction */
-bool IsBusInTransaction(Bus_transaction_caller initiator)
+bool IsBusInTransaction(Bus_Controller* bus, Bus_transaction_caller initiator)
 {
 
-	return gTransactionStatePerCore[initiator] != idle;
+	return bus->transaction_state_per_core[initiator] != idle;
 }
 
 /* check if the bus is waiting for a transaction */
-bool IsBusWaitForTransaction(Bus_transaction_caller initiator)
+bool IsBusWaitForTransaction(Bus_Controller* bus, Bus_transaction_caller initiator)
+{
+
+	return bus->transaction_state_per_core[initiator] == wait_cmd;
+}
+
+/* check if the transaction of the core is still waiting in the queue or running on the bus */
+bool IsBusTransactionPending(Bus_Controller* bus, Bus_transaction_caller initiator)
 {
 
-	return gTransactionStatePerCore[initiator] == wait_cmd;
+	return bus->transaction_state_per_core[initiator] == wait_cmd || bus->transaction_state_per_core[initiator] == operation;
+}
+
+/* check if the transactions of the core wait in its slot for room in the queues */
+bool IsBusQueueFull(Bus_Controller* bus, Bus_transaction_caller initiator)
+{
+	return bus->is_submission_blocked[initiator];
 }
 
 /* iterate the bus */
-void Run_Bus_Iteration(void)
+void Run_Bus_Iteration(Bus_Controller* bus)
 {
-	// Track whether this is the first time a shared line is detected for the current transaction.
-	static bool is_first_access_shared = true;
-	
 	// increment the iteration counter
-	iterationCount++;
+	bus->iteration_count++;
+
+	// queue the transactions the cores submitted in the last cycle
+	drain_submission_slots(bus);
 		
-	// if the transaction is finally done then set the state of the core to idle
-	if (gTransactionStatePerCore[gOngoingTransaction.origid] == finally)
-		gTransactionStatePerCore[gOngoingTransaction.origid] = idle;
+	// if the transaction is finally done then set the state of the core to idle, or to waiting when the core queued
+	// another one (the read after the flush of an eviction), which the split bus may not start in this iteration
+	if (bus->ongoing_transaction.origid < bus->num_of_cores && bus->transaction_state_per_core[bus->ongoing_transaction.origid] == finally)
+		bus->transaction_state_per_core[bus->ongoing_transaction.origid] = (bus->queued_per_core[bus->ongoing_transaction.origid] > 0) ? wait_cmd : idle;
 
-	// if the queue is empty and there is no ongoing transaction then return
-	if (is_queue_empty() && !gIsBusTransactionActive)
+	// the core of a split read may use its block in this iteration before the bus goes on
+	if (bus->is_block_sent)
 	{
+		bus->is_block_sent = false;
+		if (is_delay_after_block(bus))
+			return;
+	}
+
+	// the split bus sends the block of a ready read when no transaction holds it
+	if (bus->split_transactions && !bus->is_transaction_active)
+		start_response(bus);
+
+	// if the queue is empty and there is no ongoing transaction then return, the free cycle lets a cache submit a prefetch
+	if (is_queue_empty(bus) && !bus->is_transaction_active)
+	{
+		start_prefetch(bus);
+
 		// Mark the current transaction as invalid, indicating no active one.
-		gOngoingTransaction.origid = invalid_caller;
+		bus->ongoing_transaction.origid = invalid_caller;
 		return;
 	}
 
 	// If no transaction is currently in progress, start processing the next one.
-	if (!gIsBusTransactionActive)
+	if (!bus->is_transaction_active)
 	{
+		// The arbiter picks the core whose transaction goes next.
+		// On the split bus a transaction of a block whose read is in the memory holds the bus until the read is done.
+		uint32_t next_core = next_core_of_queue(bus);
+		if (bus->split_transactions && bus->tail_of_queue[next_core]->item.origid != invalid_caller &&
+			is_read_in_flight(bus, bus->tail_of_queue[next_core]->item.bus_addr))
+			return;
+
 		// Reset the shared-line detection flag for the new transaction.
-		is_first_access_shared = true;
+		bus->is_first_access_shared = true;
+		bus->is_shared_result_valid = false;
 
 		// Store the previous originator ID.
-		int previous_origid = gOngoingTransaction.origid;
+		int previous_origid = bus->ongoing_transaction.origid;
 		
-		// Dequeue the next transaction from the queue.
-		if (!queue_dequeue(&gOngoingTransaction) || gOngoingTransaction.origid == invalid_caller)
+		// Dequeue the next transaction from the queue of its core.
+		if (!queue_dequeue(bus, next_core, &bus->ongoing_transaction))
 			return;
+		if (bus->ongoing_transaction.origid == invalid_caller)
+		{
+			// On the split bus the delay of a busRdX whose block isn't sent yet comes after the block.
+			Bus_transaction_caller submitter = bus->ongoing_transaction.original_caller;
+			if (bus->split_transactions && bus->read_in_flight[submitter] != NO_READ_IN_FLIGHT)
+				bus->is_delay_after_read[submitter] = true;
+			return;
+		}
 
 		// Set the original sender of the transaction to the current originator.
-		gOngoingTransaction.original_caller = gOngoingTransaction.origid;
+		bus->ongoing_transaction.original_caller = bus->ongoing_transaction.origid;
 
 		// Mark the bus as busy and update the state of the current transaction to "operation".
-		gIsBusTransactionActive = true;
-		gTransactionStatePerCore[gOngoingTransaction.origid] = operation;
+		bus->is_transaction_active = true;
+		bus->transaction_state_per_core[bus->ongoing_transaction.origid] = operation;
 
 		// Reset the address offset for the transaction (used for block-wise memory access).
-		gBusAddrOffset = 0;
+		bus->addr_offset = 0;
 
 		// print to the bus trace
-		print_to_bustrace(gOngoingTransaction);
+		print_to_bustrace(bus, bus->ongoing_transaction);
 	}
 
 	bus_transaction transaction;
-	memcpy(&transaction, &gOngoingTransaction, sizeof(gOngoingTransaction));
+	memcpy(&transaction, &bus->ongoing_transaction, sizeof(bus->ongoing_transaction));
 
 	// Update the memory address for the current transaction.
-	MemoryAddress address = { .address = gOngoingTransaction.bus_addr };
-	address.fields.offset = gBusAddrOffset;
-	transaction.bus_addr = address.address;
+	transaction.bus_addr = Address_Word(&bus->layout, bus->ongoing_transaction.bus_addr, bus->addr_offset);
 
 	// Check if the current transaction involves shared data across cores.
 	bool is_data_modified = false;
-	transaction.bus_shared = is_shared_line(&gOngoingTransaction, &is_data_modified);
+	transaction.bus_shared = is_shared_line(bus, &bus->ongoing_transaction, &is_data_modified);
 
 
+	// On the split bus a read that the memory serves leaves the bus after its request. The caches snoop
+	// the request now and the memory keeps it until the block is ready.
+	if (bus->split_transactions && bus->is_first_access_shared && !is_data_modified &&
+		(transaction.bus_cmd == busRd || transaction.bus_cmd == busRdX))
+	{
+		is_any_cache_snoop(bus, &transaction);
+		bus->mem_request_callback(bus->memory, &bus->ongoing_transaction, bus->iteration_count); // room for a read per core
+		bus->read_in_flight[bus->ongoing_transaction.origid] = Address_Word(&bus->layout, transaction.bus_addr, 0);
+		bus->is_transaction_active = false;
+		return;
+	}
+
 	// If the data is modified and this is the first time a shared line is detected, skip the current iteration.
-	if (is_data_modified && is_first_access_shared)
+	// The other transactions of the split bus move their words right after the iteration of their request.
+	if ((is_data_modified || bus->split_transactions) && bus->is_first_access_shared)
 	{
-		is_first_access_shared = false;
+		bus->is_first_access_shared = false;
 		return;
 	}
 
-	// Perform cache snooping for the current transaction, checking if any cache responds.
-	bool cache_response  = is_any_cache_snoop(&transaction);
+	// Perform cache snooping for the current transaction. While the memory only counts its latency
+	// the snoops were already applied on the first iteration of the transaction and would not 
+	// change any cache, so the caches are not queried again.
+	// The block of a split read needs no snoop, its request was snooped.
+	if (!bus->is_response && Bus_CyclesToNextEvent(bus) == 0)
+		is_any_cache_snoop(bus, &transaction);
 
 	// Send the transaction to memory and check if there is a memory response.
-	bool memory_response = gMemCallback(&transaction, is_data_modified);
+	// The split bus writes the flushes at once, the reads already waited for their latency.
+	bool memory_response = bus->mem_callback(bus->memory, &transaction, is_data_modified || bus->split_transactions, bus->iteration_count);
 	
 	// If memory responds, handle it.
 	if (memory_response)
 	{
 		// print to the bus trace
-		print_to_bustrace(transaction);
+		print_to_bustrace(bus, transaction);
 
 		
 		// Send the response back to the originating cache via the response callback.
-		if (gGetCacheResponse_Callback(gCoreCache[gOngoingTransaction.origid].bus_cache_data, &transaction,&gBusAddrOffset))
+		if (bus->get_cache_response_callback(bus->core_cache[bus->ongoing_transaction.origid].bus_cache_data, &transaction,&bus->addr_offset))
 		{
 			// If the response was successful, mark the transaction as "finally" and clear the bus active flag.
-			gTransactionStatePerCore[gOngoingTransaction.origid] = finally;
-			gIsBusTransactionActive = false;
+			bus->transaction_state_per_core[bus->ongoing_transaction.origid] = finally;
+			bus->is_transaction_active = false;
+			if (bus->is_response)
+			{
+				bus->read_in_flight[bus->ongoing_transaction.origid] = NO_READ_IN_FLIGHT;
+				bus->is_response = false;
+				bus->is_block_sent = true;
+			}
 		}
 	}
 }
 
+/* check if the bus has no transaction queued, submitted or running */
+bool Bus_IsIdle(Bus_Controller* bus)
+{
+	if (!is_queue_empty(bus) || bus->is_transaction_active)
+		return false;
+
+	for (uint32_t i = 0; i < bus->num_of_cores; i++)
+	{
+		if (bus->submission_slots[i].count != 0 || bus->transaction_state_per_core[i] != idle)
+			return false;
+	}
+	return true;
+}
+
+/* number of coming iterations in which the bus only waits for the memory latency */
+uint32_t Bus_CyclesToNextEvent(Bus_Controller* bus)
+{
+	if (bus->split_transactions)
+		return cycles_to_next_response(bus);
+
+	// The snoops of a transaction are applied on its first iteration, after that, 
+	// the iterations until the memory responds don't change any state but the counters.
+	if (!bus->is_transaction_active || bus->mem_latency_callback == NULL)
+		return 0;
+
+	return bus->mem_latency_callback(bus->memory);
+}
+
+/* advance the bus over iterations in which it only waits for the memory latency */
+void Bus_FastForward(Bus_Controller* bus, uint32_t cycles)
+{
+	bus->iteration_count += cycles;
+	bus->mem_skip_callback(bus->memory, cycles);
+}
+
+/* number of shared queries and snoops that called the cache of the core */
+uint32_t Bus_SnoopsReceived(Bus_Controller* bus, uint32_t core)
+{
+	return bus->snoop_calls[core];
+}
+
+/* number of shared queries and snoops that a broadcast would have sent to the cache of the core, and the directory didn't */
+uint32_t Bus_SnoopsFiltered(Bus_Controller* bus, uint32_t core)
+{
+	return bus->snoop_rounds - bus->snoop_calls[core];
+}
+
+/* number of transactions of the core that the arbiter granted */
+uint32_t Bus_TransactionsStarted(Bus_Controller* bus, uint32_t core)
+{
+	return BusArbiter_Grants(&bus->arbiter, core);
+}
+
+/* number of bus iterations that the transactions of the core waited in its queue */
+uint64_t Bus_QueueCycles(Bus_Controller* bus, uint32_t core)
+{
+	return BusArbiter_WaitCycles(&bus->arbiter, core);
+}
+
+/* print the longest wait and the histogram of the waits of the transactions of the core */
+void Bus_PrintQueueWaits(Bus_Controller* bus, uint32_t core, FILE* file)
+{
+	BusArbiter_PrintWaits(&bus->arbiter, core, file);
+}
+
 /**********************************************************************************/
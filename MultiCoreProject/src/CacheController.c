@@ -8,11 +8,31 @@ This file contains the implementation of cache operations, including read, write
 and coherency management using the MESI protocol. The cache interacts with the 
 Bus and Main Memory to ensure data consistency.
 
-Each core have a direct mapped cache, it size is 256 words, each block contain 4 words, there are 256/4 = 64 blocks.
+Each core have a cache of 256 words, each block contain 4 words, there are 256/4 = 64 blocks.
+The size (64 to 64K words) and the block (1 to 32 words) are set at run time, the
+SRAMs are allocated by CacheController_Init.
+The blocks are grouped in sets of 1 (direct mapped, the default) to 64 ways, the
+replacement policy chooses the way a miss evicts when the whole set is valid.
 The cache is write back and write allocate.
 The cach use 2 SRAMS: 
 1- DRAM: 32 bits width and 256 words depth for data.
 2- TSRAM: contains 64 lines, each line contain tag and state of the MESI protocol.
+Line n of both SRAMs is way (n % ways) of set (n / ways).
+
+An optional victim buffer of 1 to 16 fully associative lines follows the lines of
+the sets in both SRAMs. A valid line that a miss evicts moves into the buffer, and
+a miss that finds its block in the buffer swaps the two lines back without a bus
+transaction. Only the blocks that leave the buffer in the Modified state are
+flushed. The lines of the buffer snoop the bus like the lines of the sets.
+
+With the MOESI protocol a Modified block that another cache reads becomes Owned:
+the owner passes the block cache to cache, on every later read as well, and the
+memory is only written when the owner evicts it. An Owned line is written after
+a busRdX, like a Shared one, but keeps its own data.
+
+The loads and stores train a stride prefetcher. The blocks it predicts are read
+with busRd transactions, submitted in the bus cycles that no cache uses, and
+never while another cache holds them Modified. A prefetch evicts like a miss.
 *****************************************************************************/
 
 /* Includes */
@@ -25,70 +45,401 @@ The cach use 2 SRAMS:
 #include <string.h>
 
 typedef struct {
-    uint32_t offset : 2; // 2 bits for offset
-    uint32_t index : 6;  // 6 bits for index
-    uint32_t tag : 12;  // 12 bits for tag
-} CacheAddressFields;
-
-typedef union {
-    uint32_t address;       // Raw 32-bit address
-    CacheAddressFields fields;   // Decomposed fields
+    uint32_t address; // Raw address
+    uint32_t offset;  // Word in the block
+    uint32_t set;     // Set of the block
+    uint32_t tag;     // The rest of the address above the set
 } CacheAddressInfo;
 
-typedef Cache_Id_enum(*states_machine)(Cache_Data* data, bus_transaction* transaction); // Function pointer to the current state
+typedef Cache_Id_enum(*states_machine)(Cache_Data* data, uint32_t line, bus_transaction* transaction); // Function pointer to the current state
 
 /*Functions prototypes*/
+static CacheAddressInfo decompose_address(const Cache_Data* cache_data, uint32_t address);
+static uint32_t find_line(const Cache_Data* cache_data, CacheAddressInfo addr);
+static uint32_t find_victim_line(const Cache_Data* cache_data, CacheAddressInfo addr);
+static uint32_t find_block(const Cache_Data* cache_data, CacheAddressInfo addr);
+static uint32_t line_address(const Cache_Data* cache_data, uint32_t line);
+static void move_line(Cache_Data* cache_data, uint32_t from, uint32_t to);
+static void directory_update(Cache_Data* cache_data, uint32_t line, bool is_sharer);
+static void set_line_state(Cache_Data* cache_data, uint32_t line, uint8_t state);
+static void swap_with_victim_line(Cache_Data* cache_data, uint32_t line, uint32_t victim_line);
+static uint32_t insert_victim_line(Cache_Data* cache_data, uint32_t line);
+static Replacement_Set replacement_set(Cache_Data* cache_data, uint32_t set);
+static void touch_line(Cache_Data* cache_data, uint32_t line);
+static uint32_t choose_victim(Cache_Data* cache_data, uint32_t set);
 static bool is_cache_busy(Cache_Data* cache_data);
 static bool shared_or_modified_handler(void *cache, bus_transaction* transaction,  bool* is_modified);
 static bool snooping_handler(void* cache, bus_transaction* transaction, uint8_t  address_offset);
-static bool snooped_transaction(Cache_Data* cache_data, TSRAMLine* tsram_line, bus_transaction* transaction, CacheAddressInfo c_addr, uint8_t address_offset);
-static bool is_block_valid_and_matching(TSRAMLine* tsram_line, uint16_t tag);
+static bool snooped_transaction(Cache_Data* cache_data, uint32_t line, bus_transaction* transaction, uint8_t address_offset);
 static bool cache_response_handle(void* data, bus_transaction* transaction, uint8_t* address_offset);
-static void flush_data(Cache_Data* cache_data, bus_transaction* transaction);
-static Cache_Id_enum MSEI_invalid (Cache_Data* cache_data, bus_transaction* transaction);
-static Cache_Id_enum MSEI_shared (Cache_Data* cache_data, bus_transaction* transaction);
-static Cache_Id_enum MSEI_exclusive (Cache_Data* cache_data, bus_transaction* transaction);
-static Cache_Id_enum MSEI_modified (Cache_Data* cache_data, bus_transaction* transaction);
-static bool readHit(Cache_Data* cache_data, CacheAddressInfo addr, uint32_t* data, bool miss_occurred_read);
-static void handle_dirty_block(Cache_Data* cache_data, TSRAMLine* tsram_line, CacheAddressInfo addr);
+static bool prefetch_handler(void* cache);
+static bool is_modified_in_other_cache(Cache_Data* cache_data, CacheAddressInfo addr);
+static void count_late_prefetch(Cache_Data* cache_data, uint32_t address);
+static bool hits_during_prefetch(Cache_Data* cache_data, uint32_t address, bool is_write);
+static void count_useful_prefetch(Cache_Data* cache_data, uint32_t line);
+static void flush_data(Cache_Data* cache_data, uint32_t line, bus_transaction* transaction);
+static Cache_Id_enum MSEI_invalid (Cache_Data* cache_data, uint32_t line, bus_transaction* transaction);
+static Cache_Id_enum MSEI_shared (Cache_Data* cache_data, uint32_t line, bus_transaction* transaction);
+static Cache_Id_enum MSEI_exclusive (Cache_Data* cache_data, uint32_t line, bus_transaction* transaction);
+static Cache_Id_enum MSEI_modified (Cache_Data* cache_data, uint32_t line, bus_transaction* transaction);
+static Cache_Id_enum MSEI_owned (Cache_Data* cache_data, uint32_t line, bus_transaction* transaction);
+static bool is_dirty(uint8_t state);
+static bool readHit(Cache_Data* cache_data, uint32_t line, CacheAddressInfo addr, uint32_t* data, bool miss_occurred_read);
+static void handle_dirty_block(Cache_Data* cache_data, uint32_t line, CacheAddressInfo addr);
 static void handle_transaction(Cache_Data* cache_data, CacheAddressInfo addr, cmd_on_the_bus b_cmd);
+static bool swap_from_victim_buffer(Cache_Data* cache_data, CacheAddressInfo addr);
+static void evict_line(Cache_Data* cache_data, uint32_t line, CacheAddressInfo addr);
+static void functional_write_back(Cache_Data* cache_data, uint32_t line, Main_Memory* memory);
+static void functional_evict(Cache_Data* cache_data, uint32_t line, Main_Memory* memory);
+static bool functional_snoop(Cache_Data* cache_data, CacheAddressInfo addr, bool is_write, Main_Memory* memory, const DRAMLine** owner_block);
 
 static states_machine state_handler[number_of_states] = {
     // State machine for the cache controller
     MSEI_invalid,
     MSEI_shared,
     MSEI_exclusive,
-    MSEI_modified
+    MSEI_modified,
+    MSEI_owned
 };
 
 
 /*Functions implementations*/
-void CacheController_Init(Cache_Data *cache_data, Cache_Id_enum id){
-    // Initialize the cache
+void Cache_DefaultConfig(Cache_Config* config){
+    // Direct mapped, the policy only matters with more than one way
+    config->size_words = DEFAULT_CACHE_SIZE;
+    config->block_words = DEFAULT_BLOCK_SIZE;
+    config->ways = 1;
+    config->policy = REPLACEMENT_LRU;
+    config->victim_lines = 0;
+    config->prefetch_distance = 0;
+    config->protocol = COHERENCE_MESI;
+}
+
+
+bool Cache_ParseProtocol(const char* name, Coherence_Protocol* protocol){
+    // The protocol names of the --protocol option
+    if (strcmp(name, "mesi") == 0) {
+        *protocol = COHERENCE_MESI;
+    } else if (strcmp(name, "moesi") == 0) {
+        *protocol = COHERENCE_MOESI;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+bool Cache_CheckConfig(const Cache_Config* config){
+    // The fields are checked together, as the options may come in any order
+    if (!AddressLayout_IsPowerOf2(config->size_words) || config->size_words < MIN_CACHE_SIZE || config->size_words > MAX_CACHE_SIZE) {
+        printf("Error: The cache size must be a power of 2 from %d to %d words\n", MIN_CACHE_SIZE, MAX_CACHE_SIZE);
+        return false;
+    }
+    if (!AddressLayout_IsPowerOf2(config->block_words) || config->block_words < MIN_BLOCK_SIZE || config->block_words > MAX_BLOCK_SIZE) {
+        printf("Error: The cache line must be a power of 2 from %d to %d words\n", MIN_BLOCK_SIZE, MAX_BLOCK_SIZE);
+        return false;
+    }
+    uint32_t max_ways = config->size_words / config->block_words; // A single set holds every line
+    max_ways = (max_ways < MAX_CACHE_WAYS) ? max_ways : MAX_CACHE_WAYS;
+    if (!AddressLayout_IsPowerOf2(config->ways) || config->ways > max_ways) {
+        printf("Error: The number of cache ways must be a power of 2 up to %u\n", max_ways);
+        return false;
+    }
+    if (config->victim_lines > MAX_VICTIM_LINES) {
+        printf("Error: The victim buffer must have 0 to %d lines\n", MAX_VICTIM_LINES);
+        return false;
+    }
+    if (config->prefetch_distance > MAX_PREFETCH_DISTANCE) {
+        printf("Error: The prefetch distance must be 0 to %d accesses\n", MAX_PREFETCH_DISTANCE);
+        return false;
+    }
+    return true;
+}
+
+
+bool CacheController_Init(Cache_Data *cache_data, Cache_Id_enum id, Bus_Controller* bus, const Cache_Config* config){
+    // Initialize the cache, the configuration was checked by Cache_CheckConfig
     memset((uint32_t *)cache_data, 0, sizeof(Cache_Data)); // Clear the cache data
     cache_data->id = id; // Set the cache ID
+    cache_data->bus = bus; // Set the bus the cache is connected to
+
+    // Set the organization, the number of sets is the number of lines / ways
+    cache_data->size_words = config->size_words;
+    cache_data->num_lines = config->size_words / config->block_words;
+    cache_data->ways = config->ways;
+    cache_data->protocol = config->protocol;
+    uint32_t num_sets = cache_data->num_lines / cache_data->ways;
+    if (!AddressLayout_Init(&cache_data->layout, config->block_words, num_sets)) {
+        return false;
+    }
+
+    // Allocate the SRAMs and the replacement state, all start as 0 (invalid lines).
+    // The victim buffer adds its lines and the line of the block it flushes.
+    cache_data->victim_lines = config->victim_lines;
+    uint32_t total_lines = cache_data->num_lines + ((cache_data->victim_lines > 0) ? cache_data->victim_lines + 1 : 0);
+    cache_data->tsram.tag = calloc(total_lines, sizeof(uint32_t));
+    cache_data->tsram.mesi = calloc(total_lines, sizeof(uint8_t));
+    cache_data->dram = calloc((size_t)total_lines * config->block_words, sizeof(DRAMLine));
+    cache_data->prefetched = calloc(total_lines, sizeof(uint8_t));
+    cache_data->replacement_state = calloc(cache_data->num_lines, sizeof(uint8_t));
+    cache_data->replacement_tree = calloc(num_sets, sizeof(uint64_t));
+    cache_data->dirty_lines = calloc(num_sets, sizeof(uint8_t));
+    if (cache_data->tsram.tag == NULL || cache_data->tsram.mesi == NULL || cache_data->dram == NULL || cache_data->prefetched == NULL ||
+        cache_data->replacement_state == NULL || cache_data->replacement_tree == NULL || cache_data->dirty_lines == NULL) {
+        CacheController_Free(cache_data);
+        return false;
+    }
+
+    cache_data->replacement = Replacement_GetPolicy(config->policy);
+    cache_data->replacement_random = 0x9E3779B9u ^ (uint32_t)(id + 1); // Distinct non zero seed per cache
+    for (uint32_t set = 0; set < num_sets; set++) {
+        Replacement_Set replacement = replacement_set(cache_data, set);
+        cache_data->replacement->init(&replacement);
+    }
 
     cache_data->tracking_info.read_hits = 0;
     cache_data->tracking_info.read_misses = 0;
     cache_data->tracking_info.write_hits = 0;
     cache_data->tracking_info.write_misses = 0;
+    cache_data->tracking_info.victim_hits = 0;
+    Prefetcher_Init(&cache_data->prefetcher, config->prefetch_distance, cache_data->layout.offset_bits);
 
     //bus initialization
     Bus_core_cache cache_interface = { .core_id = id, .bus_cache_data = cache_data };
-    Bus_InitializeCache(cache_interface);
+    Bus_InitializeCache(bus, cache_interface);
+    if (config->prefetch_distance > 0) {
+        ConfigurePrefetchCallback_for_bus(bus, prefetch_handler);
+    }
+    return true;
+}
+
+
+void CacheController_Free(Cache_Data* cache_data){
+    // Release the SRAMs and the replacement state
+    free(cache_data->tsram.tag);
+    free(cache_data->tsram.mesi);
+    free(cache_data->dram);
+    free(cache_data->prefetched);
+    free(cache_data->replacement_state);
+    free(cache_data->replacement_tree);
+    free(cache_data->dirty_lines);
+    cache_data->tsram.tag = NULL;
+    cache_data->tsram.mesi = NULL;
+    cache_data->dram = NULL;
+    cache_data->prefetched = NULL;
+    cache_data->replacement_state = NULL;
+    cache_data->replacement_tree = NULL;
+    cache_data->dirty_lines = NULL;
+}
+
+
+static CacheAddressInfo decompose_address(const Cache_Data* cache_data, uint32_t address) {
+    // Split the address into the word offset, the set and the tag above them
+    CacheAddressInfo addr = {
+        .address = address,
+        .offset = Address_Offset(&cache_data->layout, address),
+        .set = Address_Set(&cache_data->layout, address),
+        .tag = Address_Tag(&cache_data->layout, address)
+    };
+    return addr;
+}
+
+
+static uint32_t find_line(const Cache_Data* cache_data, CacheAddressInfo addr) {
+    // Compare the tags of all the ways of the set at once, at most one valid way matches
+    uint32_t first = addr.set * cache_data->ways;
+    const uint32_t* tags = &cache_data->tsram.tag[first];
+    const uint8_t* states = &cache_data->tsram.mesi[first];
+    uint32_t line = CACHE_NO_LINE;
+    for (uint32_t way = 0; way < cache_data->ways; way++) {
+        bool match = (tags[way] == addr.tag) & (states[way] != MESI_STATE_INVALID);
+        line = match ? first + way : line;
+    }
+    return line;
+}
+
+
+static uint32_t find_victim_line(const Cache_Data* cache_data, CacheAddressInfo addr) {
+    // Search the victim buffer and the line it flushes from, the tags are block numbers
+    uint32_t block = addr.address >> cache_data->layout.offset_bits;
+    uint32_t end = cache_data->num_lines + ((cache_data->victim_lines > 0) ? cache_data->victim_lines + 1 : 0);
+    for (uint32_t line = cache_data->num_lines; line < end; line++) {
+        if (cache_data->tsram.tag[line] == block && cache_data->tsram.mesi[line] != MESI_STATE_INVALID) {
+            return line;
+        }
+    }
+    return CACHE_NO_LINE;
+}
+
+
+static uint32_t find_block(const Cache_Data* cache_data, CacheAddressInfo addr) {
+    // The line that holds the block, in its set or in the victim buffer
+    uint32_t line = find_line(cache_data, addr);
+    return (line == CACHE_NO_LINE) ? find_victim_line(cache_data, addr) : line;
+}
+
+
+static uint32_t line_address(const Cache_Data* cache_data, uint32_t line) {
+    // Address of the first word of the block a line holds
+    if (line < cache_data->num_lines) {
+        return Address_Block(&cache_data->layout, cache_data->tsram.tag[line], line / cache_data->ways);
+    }
+    return cache_data->tsram.tag[line] << cache_data->layout.offset_bits;
+}
+
+
+static void move_line(Cache_Data* cache_data, uint32_t from, uint32_t to) {
+    // Copy the block, its state and its tag, in the tag format of the destination
+    uint32_t address = line_address(cache_data, from);
+    uint32_t block_words = cache_data->layout.block_words;
+    cache_data->tsram.tag[to] = (to < cache_data->num_lines) ? Address_Tag(&cache_data->layout, address) : address >> cache_data->layout.offset_bits;
+    set_line_state(cache_data, to, cache_data->tsram.mesi[from]);
+    cache_data->prefetched[to] = cache_data->prefetched[from];
+    memcpy(&cache_data->dram[to * block_words], &cache_data->dram[from * block_words], block_words * sizeof(DRAMLine));
+    if (cache_data->bus->directory != NULL) {
+        Directory_LineChanged(cache_data->bus->directory); // The line holds another block, maybe in the same state
+    }
+}
+
+
+static void directory_update(Cache_Data* cache_data, uint32_t line, bool is_sharer) {
+    // Tell the directory of the bus that the block of the line entered or left the cache
+    if (cache_data->bus->directory != NULL) {
+        Directory_SetSharer(cache_data->bus->directory, line_address(cache_data, line), (uint32_t)cache_data->id, is_sharer);
+    }
+}
+
+
+static void set_line_state(Cache_Data* cache_data, uint32_t line, uint8_t state) {
+    // Change the state of a line. The snoop filter keeps the caches that have a dirty line in each set,
+    // and is told of every change so that the bus queries again.
+    uint8_t old_state = cache_data->tsram.mesi[line];
+    cache_data->tsram.mesi[line] = state;
+    Directory* directory = cache_data->bus->directory;
+    if (directory == NULL || old_state == state) {
+        return;
+    }
+    if (line < cache_data->num_lines && is_dirty(old_state) != is_dirty(state)) {
+        uint32_t set = line / cache_data->ways;
+        cache_data->dirty_lines[set] += is_dirty(state) ? 1 : -1;
+        if (cache_data->dirty_lines[set] == (is_dirty(state) ? 1 : 0)) {
+            Directory_SetDirtySet(directory, set, (uint32_t)cache_data->id, is_dirty(state));
+        }
+    }
+    Directory_LineChanged(directory);
+}
+
+
+static void swap_with_victim_line(Cache_Data* cache_data, uint32_t line, uint32_t victim_line) {
+    // Bring the block of the victim buffer into the line of its set, the block of the line takes its place
+    uint32_t block_words = cache_data->layout.block_words;
+    DRAMLine data[MAX_BLOCK_SIZE];
+    uint32_t address = line_address(cache_data, line);
+    uint8_t mesi = cache_data->tsram.mesi[line];
+    uint8_t prefetched = cache_data->prefetched[line];
+    memcpy(data, &cache_data->dram[line * block_words], block_words * sizeof(DRAMLine));
+
+    move_line(cache_data, victim_line, line);
+    cache_data->tsram.tag[victim_line] = address >> cache_data->layout.offset_bits;
+    set_line_state(cache_data, victim_line, mesi);
+    cache_data->prefetched[victim_line] = prefetched;
+    memcpy(&cache_data->dram[victim_line * block_words], data, block_words * sizeof(DRAMLine));
+
+    Replacement_Set replacement = replacement_set(cache_data, line / cache_data->ways);
+    cache_data->replacement->on_fill(&replacement, line % cache_data->ways);
+}
+
+
+static uint32_t insert_victim_line(Cache_Data* cache_data, uint32_t line) {
+    // Move the valid block a miss evicts into the victim buffer, an invalid line of the buffer is used first.
+    // Returns the line of a Modified or Owned block the buffer evicted for it, which must be flushed, or CACHE_NO_LINE.
+    if (cache_data->tsram.mesi[line] == MESI_STATE_INVALID) {
+        return CACHE_NO_LINE;
+    }
+    uint32_t slot = CACHE_NO_LINE;
+    for (uint32_t i = 0; i < cache_data->victim_lines && slot == CACHE_NO_LINE; i++) {
+        slot = (cache_data->tsram.mesi[cache_data->num_lines + i] == MESI_STATE_INVALID) ? cache_data->num_lines + i : slot;
+    }
+    if (slot == CACHE_NO_LINE) {
+        slot = cache_data->num_lines + cache_data->victim_next;
+        cache_data->victim_next = (cache_data->victim_next + 1) % cache_data->victim_lines;
+    }
+
+    uint32_t write_back_line = CACHE_NO_LINE;
+    if (is_dirty(cache_data->tsram.mesi[slot])) {
+        write_back_line = cache_data->num_lines + cache_data->victim_lines;
+        move_line(cache_data, slot, write_back_line);
+    } else if (cache_data->tsram.mesi[slot] != MESI_STATE_INVALID) {
+        directory_update(cache_data, slot, false); // A clean block leaves the buffer without a transaction
+    }
+    move_line(cache_data, line, slot);
+    set_line_state(cache_data, line, MESI_STATE_INVALID);
+    return write_back_line;
+}
+
+
+static Replacement_Set replacement_set(Cache_Data* cache_data, uint32_t set) {
+    // The replacement state of a set for the policy callbacks
+    Replacement_Set replacement = {
+        .line_state = &cache_data->replacement_state[set * cache_data->ways],
+        .tree = &cache_data->replacement_tree[set],
+        .random = &cache_data->replacement_random,
+        .ways = cache_data->ways
+    };
+    return replacement;
+}
+
+
+static void touch_line(Cache_Data* cache_data, uint32_t line) {
+    // Tell the policy that the line was accessed
+    Replacement_Set replacement = replacement_set(cache_data, line / cache_data->ways);
+    cache_data->replacement->on_hit(&replacement, line % cache_data->ways);
+}
+
+
+static uint32_t choose_victim(Cache_Data* cache_data, uint32_t set) {
+    // An invalid way is filled first, otherwise the policy chooses
+    uint32_t first = set * cache_data->ways;
+    for (uint32_t way = 0; way < cache_data->ways; way++) {
+        if (cache_data->tsram.mesi[first + way] == MESI_STATE_INVALID) {
+            return first + way;
+        }
+    }
+    Replacement_Set replacement = replacement_set(cache_data, set);
+    return first + cache_data->replacement->victim(&replacement);
 }
 
 
 static bool is_cache_busy(Cache_Data* cache_data) {
     // Check if the cache is busy
-    return IsBusInTransaction((Bus_transaction_caller)cache_data->id) || 
-        IsBusWaitForTransaction((Bus_transaction_caller)cache_data->id);
+    return IsBusInTransaction(cache_data->bus, (Bus_transaction_caller)cache_data->id) || 
+        IsBusWaitForTransaction(cache_data->bus, (Bus_transaction_caller)cache_data->id);
+}
+
+
+bool Cache_IsWaitingForBus(Cache_Data* cache_data) {
+    // Check if the cache has a transaction that is queued or served by the bus
+    return IsBusTransactionPending(cache_data->bus, (Bus_transaction_caller)cache_data->id);
+}
+
+
+bool Cache_IsWaitingForBusQueue(Cache_Data* cache_data) {
+    // Check if the bus queue had no room for the transactions of the cache
+    return IsBusQueueFull(cache_data->bus, (Bus_transaction_caller)cache_data->id);
+}
+
+
+void Cache_StopPrefetching(Cache_Data* cache_data) {
+    // No access follows the halt, a prefetch already on the bus still completes
+    Prefetcher_Stop(&cache_data->prefetcher);
 }
 
 
-static bool readHit(Cache_Data* cache_data, CacheAddressInfo addr, uint32_t* data, bool miss_occurred_read) {
+static bool readHit(Cache_Data* cache_data, uint32_t line, CacheAddressInfo addr, uint32_t* data, bool miss_occurred_read) {
     // Read hit: retrieve data from cache.
-      *data = cache_data->dram[addr.fields.index * BLOCK_SIZE + addr.fields.offset].data; // Read the data from the cache
+      *data = cache_data->dram[line * cache_data->layout.block_words + addr.offset].data; // Read the data from the cache
+      touch_line(cache_data, line);
+      count_useful_prefetch(cache_data, line);
         // Update statistics for a read hit.
         if (!miss_occurred_read) { 
             cache_data->tracking_info.read_hits++;
@@ -99,11 +450,11 @@ static bool readHit(Cache_Data* cache_data, CacheAddressInfo addr, uint32_t* dat
 }
 
 
-static void handle_dirty_block(Cache_Data* cache_data, TSRAMLine* tsram_line, CacheAddressInfo addr) {
-    // Handle dirty block if necessary.
-    if (tsram_line->mesi == MESI_STATE_MODIFIED) {
-        uint32_t evict_addr = (tsram_line->tag << 8) | (addr.fields.index << 2); // Calculate the address to evict
-        uint32_t evict_data = cache_data->dram[addr.fields.index * BLOCK_SIZE + addr.fields.offset].data;
+static void handle_dirty_block(Cache_Data* cache_data, uint32_t line, CacheAddressInfo addr) {
+    // Handle dirty block if necessary, a Modified or an Owned one.
+    if (is_dirty(cache_data->tsram.mesi[line])) {
+        uint32_t evict_addr = line_address(cache_data, line); // Calculate the address to evict
+        uint32_t evict_data = cache_data->dram[line * cache_data->layout.block_words + addr.offset].data;
         bus_transaction evict_transaction = {
             .origid = (Bus_transaction_caller)cache_data->id,
             .bus_cmd = flush,
@@ -112,7 +463,33 @@ static void handle_dirty_block(Cache_Data* cache_data, TSRAMLine* tsram_line, Ca
             .bus_shared = 0
         };
         evict_transaction.bus_data = evict_data;
-        AddTransaction_to_bus(evict_transaction);
+        AddTransaction_to_bus(cache_data->bus, evict_transaction);
+    }
+}
+
+
+static bool swap_from_victim_buffer(Cache_Data* cache_data, CacheAddressInfo addr) {
+    // Serve a miss from the victim buffer, the block is swapped with the victim line of its set
+    uint32_t victim_line = (cache_data->victim_lines > 0) ? find_victim_line(cache_data, addr) : CACHE_NO_LINE;
+    if (victim_line == CACHE_NO_LINE) {
+        return false;
+    }
+    swap_with_victim_line(cache_data, choose_victim(cache_data, addr.set), victim_line);
+    cache_data->tracking_info.victim_hits++;
+    return true;
+}
+
+
+static void evict_line(Cache_Data* cache_data, uint32_t line, CacheAddressInfo addr) {
+    // Without a victim buffer a Modified block is flushed, otherwise it moves into the buffer,
+    // which flushes the Modified block it evicts for it
+    if (cache_data->victim_lines == 0) {
+        handle_dirty_block(cache_data, line, addr);
+        return;
+    }
+    uint32_t write_back_line = insert_victim_line(cache_data, line);
+    if (write_back_line != CACHE_NO_LINE) {
+        handle_dirty_block(cache_data, write_back_line, addr);
     }
 }
 
@@ -127,42 +504,53 @@ static void handle_transaction(Cache_Data* cache_data, CacheAddressInfo addr, cm
         .bus_shared = 0
     };
 
-    AddTransaction_to_bus(transaction); // Add the transaction to the bus
+    cache_data->fill_cmd = b_cmd;
+    AddTransaction_to_bus(cache_data->bus, transaction); // Add the transaction to the bus
 }
 
 
 /*
 * Read_Data_from_Cache*
 */
-bool Read_Data_from_Cache(Cache_Data* cache_data, uint32_t address, uint32_t* data) {
-    static bool miss_occurred_read = false; // Distinct between read hit to hit after miss that doesn't count as read hit
-    uint32_t index = 0;
+bool Read_Data_from_Cache(Cache_Data* cache_data, uint16_t pc, uint32_t address, uint32_t* data) {
     CacheAddressInfo addr;
-    TSRAMLine* tsram_line; 
+    uint32_t line;
 
-    // Step 1: Check if the cache is busy
-    if (is_cache_busy(cache_data))
+    // Step 1: Train the prefetcher and check if the cache is busy
+    Prefetcher_Train(&cache_data->prefetcher, pc, address);
+    if (is_cache_busy(cache_data) && !hits_during_prefetch(cache_data, address, false)) {
+        count_late_prefetch(cache_data, address);
         return false;
+    }
 
     // Parse the address into fields.
-    addr.address = address;
-    index = addr.fields.index;
+    addr = decompose_address(cache_data, address);
 
     // Step 2: Check for a cache hit.
-    tsram_line = &(cache_data->tsram[index]);
+    line = find_line(cache_data, addr);
 
-    if (is_block_valid_and_matching(tsram_line, addr.fields.tag)) {
+    if (line != CACHE_NO_LINE) {
         // Read hit: retrieve data from cache.
-        miss_occurred_read = readHit(cache_data, addr, data, miss_occurred_read);
+        cache_data->miss_occurred_read = readHit(cache_data, line, addr, data, cache_data->miss_occurred_read);
         return true;
     }
 
-    // Step 3: Handle a cache miss.
+    // Step 3: A block of the victim buffer returns to its set, the access hits on the next cycle without counting it.
+    if (swap_from_victim_buffer(cache_data, addr)) {
+        cache_data->miss_occurred_read = true;
+        return false;
+    }
+
+    // Step 4: Handle a cache miss.
     cache_data->tracking_info.read_misses++;
-    miss_occurred_read = true;
+    cache_data->miss_occurred_read = true;
+
+    // The block is brought into the victim line of the set
+    line = choose_victim(cache_data, addr.set);
+    cache_data->fill_line = line;
     
-    // Handle dirty block if necessary.
-    handle_dirty_block(cache_data, tsram_line, addr);
+    // Evict the block of the line, flushing it if necessary.
+    evict_line(cache_data, line, addr);
  
     // Initiate read transaction to fetch data from memory.
     handle_transaction(cache_data, addr, busRd);
@@ -177,16 +565,17 @@ static bool handle_share_state(Cache_Data* cache_data, CacheAddressInfo addr) {
 
     // Add an invalid transaction for delay.
     bus_transaction invalid_transaction = {
+        .original_caller = (Bus_transaction_caller)cache_data->id, // The core that submits the delay
         .origid = invalid_caller
     };
-    AddTransaction_to_bus(invalid_transaction);
+    AddTransaction_to_bus(cache_data->bus, invalid_transaction);
 
     cache_data->tracking_info.write_misses++;
     return true;
 }
 
 
-void update_cache_write(Cache_Data *cache_data, CacheAddressInfo addr, uint32_t data, bool *miss_occurred_write) {
+void update_cache_write(Cache_Data *cache_data, uint32_t line, CacheAddressInfo addr, uint32_t data, bool *miss_occurred_write) {
     // Update statistics for a write hit
     if (!*miss_occurred_write) {
         cache_data->tracking_info.write_hits++;
@@ -195,53 +584,64 @@ void update_cache_write(Cache_Data *cache_data, CacheAddressInfo addr, uint32_t
     }
 
     // Write data to cache and update MESI state
-    uint32_t offset = addr.fields.offset;
-    uint32_t index = addr.fields.index;
-    uint32_t data_addr = index * BLOCK_SIZE + offset;
+    uint32_t data_addr = line * cache_data->layout.block_words + addr.offset;
     cache_data->dram[data_addr].data = data;
-    cache_data->tsram[index].mesi = MESI_STATE_MODIFIED;
+    set_line_state(cache_data, line, MESI_STATE_MODIFIED);
+    touch_line(cache_data, line);
+    count_useful_prefetch(cache_data, line);
 }
 
 
 /*
 * Write_Data_to_Cache*
 */
-bool Write_Data_to_Cache(Cache_Data* cache_data, uint32_t address, uint32_t data) {
-    static bool miss_occurred_write = false; // Track write misses distinctly.
-    uint32_t index = 0;
-    uint32_t offset = 0;
+bool Write_Data_to_Cache(Cache_Data* cache_data, uint16_t pc, uint32_t address, uint32_t data) {
     CacheAddressInfo addr;
-    TSRAMLine* tsram_line;
+    uint32_t line;
 
-    // Step 1: Check if the cache is busy.
-    if (is_cache_busy(cache_data)) {
+    // Step 1: Train the prefetcher and check if the cache is busy.
+    Prefetcher_Train(&cache_data->prefetcher, pc, address);
+    if (is_cache_busy(cache_data) && !hits_during_prefetch(cache_data, address, true)) {
+        count_late_prefetch(cache_data, address);
         return false;
     }
 
     // Parse the address into fields.
-    addr.address = address;
-    index = addr.fields.index;
+    addr = decompose_address(cache_data, address);
 
     // Step 2: Check for a cache hit.
-    tsram_line = &(cache_data->tsram[index]);
-
-    if (is_block_valid_and_matching(tsram_line, addr.fields.tag)) {
-        // Handle shared state by upgrading to exclusive.
-        if (tsram_line->mesi == MESI_STATE_SHARED) {
-            miss_occurred_write = handle_share_state(cache_data, addr);
+    line = find_line(cache_data, addr);
+
+    if (line != CACHE_NO_LINE) {
+        // Handle shared state by upgrading to exclusive, the busRdX refills the same line.
+        // An Owned line holds the only up to date copy, the memory's would overwrite it.
+        if (cache_data->tsram.mesi[line] == MESI_STATE_SHARED || cache_data->tsram.mesi[line] == MESI_STATE_OWNED) {
+            cache_data->fill_line = line;
+            cache_data->owned_upgrade = (cache_data->tsram.mesi[line] == MESI_STATE_OWNED);
+            cache_data->miss_occurred_write = handle_share_state(cache_data, addr);
             return false;
         }
 
-        update_cache_write(cache_data, addr, data, &miss_occurred_write);
+        update_cache_write(cache_data, line, addr, data, &cache_data->miss_occurred_write);
         return true;
     }
 
-    // Step 3: Handle a cache miss.
+    // Step 3: A block of the victim buffer returns to its set, the access hits on the next cycle without counting it.
+    if (swap_from_victim_buffer(cache_data, addr)) {
+        cache_data->miss_occurred_write = true;
+        return false;
+    }
+
+    // Step 4: Handle a cache miss.
     cache_data->tracking_info.write_misses++;
-    miss_occurred_write = true;
+    cache_data->miss_occurred_write = true;
+
+    // The block is brought into the victim line of the set
+    line = choose_victim(cache_data, addr.set);
+    cache_data->fill_line = line;
 
-    // Handle dirty block if necessary.
-    handle_dirty_block(cache_data, tsram_line, addr);
+    // Evict the block of the line, flushing it if necessary.
+    evict_line(cache_data, line, addr);
     // Initiate write transaction for exclusive ownership.
     handle_transaction(cache_data, addr, busRdX);
 
@@ -249,10 +649,124 @@ bool Write_Data_to_Cache(Cache_Data* cache_data, uint32_t address, uint32_t data
 }
 
 
+/* Functional access begins */
+static void functional_write_back(Cache_Data* cache_data, uint32_t line, Main_Memory* memory) {
+    // Write a modified or owned block back to the memory, like the flush of an eviction or a snoop
+    if (!is_dirty(cache_data->tsram.mesi[line])) {
+        return;
+    }
+    uint32_t block_addr = line_address(cache_data, line);
+    for (uint32_t i = 0; i < cache_data->layout.block_words; i++) {
+        MainMemoryWrite(memory, block_addr + i, cache_data->dram[line * cache_data->layout.block_words + i].data);
+    }
+}
+
+
+static void functional_evict(Cache_Data* cache_data, uint32_t line, Main_Memory* memory) {
+    // Evict the block of a line like evict_line, the flush is written to the memory at once
+    if (cache_data->victim_lines == 0) {
+        functional_write_back(cache_data, line, memory);
+        return;
+    }
+    uint32_t write_back_line = insert_victim_line(cache_data, line);
+    if (write_back_line != CACHE_NO_LINE) {
+        functional_write_back(cache_data, write_back_line, memory);
+        directory_update(cache_data, write_back_line, false);
+        set_line_state(cache_data, write_back_line, MESI_STATE_INVALID);
+    }
+}
+
+
+static bool functional_snoop(Cache_Data* cache_data, CacheAddressInfo addr, bool is_write, Main_Memory* memory, const DRAMLine** owner_block) {
+    // Apply the busRd (read) or busRdX (write) of the access to the other caches, returns the shared signal.
+    // With MOESI the dirty block isn't written back, owner_block points to it for the fill.
+    bool is_shared = false;
+    *owner_block = NULL;
+    for (uint32_t i = 0; i < cache_data->bus->num_of_cores; i++) {
+        Cache_Data* other = (Cache_Data*)cache_data->bus->core_cache[i].bus_cache_data;
+        if (other == cache_data) {
+            continue;
+        }
+        uint32_t line = find_block(other, addr);
+        if (line == CACHE_NO_LINE) {
+            continue;
+        }
+        is_shared = true;
+        if (cache_data->protocol == COHERENCE_MOESI && is_dirty(other->tsram.mesi[line])) {
+            *owner_block = &other->dram[line * other->layout.block_words];
+            set_line_state(other, line, is_write ? MESI_STATE_INVALID : MESI_STATE_OWNED);
+            if (is_write) {
+                directory_update(other, line, false);
+            }
+            continue;
+        }
+        functional_write_back(other, line, memory); // A modified block is flushed to the memory
+        set_line_state(other, line, is_write ? MESI_STATE_INVALID : MESI_STATE_SHARED);
+        if (is_write) {
+            directory_update(other, line, false);
+        }
+    }
+    return is_shared;
+}
+
+
+/*
+* Cache_FunctionalAccess*
+*/
+uint32_t Cache_FunctionalAccess(Cache_Data* cache_data, uint32_t address, bool is_write, uint32_t data) {
+    // Read or write a word with the end result of the bus transactions of the access, without their timing.
+    // The statistics are not updated.
+    Main_Memory* memory = (Main_Memory*)cache_data->bus->memory;
+    CacheAddressInfo addr = decompose_address(cache_data, address);
+    uint32_t line = find_line(cache_data, addr);
+    const DRAMLine* owner_block;
+
+    if (line == CACHE_NO_LINE && cache_data->victim_lines > 0 && find_victim_line(cache_data, addr) != CACHE_NO_LINE) {
+        // The block returns from the victim buffer
+        line = choose_victim(cache_data, addr.set);
+        swap_with_victim_line(cache_data, line, find_victim_line(cache_data, addr));
+        if (is_write && (cache_data->tsram.mesi[line] == MESI_STATE_SHARED || cache_data->tsram.mesi[line] == MESI_STATE_OWNED)) {
+            functional_snoop(cache_data, addr, true, memory, &owner_block);
+        }
+    } else if (line == CACHE_NO_LINE) {
+        // Evict the victim of the set and bring the block of the address, after the other caches flushed it
+        line = choose_victim(cache_data, addr.set);
+        functional_evict(cache_data, line, memory);
+        bool is_shared = functional_snoop(cache_data, addr, is_write, memory, &owner_block);
+        uint32_t block_addr = Address_Block(&cache_data->layout, addr.tag, addr.set);
+        for (uint32_t i = 0; i < cache_data->layout.block_words; i++) {
+            cache_data->dram[line * cache_data->layout.block_words + i].data =
+                (owner_block != NULL) ? owner_block[i].data : MainMemoryRead(memory, block_addr + i);
+        }
+        if (cache_data->tsram.mesi[line] != MESI_STATE_INVALID) {
+            directory_update(cache_data, line, false); // The block of the line is replaced
+        }
+        cache_data->tsram.tag[line] = addr.tag;
+        set_line_state(cache_data, line, is_shared ? MESI_STATE_SHARED : MESI_STATE_EXCLUSIVE);
+        cache_data->prefetched[line] = 0;
+        directory_update(cache_data, line, true);
+        Replacement_Set replacement = replacement_set(cache_data, addr.set);
+        cache_data->replacement->on_fill(&replacement, line % cache_data->ways);
+    } else if (is_write && (cache_data->tsram.mesi[line] == MESI_STATE_SHARED || cache_data->tsram.mesi[line] == MESI_STATE_OWNED)) {
+        // Take the ownership of a shared block
+        functional_snoop(cache_data, addr, true, memory, &owner_block);
+    }
+    touch_line(cache_data, line);
+
+    uint32_t data_addr = line * cache_data->layout.block_words + addr.offset;
+    if (is_write) {
+        cache_data->dram[data_addr].data = data;
+        set_line_state(cache_data, line, MESI_STATE_MODIFIED);
+    }
+    return cache_data->dram[data_addr].data;
+}
+/* Functional access ends */
+
+
 /* Bus - Cache Callbacks begins */
-void Cache_InitializeBusCallbacks(void){
+void Cache_InitializeBusCallbacks(Bus_Controller* bus){
     // Initialize the bus callbacks
-    ConfigureCacheCallbacks_for_bus(  
+    ConfigureCacheCallbacks_for_bus(bus,
         shared_or_modified_handler,    // Callback for shared or modified blocks
         snooping_handler,   // Callback for snooping Bus transactions
         cache_response_handle    // Callback for handling Bus responses
@@ -262,23 +776,34 @@ void Cache_InitializeBusCallbacks(void){
 
 static bool shared_or_modified_handler(void *cache, bus_transaction* transaction,  bool* is_modified) {
     Cache_Data *cache_data = (Cache_Data *)cache;  // Cast to the original type
-    CacheAddressInfo c_addr;
-    uint32_t index = 0;
-    TSRAMLine* tsram_line;
 
     if((Cache_Id_enum)cache_data->id == (Cache_Id_enum)transaction->origid){
         return false; // Ignore the transaction from the same core
     }
 
-    c_addr.address = transaction->bus_addr; // Parse the address fields 
+    CacheAddressInfo address = decompose_address(cache_data, transaction->bus_addr); // Parse the address fields 
+
+    // The directory only asks the caches that hold the block, the block itself answers
+    if (cache_data->bus->directory_coherence) {
+        uint32_t line = find_block(cache_data, address);
+        *is_modified |= (line != CACHE_NO_LINE) && is_dirty(cache_data->tsram.mesi[line]);
+        return line != CACHE_NO_LINE;
+    }
 
-    CacheAddressInfo address = { .address = c_addr.address };
-    index = address.fields.index;
-    tsram_line = &(cache_data->tsram[index]); // Get the TSRAM line 
-    if (tsram_line->mesi == MESI_STATE_MODIFIED) {
+    // A modified line anywhere in the set delays the transaction, as the direct mapped cache does for its single line.
+    // An Owned line is dirty as well.
+    uint32_t first = address.set * cache_data->ways;
+    for (uint32_t way = 0; way < cache_data->ways; way++) {
+        if (is_dirty(cache_data->tsram.mesi[first + way])) {
+            *is_modified = true;
+        }
+    }
+    // A block of the victim buffer answers for itself
+    uint32_t victim_line = (cache_data->victim_lines > 0) ? find_victim_line(cache_data, address) : CACHE_NO_LINE;
+    if (victim_line != CACHE_NO_LINE && is_dirty(cache_data->tsram.mesi[victim_line])) {
         *is_modified = true;
     }
-    return is_block_valid_and_matching(tsram_line, address.fields.tag);
+    return find_line(cache_data, address) != CACHE_NO_LINE || victim_line != CACHE_NO_LINE;
 
 }
 
@@ -286,73 +811,85 @@ static bool shared_or_modified_handler(void *cache, bus_transaction* transaction
 static bool snooping_handler(void* cache, bus_transaction* transaction, uint8_t  address_offset) {
     Cache_Data *cache_data = (Cache_Data *)cache;
     CacheAddressInfo c_addr;
-    uint32_t index = 0;
-    TSRAMLine* tsram_line;
 
-    c_addr.address = transaction->bus_addr; // Parse the address fields 
-    index = c_addr.fields.index;
-    tsram_line = &(cache_data->tsram[index]); // Get the TSRAM line 
+    c_addr = decompose_address(cache_data, transaction->bus_addr); // Parse the address fields 
     
     if((Bus_transaction_caller)cache_data->id == transaction->original_caller && transaction->bus_cmd != flush) {
         return false; // Ignore the transaction from the same core
     }
-    return snooped_transaction(cache_data, tsram_line, transaction, c_addr, address_offset);
+    return snooped_transaction(cache_data, find_block(cache_data, c_addr), transaction, address_offset);
 }
 
 
-static bool snooped_transaction(Cache_Data* cache_data, TSRAMLine* tsram_line, bus_transaction* transaction, CacheAddressInfo c_addr, uint8_t address_offset) {
+static bool snooped_transaction(Cache_Data* cache_data, uint32_t line, bus_transaction* transaction, uint8_t address_offset) {
     // This function snoops on Bus transactions to update the cache’s MESI state.
-    if (tsram_line->tag != c_addr.fields.tag ||tsram_line->mesi == MESI_STATE_INVALID) { 
-        return false; // Cache line is invalid or does not match
+    if (line == CACHE_NO_LINE) { 
+        return false; // No valid line of the set holds the block
     }
 
-    Cache_Id_enum next = state_handler[tsram_line->mesi](cache_data, transaction); // Get the next state
+    Cache_Id_enum next = state_handler[cache_data->tsram.mesi[line]](cache_data, line, transaction); // Get the next state
 
-    if ((address_offset == BLOCK_SIZE - 1) || (tsram_line->mesi != MESI_STATE_MODIFIED)) { // Check if the transaction is complete and the block is not modified
-        tsram_line->mesi = next; // Update the MESI state
+    if ((address_offset == cache_data->layout.block_words - 1) || !is_dirty(cache_data->tsram.mesi[line])) { // Check if the transaction is complete and the block is not dirty
+        if (next == (Cache_Id_enum)MESI_STATE_INVALID && cache_data->tsram.mesi[line] != MESI_STATE_INVALID) {
+            directory_update(cache_data, line, false); // Invalidated by the transaction
+        }
+        set_line_state(cache_data, line, next); // Update the MESI state
     }
 
     return true;
 }
 
 
-static bool is_block_valid_and_matching(TSRAMLine* tsram_line, uint16_t tag) {
-    // Check if the block is valid and matches the requested tag
-    return tsram_line->tag == tag && tsram_line->mesi != MESI_STATE_INVALID;
-}
-
-
 static bool cache_response_handle(void* data, bus_transaction* transaction, uint8_t* address_offset) {
     Cache_Data *cache_data = (Cache_Data *)data;
-    uint32_t index = 0;
-    TSRAMLine* tsram_line;
+    uint32_t line;
     
     if ((Bus_transaction_caller)cache_data->id == transaction->origid && transaction->bus_cmd != flush) {
         return false; // Ignore the transaction from the same core that is not a flush
     }
     else if ((Bus_transaction_caller)cache_data->id == transaction->origid && transaction->bus_cmd == flush) {
-        if ( *address_offset == (BLOCK_SIZE - 1)) {
+        if ( *address_offset == (cache_data->layout.block_words - 1)) {
+            if (cache_data->victim_lines > 0) {
+                // The flush was of the block the victim buffer evicted, the only one it flushes
+                uint32_t write_back_line = cache_data->num_lines + cache_data->victim_lines;
+                if (cache_data->tsram.mesi[write_back_line] != MESI_STATE_INVALID) {
+                    directory_update(cache_data, write_back_line, false);
+                }
+                set_line_state(cache_data, write_back_line, MESI_STATE_INVALID);
+            }
             return true; // Transaction completed
         }
         *address_offset += 1; // Increment the address offset for multi-word transactions
         return false; // More data to send
     }
-    CacheAddressInfo addr = { .address = transaction->bus_addr };
-    index = addr.fields.index;
-    tsram_line = &(cache_data->tsram[index]); // Get the TSRAM line 
+    CacheAddressInfo addr = decompose_address(cache_data, transaction->bus_addr);
+    line = cache_data->fill_line; // The line chosen when the transaction was issued
 
-    tsram_line->tag = addr.fields.tag;
-    if(transaction->bus_cmd == flush) {
-        cache_data->dram[addr.fields.index * BLOCK_SIZE + addr.fields.offset].data = transaction->bus_data;
+    if (cache_data->tsram.mesi[line] != MESI_STATE_INVALID && cache_data->tsram.tag[line] != addr.tag) {
+        directory_update(cache_data, line, false); // The first word replaces the block of the line
+    }
+    cache_data->tsram.tag[line] = addr.tag;
+    if(transaction->bus_cmd == flush && !(cache_data->owned_upgrade && cache_data->tsram.mesi[line] == MESI_STATE_OWNED)) {
+        cache_data->dram[line * cache_data->layout.block_words + addr.offset].data = transaction->bus_data;
     }
-    if(*address_offset == (BLOCK_SIZE - 1)) {
-        if (transaction->bus_shared) {
+    if(*address_offset == (cache_data->layout.block_words - 1)) {
+        if ((cache_data->owned_upgrade && cache_data->tsram.mesi[line] == MESI_STATE_OWNED) ||
+            (transaction->cache_to_cache && cache_data->fill_cmd == busRdX)) {
+            // The block is dirty and the write follows, it can't pass through Exclusive or Shared
+            set_line_state(cache_data, line, MESI_STATE_MODIFIED);
+        } else if (transaction->bus_shared) {
         // If the transaction indicates shared ownership, set the MESI state to SHARED.
-        tsram_line->mesi = MESI_STATE_SHARED;
+        set_line_state(cache_data, line, MESI_STATE_SHARED);
         } else {
             // Otherwise, set the MESI state to EXCLUSIVE.
-            tsram_line->mesi = MESI_STATE_EXCLUSIVE;
+            set_line_state(cache_data, line, MESI_STATE_EXCLUSIVE);
         }
+        Replacement_Set replacement = replacement_set(cache_data, addr.set);
+        cache_data->replacement->on_fill(&replacement, line % cache_data->ways);
+        cache_data->prefetched[line] = cache_data->prefetch_in_flight;
+        cache_data->prefetch_in_flight = false;
+        cache_data->owned_upgrade = false;
+        directory_update(cache_data, line, true);
         return true; // Transaction completed
     }
     *address_offset += 1; // Increment the address offset for multi-word transactions
@@ -360,15 +897,91 @@ static bool cache_response_handle(void* data, bus_transaction* transaction, uint
 }
 
 
+static bool is_modified_in_other_cache(Cache_Data* cache_data, CacheAddressInfo addr) {
+    // Check if another cache holds the block in the Modified state
+    for (uint32_t i = 0; i < cache_data->bus->num_of_cores; i++) {
+        Cache_Data* other = (Cache_Data*)cache_data->bus->core_cache[i].bus_cache_data;
+        if (other == cache_data) {
+            continue;
+        }
+        uint32_t line = find_block(other, addr);
+        if (line != CACHE_NO_LINE && other->tsram.mesi[line] == MESI_STATE_MODIFIED) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static bool prefetch_handler(void* cache) {
+    // The bus has a free cycle: submit the oldest predicted block that is worth reading
+    Cache_Data* cache_data = (Cache_Data*)cache;
+    uint32_t address;
+    if (is_cache_busy(cache_data)) {
+        return false;
+    }
+    while (Prefetcher_Next(&cache_data->prefetcher, &address)) {
+        CacheAddressInfo addr = decompose_address(cache_data, address);
+        if (find_block(cache_data, addr) != CACHE_NO_LINE) {
+            continue; // Already cached
+        }
+        if (is_modified_in_other_cache(cache_data, addr)) {
+            continue; // Taking the block would disturb its owner
+        }
+
+        // Evict the victim of the set and read the block, like a read miss that no access waits for
+        uint32_t line = choose_victim(cache_data, addr.set);
+        cache_data->fill_line = line;
+        cache_data->prefetch_in_flight = true;
+        cache_data->prefetch_late = false;
+        cache_data->prefetch_address = address;
+        cache_data->prefetcher.stats.issued++;
+        evict_line(cache_data, line, addr);
+        handle_transaction(cache_data, addr, busRd);
+        return true;
+    }
+    return false;
+}
+
+
+static void count_late_prefetch(Cache_Data* cache_data, uint32_t address) {
+    // An access that waits for the prefetch of its block, counted once per prefetch
+    uint32_t block = Address_Word(&cache_data->layout, address, 0);
+    if (cache_data->prefetch_in_flight && !cache_data->prefetch_late && block == cache_data->prefetch_address) {
+        cache_data->prefetch_late = true;
+        cache_data->prefetcher.stats.late++;
+    }
+}
+
+
+static bool hits_during_prefetch(Cache_Data* cache_data, uint32_t address, bool is_write) {
+    // A prefetch doesn't block the accesses that hit, except in the line it fills.
+    // A write to a Shared or Owned line needs the bus, it waits.
+    if (!cache_data->prefetch_in_flight) {
+        return false;
+    }
+    uint32_t line = find_line(cache_data, decompose_address(cache_data, address));
+    return line != CACHE_NO_LINE && line != cache_data->fill_line &&
+        !(is_write && (cache_data->tsram.mesi[line] == MESI_STATE_SHARED || cache_data->tsram.mesi[line] == MESI_STATE_OWNED));
+}
+
+
+static void count_useful_prefetch(Cache_Data* cache_data, uint32_t line) {
+    // The first access to a prefetched block
+    if (cache_data->prefetched[line]) {
+        cache_data->prefetched[line] = 0;
+        cache_data->prefetcher.stats.useful++;
+    }
+}
 /* Bus - Cache Callbacks ends */
 /* States machine functions start */
-static Cache_Id_enum MSEI_invalid (Cache_Data* cache_data, bus_transaction* transaction) {
+static Cache_Id_enum MSEI_invalid (Cache_Data* cache_data, uint32_t line, bus_transaction* transaction) {
     // Handle the MESI state invalid
     return (Cache_Id_enum)MESI_STATE_INVALID;
 }
 
 
-static Cache_Id_enum MSEI_shared (Cache_Data* cache_data, bus_transaction* transaction) {
+static Cache_Id_enum MSEI_shared (Cache_Data* cache_data, uint32_t line, bus_transaction* transaction) {
     // Handle the MESI state shared
     if (transaction->bus_cmd == busRdX) { 
         // Upgrade to modified state
@@ -378,7 +991,7 @@ static Cache_Id_enum MSEI_shared (Cache_Data* cache_data, bus_transaction* trans
 }
 
 
-static Cache_Id_enum MSEI_exclusive(Cache_Data* cache_data, bus_transaction* transaction) {
+static Cache_Id_enum MSEI_exclusive(Cache_Data* cache_data, uint32_t line, bus_transaction* transaction) {
     // Handle the MESI state exclusive
     if (transaction->bus_cmd == busRd) { 
         // Downgrade to shared state
@@ -392,39 +1005,74 @@ static Cache_Id_enum MSEI_exclusive(Cache_Data* cache_data, bus_transaction* tra
 }
 
 
-static void flush_data(Cache_Data* cache_data, bus_transaction* transaction){
-        CacheAddressInfo address =  { .address = transaction->bus_addr };
-        transaction->bus_data = cache_data->dram[address.fields.index * BLOCK_SIZE + address.fields.offset].data; // Send the modified data back to the Bus
+static bool is_dirty(uint8_t state) {
+    // The block differs from the memory, its holder flushes it
+    return state == MESI_STATE_MODIFIED || state == MESI_STATE_OWNED;
+}
+
+
+static void flush_data(Cache_Data* cache_data, uint32_t line, bus_transaction* transaction){
+        CacheAddressInfo address = decompose_address(cache_data, transaction->bus_addr);
+        // With MOESI the dirty block stays in the caches, the memory is only written by evictions
+        transaction->cache_to_cache = (cache_data->protocol == COHERENCE_MOESI) && (transaction->bus_cmd != flush);
+        transaction->bus_data = cache_data->dram[line * cache_data->layout.block_words + address.offset].data; // Send the modified data back to the Bus
         transaction->bus_cmd = flush; 
         transaction->origid = (Bus_transaction_caller)cache_data->id;
 }
 
 
-static Cache_Id_enum MSEI_modified(Cache_Data* cache_data, bus_transaction* transaction) {
+static Cache_Id_enum MSEI_modified(Cache_Data* cache_data, uint32_t line, bus_transaction* transaction) {
     // Handle the MESI state modified
     if (transaction->bus_cmd == busRd) { 
-        flush_data(cache_data, transaction);
+        flush_data(cache_data, line, transaction);
+        if (cache_data->protocol == COHERENCE_MOESI) {
+            return (Cache_Id_enum)MESI_STATE_OWNED; // Keep the dirty block and supply it
+        }
         return (Cache_Id_enum)MESI_STATE_SHARED; // Downgrade to shared state
     }
     else if (transaction->bus_cmd == busRdX) { 
-        flush_data(cache_data, transaction);
+        flush_data(cache_data, line, transaction);
         return (Cache_Id_enum)MESI_STATE_INVALID; // Downgrade to invalid state
     }
     else if (transaction->bus_cmd == flush) { 
-        flush_data(cache_data, transaction);
+        flush_data(cache_data, line, transaction);
         return (Cache_Id_enum)MESI_STATE_MODIFIED; // Downgrade to shared state
     }
     return (Cache_Id_enum)MESI_STATE_MODIFIED;
 }
+
+
+static Cache_Id_enum MSEI_owned(Cache_Data* cache_data, uint32_t line, bus_transaction* transaction) {
+    // Handle the MOESI state owned, the owner supplies the block instead of the memory
+    if (transaction->bus_cmd == busRd) {
+        flush_data(cache_data, line, transaction);
+        return (Cache_Id_enum)MESI_STATE_OWNED;
+    }
+    else if (transaction->bus_cmd == busRdX) {
+        flush_data(cache_data, line, transaction);
+        return (Cache_Id_enum)MESI_STATE_INVALID; // The writer takes the dirty block
+    }
+    else if (transaction->bus_cmd == flush) {
+        flush_data(cache_data, line, transaction); // Write back of the eviction
+    }
+    return (Cache_Id_enum)MESI_STATE_OWNED;
+}
 /* States machine functions end */
 
 
 void print_Cache_Data(Cache_Data* cache_data, FILE* file_dram, FILE* file_tsram) {
-    // Print the cache data
-    for (uint32_t i = 0; i < NUM_BLOCKS; i++) {
-        fprintf(file_tsram, "%08X\n", cache_data->tsram[i].mesi << 12 | cache_data->tsram[i].tag);
+    // Print the cache data, line by line. The state is above the tag, which is 12 bits wide in the default direct
+    // mapped cache, one bit wider for every doubling of the ways or the block and one bit narrower for every doubling of the size
+    uint32_t tag_bits = cache_data->layout.tag_bits;
+    for (uint32_t i = 0; i < cache_data->num_lines; i++) {
+        fprintf(file_tsram, "%08X\n", (uint32_t)cache_data->tsram.mesi[i] << tag_bits | cache_data->tsram.tag[i]);
+    }
+    // The lines of the victim buffer follow, their tag is the block number
+    uint32_t block_bits = ADDRESS_BITS - cache_data->layout.offset_bits;
+    for (uint32_t i = cache_data->num_lines; i < cache_data->num_lines + cache_data->victim_lines; i++) {
+        fprintf(file_tsram, "%08X\n", (uint32_t)cache_data->tsram.mesi[i] << block_bits | cache_data->tsram.tag[i]);
     }
-    for (uint32_t i = 0; i < CACHE_SIZE; i++) {
+    for (uint32_t i = 0; i < cache_data->size_words + cache_data->victim_lines * cache_data->layout.block_words; i++) {
         fprintf(file_dram, "%08X\n", cache_data->dram[i].data);
     }
 }
@@ -0,0 +1,111 @@
+/*!
+******************************************************************************
+file CoreWorkers.c
+
+Parallel stepping of the cores.
+
+Every cycle the cores run on worker threads between two barriers. While they 
+run, a core only touches its own pipeline, cache and files, and its bus requests 
+go to its own submission slot in the bus. The bus drains the slots in core id 
+order on the next Run_Bus_Iteration, which runs on the main thread while the 
+workers wait, so the results don't depend on the thread scheduling.
+*****************************************************************************/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include "../headers/CoreWorkers.h"
+
+/* Static Functions */
+static void run_worker_cores(Core_Workers* group, int worker_id);
+static void worker_main(void* arg);
+
+/* Functions implementations */
+static void run_worker_cores(Core_Workers* group, int worker_id) {
+    // Run a single cycle of the cores owned by the worker
+    for (int i = worker_id; i < group->num_cores; i += group->num_workers) {
+        core_run_single_cycle(&group->cores[i]);
+    }
+}
+
+
+static void worker_main(void* arg) {
+    Core_Worker* worker = (Core_Worker*)arg;
+    Core_Workers* group = worker->owner;
+    while (true) {
+        SimBarrier_Wait(&group->cycle_start);
+        if (SimAtomic_Load(&group->stop_workers)) {
+            return;
+        }
+        run_worker_cores(group, worker->worker_id);
+        SimBarrier_Wait(&group->cycle_end);
+    }
+}
+
+
+bool CoreWorkers_Start(Core_Workers* group, ProcessorCore* cores, int num_cores, int num_threads) {
+    memset(group, 0, sizeof(Core_Workers));
+    group->cores = cores;
+    group->num_cores = num_cores;
+    // A worker per host processor at most, the barriers spin while the workers wait for each other
+    int max_workers = SimThread_HardwareConcurrency();
+    max_workers = (num_cores < max_workers) ? num_cores : max_workers;
+    group->num_workers = (num_threads < 1) ? 1 : (num_threads > max_workers ? max_workers : num_threads);
+    SimBarrier_Init(&group->cycle_start, group->num_workers);
+    SimBarrier_Init(&group->cycle_end, group->num_workers);
+    if (group->num_workers == 1) {
+        return true;
+    }
+
+    group->workers = calloc(group->num_workers, sizeof(Core_Worker));
+    group->threads = calloc(group->num_workers, sizeof(SimThread));
+    if (group->workers == NULL || group->threads == NULL) {
+        group->num_workers = 1;
+        return false;
+    }
+
+    // Worker 0 is the calling thread
+    for (int i = 1; i < group->num_workers; i++) {
+        group->workers[i].owner = group;
+        group->workers[i].worker_id = i;
+        if (!SimThread_Create(&group->threads[i], worker_main, &group->workers[i])) {
+            // Open the start barrier for the workers already waiting on it and join them
+            SimAtomic_Store(&group->stop_workers, 1);
+            SimAtomic_Increment(&group->cycle_start.generation);
+            for (int j = 1; j < i; j++) {
+                SimThread_Join(group->threads[j]);
+            }
+            group->num_workers = 1;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void CoreWorkers_RunCycle(Core_Workers* group) {
+    if (group->num_workers <= 1) {
+        run_worker_cores(group, 0);
+        return;
+    }
+    SimBarrier_Wait(&group->cycle_start);
+    run_worker_cores(group, 0);
+    SimBarrier_Wait(&group->cycle_end);
+}
+
+
+void CoreWorkers_Stop(Core_Workers* group) {
+    // Release the workers from the start barrier with the stop flag set
+    SimAtomic_Store(&group->stop_workers, 1);
+    if (group->num_workers > 1) {
+        SimBarrier_Wait(&group->cycle_start);
+    }
+    for (int i = 1; i < group->num_workers; i++) {
+        SimThread_Join(group->threads[i]);
+    }
+    free(group->workers);
+    free(group->threads);
+    group->workers = NULL;
+    group->threads = NULL;
+    group->num_workers = 0;
+}
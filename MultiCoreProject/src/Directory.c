@@ -0,0 +1,110 @@
+/*!
+******************************************************************************
+file Directory.c
+
+Sharer directory of the directory coherence mode.
+
+The directory sits in front of the main memory and keeps, for each block, a
+bit vector of the caches that hold it in any valid state. The caches update it
+when a block enters or leaves them, and the bus sends the shared query and the
+snoop of a transaction only to the caches of the vector, instead of
+broadcasting them to every cache.
+
+The snooping bus uses the same vectors as an inclusive snoop filter. Its
+shared query also counts a dirty line of the set of the block in another
+cache, so the directory keeps a vector per set of the caches that have one.
+
+Like the main memory, the vectors are split into pages that are allocated on
+the first block of the page that is cached. The blocks are cached on the bus
+cycles, so the pages are allocated by a single thread, but the core threads
+may remove blocks at the same time: the bits are changed atomically.
+*****************************************************************************/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include "../headers/Directory.h"
+#include "../headers/AddressLayout.h"
+#include "../headers/SimThreads.h"
+
+/* Functions implementations */
+bool Directory_Init(Directory* directory, uint32_t num_cores, uint32_t block_words, uint32_t num_sets) {
+    memset(directory, 0, sizeof(Directory));
+    if (!AddressLayout_Init(&directory->layout, block_words, num_sets) || num_cores == 0 || num_cores > 64) {
+        return false;
+    }
+    directory->all_cores = (num_cores == 64) ? UINT64_MAX : ((1ull << num_cores) - 1);
+    uint32_t num_blocks = 1u << (ADDRESS_BITS - directory->layout.offset_bits);
+    directory->num_pages = (num_blocks + DIRECTORY_PAGE_SIZE - 1) / DIRECTORY_PAGE_SIZE;
+    directory->pages = calloc(directory->num_pages, sizeof(uint64_t*));
+    directory->dirty_sets = calloc(num_sets, sizeof(uint64_t));
+    return directory->pages != NULL && directory->dirty_sets != NULL;
+}
+
+
+void Directory_Free(Directory* directory) {
+    for (uint32_t i = 0; directory->pages != NULL && i < directory->num_pages; i++) {
+        free(directory->pages[i]);
+    }
+    free(directory->pages);
+    free(directory->dirty_sets);
+    directory->pages = NULL;
+    directory->dirty_sets = NULL;
+    directory->num_pages = 0;
+}
+
+
+void Directory_SetSharer(Directory* directory, uint32_t address, uint32_t core, bool is_sharer) {
+    // A page is allocated by the first block of it that is cached
+    uint32_t block = (address & ((1u << ADDRESS_BITS) - 1)) >> directory->layout.offset_bits;
+    uint64_t** page = &directory->pages[block >> DIRECTORY_PAGE_BITS];
+    if (*page == NULL) {
+        if (!is_sharer) {
+            return;
+        }
+        *page = calloc(DIRECTORY_PAGE_SIZE, sizeof(uint64_t));
+        if (*page == NULL) {
+            directory->out_of_memory = true;
+            return;
+        }
+    }
+    // A core thread drops the clean blocks that leave its victim buffer while the other cores run
+    SimAtomicBits* sharers = (SimAtomicBits*)&(*page)[block & (DIRECTORY_PAGE_SIZE - 1)];
+    Directory_LineChanged(directory);
+    if (is_sharer) {
+        SimAtomic_SetBits(sharers, 1ull << core);
+    } else {
+        SimAtomic_ClearBits(sharers, 1ull << core);
+    }
+}
+
+
+uint64_t Directory_Sharers(const Directory* directory, uint32_t address) {
+    // Without the page of a block that was cached, every cache is asked, as on a snooping bus
+    uint32_t block = (address & ((1u << ADDRESS_BITS) - 1)) >> directory->layout.offset_bits;
+    const uint64_t* page = directory->pages[block >> DIRECTORY_PAGE_BITS];
+    if (page == NULL) {
+        return directory->out_of_memory ? directory->all_cores : 0;
+    }
+    return page[block & (DIRECTORY_PAGE_SIZE - 1)];
+}
+
+
+void Directory_SetDirtySet(Directory* directory, uint32_t set, uint32_t core, bool is_dirty) {
+    // A write hit makes a line dirty while the other cores run
+    if (is_dirty) {
+        SimAtomic_SetBits((SimAtomicBits*)&directory->dirty_sets[set], 1ull << core);
+    } else {
+        SimAtomic_ClearBits((SimAtomicBits*)&directory->dirty_sets[set], 1ull << core);
+    }
+}
+
+
+uint64_t Directory_DirtyCaches(const Directory* directory, uint32_t address) {
+    return directory->dirty_sets[Address_Set(&directory->layout, address)];
+}
+
+
+void Directory_LineChanged(Directory* directory) {
+    SimAtomic_Increment((SimAtomic*)&directory->version);
+}
@@ -0,0 +1,180 @@
+/*!
+******************************************************************************
+file Dram.c
+
+Banked timing model of the main memory.
+
+The memory is split into banks that serve blocks at the same time. Each bank
+has a row buffer that holds the last row it opened (open page policy): a
+block of the open row is read with the row hit latency, a block of a bank
+with no open row needs the activation of its row, and a block of another row
+first needs the precharge of the open one. A bank serves one block at a time,
+a block of a busy bank waits until the bank is free.
+
+The rows are interleaved over the banks (page interleaving), so a stream of
+blocks stays in an open row until it moves to the next bank. The bank bits
+are XORed with every group of bank bits of the row above them, so that
+arrays that lie a multiple of the rows of all the banks apart fall in
+different banks instead of closing each other's rows. The timing model holds
+no data, the words are kept by the main memory.
+*****************************************************************************/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "../headers/Dram.h"
+#include "../headers/AddressLayout.h"
+
+/* Static Functions */
+static uint32_t log2_of(uint32_t value); // Bits of a power of 2
+static uint32_t row_of(const Dram* dram, uint32_t address); // Row of the address in its bank
+
+/* Functions implementations */
+static uint32_t log2_of(uint32_t value) {
+    uint32_t bits = 0;
+    while ((1u << bits) < value) {
+        bits++;
+    }
+    return bits;
+}
+
+
+void Dram_DefaultConfig(Dram_Config* config) {
+    config->banks = 0;
+    config->row_words = DEFAULT_DRAM_ROW_WORDS;
+    config->row_hit_latency = DEFAULT_DRAM_ROW_HIT_LATENCY;
+    config->row_miss_latency = DEFAULT_DRAM_ROW_MISS_LATENCY;
+    config->row_conflict_latency = DEFAULT_DRAM_ROW_CONFLICT_LATENCY;
+}
+
+
+bool Dram_ParseTiming(const char* timing, Dram_Config* config) {
+    // Three comma separated cycle counts, the hit, the miss and the conflict latency
+    uint32_t* latencies[] = { &config->row_hit_latency, &config->row_miss_latency, &config->row_conflict_latency };
+    const char* item = timing;
+    for (uint32_t i = 0; i < 3; i++) {
+        char* end = NULL;
+        unsigned long long latency = strtoull(item, &end, 0);
+        if (!isdigit((unsigned char)*item) || latency > UINT32_MAX || *end != ((i < 2) ? ',' : '\0')) {
+            return false;
+        }
+        *latencies[i] = (uint32_t)latency;
+        item = end + 1;
+    }
+    return true;
+}
+
+
+bool Dram_CheckConfig(const Dram_Config* config, uint32_t block_words) {
+    // The fields are checked together, as the options may come in any order
+    if (config->banks == 0) {
+        return true; // The single unit memory has the fixed latency
+    }
+    if (!AddressLayout_IsPowerOf2(config->banks) || config->banks > MAX_DRAM_BANKS) {
+        printf("Error: The number of memory banks must be a power of 2 up to %d\n", MAX_DRAM_BANKS);
+        return false;
+    }
+    if (!AddressLayout_IsPowerOf2(config->row_words) || config->row_words < block_words || config->row_words > MAX_DRAM_ROW_WORDS) {
+        printf("Error: The memory row must be a power of 2 from the cache line (%u) to %d words\n", block_words, MAX_DRAM_ROW_WORDS);
+        return false;
+    }
+    if ((uint64_t)config->banks * config->row_words > (1u << ADDRESS_BITS)) {
+        printf("Error: The rows of the memory banks must fit in the memory\n");
+        return false;
+    }
+    if (config->row_hit_latency == 0 || config->row_hit_latency > config->row_miss_latency ||
+        config->row_miss_latency > config->row_conflict_latency || config->row_conflict_latency > MAX_DRAM_LATENCY) {
+        printf("Error: The memory latencies must grow from the row hit (at least 1) to the row conflict (up to %d)\n", MAX_DRAM_LATENCY);
+        return false;
+    }
+    return true;
+}
+
+
+bool Dram_Init(Dram* dram, const Dram_Config* config) {
+    memset(dram, 0, sizeof(Dram));
+    dram->config = *config;
+    if (config->banks == 0) {
+        return true;
+    }
+    dram->column_bits = log2_of(config->row_words);
+    dram->bank_bits = log2_of(config->banks);
+    dram->bank_mask = config->banks - 1;
+    dram->row_shift = dram->column_bits + dram->bank_bits;
+    dram->banks = calloc(config->banks, sizeof(Dram_Bank));
+    return dram->banks != NULL;
+}
+
+
+void Dram_Free(Dram* dram) {
+    free(dram->banks);
+    dram->banks = NULL;
+}
+
+
+uint32_t Dram_BankOf(const Dram* dram, uint32_t address) {
+    // Fold the row into the bank bits
+    address &= (1u << ADDRESS_BITS) - 1;
+    uint32_t bank = address >> dram->column_bits;
+    for (uint32_t row = address >> dram->row_shift; row != 0 && dram->bank_bits > 0; row >>= dram->bank_bits) {
+        bank ^= row;
+    }
+    return bank & dram->bank_mask;
+}
+
+
+static uint32_t row_of(const Dram* dram, uint32_t address) {
+    return (address & ((1u << ADDRESS_BITS) - 1)) >> dram->row_shift;
+}
+
+
+uint32_t Dram_FreeCycle(const Dram* dram, uint32_t bank) {
+    return dram->banks[bank].busy_until;
+}
+
+
+bool Dram_IsRowOpen(const Dram* dram, uint32_t address) {
+    const Dram_Bank* bank = &dram->banks[Dram_BankOf(dram, address)];
+    return bank->is_row_open && bank->open_row == row_of(dram, address);
+}
+
+
+uint32_t Dram_Access(Dram* dram, uint32_t address, uint32_t cycle) {
+    // The row buffer decides the latency, the bank stays busy until the block leaves it
+    Dram_Bank* bank = &dram->banks[Dram_BankOf(dram, address)];
+    uint32_t row = row_of(dram, address);
+    uint32_t latency;
+    if (bank->is_row_open && bank->open_row == row) {
+        latency = dram->config.row_hit_latency;
+        bank->row_hits++;
+    } else if (!bank->is_row_open) {
+        latency = dram->config.row_miss_latency;
+        bank->row_misses++;
+    } else {
+        latency = dram->config.row_conflict_latency;
+        bank->row_conflicts++;
+    }
+    bank->is_row_open = true;
+    bank->open_row = row;
+    bank->accesses++;
+    bank->busy_cycles += latency;
+
+    uint32_t start = (bank->busy_until > cycle) ? bank->busy_until : cycle;
+    bank->busy_until = start + latency;
+    return bank->busy_until;
+}
+
+
+void Dram_PrintStats(const Dram* dram, FILE* file, uint32_t cycles) {
+    for (uint32_t i = 0; i < dram->config.banks; i++) {
+        const Dram_Bank* bank = &dram->banks[i];
+        uint64_t busy_cycles = (bank->busy_cycles < cycles) ? bank->busy_cycles : cycles;
+        fprintf(file, "bank%u_accesses %u\n", i, bank->accesses);
+        fprintf(file, "bank%u_row_hits %u\n", i, bank->row_hits);
+        fprintf(file, "bank%u_row_misses %u\n", i, bank->row_misses);
+        fprintf(file, "bank%u_row_conflicts %u\n", i, bank->row_conflicts);
+        fprintf(file, "bank%u_row_hit_rate %.4f\n", i, (bank->accesses == 0) ? 0.0 : (double)bank->row_hits / bank->accesses);
+        fprintf(file, "bank%u_utilization %.4f\n", i, (cycles == 0) ? 0.0 : (double)busy_cycles / cycles);
+    }
+}
@@ -16,36 +16,93 @@ It helps to centralize and streamline file management across the project.
 /* Includes */
 #ifdef _MSC_VER
 #define _CRT_SECURE_NO_WARNINGS
+#endif
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#endif
 
 #include "../headers/FilesManager.h"
-FILE* MemIn;
-FILE* MemOut;
-FILE* BusTrace;
+#include "../headers/MainMemory.h"
 
 /* Static Functions */
-static FILE* openFile(bool useRelativePath, const char* relativePath, const char* argvPath, const char* mode);
+static FILE* openFile(const char* directory, const char* defaultName, const char* argvPath, const char* mode);
+static FILE* openCoreFile(const char* directory, const char* defaultFormat, int core, char* argv[], int argIndex, const char* mode);
+static void closeFile(FILE* file);
+static bool loadImage(Mem_Image* image, const char* directory, const char* defaultBase, const char* argvPath, uint32_t maxWords);
 static bool fileCoreFailedToOpen(CoreFileHandles* coreFileHandles, int core);
-static bool fileFailedToOpen();
-CoreFileHandles coreFileHandlesArray[NUM_OF_CORES];
+static bool fileFailedToOpen(SimFiles* files);
+
+/* Defines */
+#define FILE_NAME_LENGTH 32
+#define FILE_PATH_LENGTH 1024
+// Per-core argument groups follow the order imem, memin, memout, regout, trace, bustrace, dsram, tsram, stats
+#define ARG_IMEM(n, core)    (1 + (core))
+#define ARG_MEMIN(n)         ((n) + 1)
+#define ARG_MEMOUT(n)        ((n) + 2)
+#define ARG_REGOUT(n, core)  ((n) + 3 + (core))
+#define ARG_TRACE(n, core)   (2 * (n) + 3 + (core))
+#define ARG_BUSTRACE(n)      (3 * (n) + 3)
+#define ARG_DSRAM(n, core)   (3 * (n) + 4 + (core))
+#define ARG_TSRAM(n, core)   (4 * (n) + 4 + (core))
+#define ARG_STATS(n, core)   (5 * (n) + 4 + (core))
+#define NUM_OF_ARGS(n)       (6 * (n) + 4)
 
 
 /* Functions */
-static FILE* openFile(bool useRelativePath, const char* relativePath, const char* argvPath, const char* mode) {
-    // Use relative path if no argument is provided
-    return fopen(useRelativePath ? relativePath : argvPath, mode);
+static FILE* openFile(const char* directory, const char* defaultName, const char* argvPath, const char* mode) {
+    // Use the default name in the directory if no argument is provided
+    char path[FILE_PATH_LENGTH];
+    if (argvPath != NULL) {
+        return fopen(argvPath, mode);
+    }
+    if (directory == NULL) {
+        return fopen(defaultName, mode);
+    }
+    snprintf(path, sizeof(path), "%s/%s", directory, defaultName);
+    return fopen(path, mode);
+}
+
+
+static FILE* openCoreFile(const char* directory, const char* defaultFormat, int core, char* argv[], int argIndex, const char* mode) {
+    // Open a core file, the default name is the format with the core number
+    char defaultName[FILE_NAME_LENGTH];
+    snprintf(defaultName, sizeof(defaultName), defaultFormat, core);
+    return openFile(directory, defaultName, (argv == NULL) ? NULL : argv[argIndex], mode);
+}
+
+
+static bool loadImage(Mem_Image* image, const char* directory, const char* defaultBase, const char* argvPath, uint32_t maxWords) {
+    // Load a memory image, the format is detected from the file. By default the binary image is used if it exists
+    char defaultName[FILE_NAME_LENGTH];
+    FILE* file = NULL;
+    if (argvPath == NULL) {
+        snprintf(defaultName, sizeof(defaultName), "%s.bin", defaultBase);
+        file = openFile(directory, defaultName, NULL, "rb");
+    }
+    if (file == NULL) {
+        snprintf(defaultName, sizeof(defaultName), "%s.txt", defaultBase);
+        file = openFile(directory, defaultName, argvPath, "rb");
+    }
+    if (file == NULL) {
+        return false;
+    }
+    // A mapped image stays valid after the file is closed
+    bool loaded = MemImage_Load(image, file, maxWords);
+    fclose(file);
+    return loaded;
+}
+
+
+static void closeFile(FILE* file) {
+    if (file != NULL) {
+        fclose(file);
+    }
 }
 
 
 static bool fileCoreFailedToOpen(CoreFileHandles* coreFileHandles, int core) {
     // Check if all core-specific files are open, if not, print which files failed to open
     bool failed = false;
-    if (coreFileHandles->instructionMemoryFile == NULL) {
-        printf("Error: Failed to open instruction memory file in core %d.\n", core);
-        failed = true;
-    }
     if (coreFileHandles->registerOutputFile == NULL) {
         printf("Error: Failed to open register output file in core %d.\n", core);
         failed = true;
@@ -71,26 +128,22 @@ static bool fileCoreFailedToOpen(CoreFileHandles* coreFileHandles, int core) {
 }
 
 
-static bool fileFailedToOpen() {
+static bool fileFailedToOpen(SimFiles* files) {
     // Check if global files failed to open
     bool failed = false;
 
-    if (MemIn == NULL) {
-        printf("Error: Failed to open MemIn file.\n");
-        failed = true;
-    }
-    if (MemOut == NULL) {
+    if (files->MemOut == NULL) {
         printf("Error: Failed to open MemOut file.\n");
         failed = true;
     }
-    if (BusTrace == NULL) {
+    if (files->BusTrace == NULL) {
         printf("Error: Failed to open BusTrace file.\n");
         failed = true;
     }
     printf("General files opened\n");
     // Check if any core-specific files failed to open
-    for (int core = 0; core < NUM_OF_CORES; core++) {
-        if (fileCoreFailedToOpen(&coreFileHandlesArray[core], core)) {
+    for (int core = 0; core < (int)files->numOfCores; core++) {
+        if (fileCoreFailedToOpen(&files->coreFileHandlesArray[core], core)) {
             failed = true;
         }
     }
@@ -98,42 +151,62 @@ static bool fileFailedToOpen() {
 }
 
 
-int OpenRequiredFiles(char* argv[], int argc) {
-    // Clear file arrays
-    memset(coreFileHandlesArray, 0, NUM_OF_CORES * sizeof(CoreFileHandles));
+int OpenRequiredFiles(SimFiles* files, char* argv[], int argc, const SimConfig* config, const char* directory) {
+    uint32_t num_of_cores = config->num_cores;
+    bool binaryTrace = config->trace_format != TRACE_FORMAT_TEXT;
+    // Allocate the per-core file handles
+    memset(files, 0, sizeof(SimFiles));
+    files->numOfCores = num_of_cores;
+    files->coreFileHandlesArray = calloc(num_of_cores, sizeof(CoreFileHandles));
+    if (files->coreFileHandlesArray == NULL) {
+        printf("Error: Failed to allocate the core file handles.\n");
+        return 1;
+    }
 
     // Check if arguments are provided; default to relative paths if not
-    bool relative_path_input;
+    int n = (int)num_of_cores;
     if (argc == 1) {
-        relative_path_input = true;
-    } else {
-        relative_path_input = false;
+        argv = NULL;
+    } else if (argc != NUM_OF_ARGS(n)) {
+        printf("Error: Expected %d file arguments for %d cores, got %d.\n", NUM_OF_ARGS(n) - 1, n, argc - 1);
+        return 1;
     }
 
     // Open global files
-    MemIn = openFile(relative_path_input, "memin.txt", argv[5], "r");
-    MemOut = openFile(relative_path_input, "memout.txt", argv[6], "w");
-    BusTrace = openFile(relative_path_input, "bustrace.txt", argv[15], "w");
+    bool imagesFailed = false;
+    if (!loadImage(&files->MemIn, directory, "memin", (argv == NULL) ? NULL : argv[ARG_MEMIN(n)], MAIN_MEMORY_SIZE)) {
+        printf("Error: Failed to load MemIn file.\n");
+        imagesFailed = true;
+    }
+    files->MemOut = openFile(directory, "memout.txt", (argv == NULL) ? NULL : argv[ARG_MEMOUT(n)], "w");
+    files->BusTrace = openFile(directory, binaryTrace ? "bustrace.bin" : "bustrace.txt", (argv == NULL) ? NULL : argv[ARG_BUSTRACE(n)], binaryTrace ? "wb" : "w");
+    bool statsFailed = false;
+    if (config->dram_stats) {
+        files->DramStats = openFile(directory, "dramstats.txt", NULL, "w");
+        if (files->DramStats == NULL) {
+            printf("Error: Failed to open DramStats file.\n");
+            statsFailed = true;
+        }
+    }
 
     // Open core files
-    const char* coreDefaults[NUM_OF_CORES][6] = {
-        {"imem0.txt", "regout0.txt", "core0trace.txt", "dsram0.txt", "tsram0.txt", "stats0.txt"},
-        {"imem1.txt", "regout1.txt", "core1trace.txt", "dsram1.txt", "tsram1.txt", "stats1.txt"},
-        {"imem2.txt", "regout2.txt", "core2trace.txt", "dsram2.txt", "tsram2.txt", "stats2.txt"},
-        {"imem3.txt", "regout3.txt", "core3trace.txt", "dsram3.txt", "tsram3.txt", "stats3.txt"}
-    };
-
-    for (int core = 0; core < NUM_OF_CORES; core++) {
-        coreFileHandlesArray[core].instructionMemoryFile = openFile(relative_path_input, coreDefaults[core][0], argv[1 + core], "r");
-        coreFileHandlesArray[core].registerOutputFile = openFile(relative_path_input, coreDefaults[core][1], argv[7 + core], "w");
-        coreFileHandlesArray[core].executionTraceFile = openFile(relative_path_input, coreDefaults[core][2], argv[11 + core], "w");
-        coreFileHandlesArray[core].dataCacheFile = openFile(relative_path_input, coreDefaults[core][3], argv[16 + core], "w");
-        coreFileHandlesArray[core].tagCacheFile = openFile(relative_path_input, coreDefaults[core][4], argv[20 + core], "w");
-        coreFileHandlesArray[core].coreStatsFile = openFile(relative_path_input, coreDefaults[core][5], argv[24 + core], "w");
+    CoreFileHandles* coreFiles = files->coreFileHandlesArray;
+    for (int core = 0; core < n; core++) {
+        char imemBase[FILE_NAME_LENGTH];
+        snprintf(imemBase, sizeof(imemBase), "imem%d", core);
+        if (!loadImage(&coreFiles[core].instructionMemory, directory, imemBase, (argv == NULL) ? NULL : argv[ARG_IMEM(n, core)], INSTRUCTIONMEMORYSIZE)) {
+            printf("Error: Failed to load instruction memory file in core %d.\n", core);
+            imagesFailed = true;
+        }
+        coreFiles[core].registerOutputFile = openCoreFile(directory, "regout%d.txt", core, argv, ARG_REGOUT(n, core), "w");
+        coreFiles[core].executionTraceFile = openCoreFile(directory, binaryTrace ? "core%dtrace.bin" : "core%dtrace.txt", core, argv, ARG_TRACE(n, core), binaryTrace ? "wb" : "w");
+        coreFiles[core].dataCacheFile = openCoreFile(directory, "dsram%d.txt", core, argv, ARG_DSRAM(n, core), "w");
+        coreFiles[core].tagCacheFile = openCoreFile(directory, "tsram%d.txt", core, argv, ARG_TSRAM(n, core), "w");
+        coreFiles[core].coreStatsFile = openCoreFile(directory, "stats%d.txt", core, argv, ARG_STATS(n, core), "w");
     }
 
     // Check if any files failed to open
-    if (fileFailedToOpen()) {
+    if (fileFailedToOpen(files) || imagesFailed || statsFailed) {
         printf("Error: One or more files failed to open.\n");
         return 1; // Failure
     }
@@ -141,19 +214,22 @@ int OpenRequiredFiles(char* argv[], int argc) {
 }
 
 
-void closeFiles(){
+void closeFiles(SimFiles* files){
     // Close global files
-    fclose(MemIn);
-    fclose(MemOut);
-    fclose(BusTrace);
+    MemImage_Release(&files->MemIn);
+    closeFile(files->MemOut);
+    closeFile(files->BusTrace);
+    closeFile(files->DramStats);
 
     // Close core files
-    for (int core = 0; core < NUM_OF_CORES; core++) {
-        fclose(coreFileHandlesArray[core].instructionMemoryFile);
-        fclose(coreFileHandlesArray[core].registerOutputFile);
-        fclose(coreFileHandlesArray[core].executionTraceFile);
-        fclose(coreFileHandlesArray[core].dataCacheFile);
-        fclose(coreFileHandlesArray[core].tagCacheFile);
-        fclose(coreFileHandlesArray[core].coreStatsFile);
+    for (uint32_t core = 0; files->coreFileHandlesArray != NULL && core < files->numOfCores; core++) {
+        MemImage_Release(&files->coreFileHandlesArray[core].instructionMemory);
+        closeFile(files->coreFileHandlesArray[core].registerOutputFile);
+        closeFile(files->coreFileHandlesArray[core].executionTraceFile);
+        closeFile(files->coreFileHandlesArray[core].dataCacheFile);
+        closeFile(files->coreFileHandlesArray[core].tagCacheFile);
+        closeFile(files->coreFileHandlesArray[core].coreStatsFile);
     }
+    free(files->coreFileHandlesArray);
+    memset(files, 0, sizeof(SimFiles));
 }
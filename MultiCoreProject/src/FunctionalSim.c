@@ -0,0 +1,176 @@
+/*!
+******************************************************************************
+file FunctionalSim.c
+
+Functional execution of the cores, without the pipeline, the caches and the bus.
+
+Each instruction runs to completion before the next one starts, a translated
+basic block of the core's BlockCache at a time, reading and writing the main
+memory directly. The pipeline stalls on every data hazard, so executing in
+program order gives the same register values. Branches resolve in decode, so
+the instruction after a branch (its delay slot) always runs before the target:
+the engine keeps the PC of the next two instructions.
+
+The cores take turns, each running a quantum of instructions, so a program that
+synchronizes the cores through the memory still makes progress.
+
+With warm_caches set the loads and stores go through the data cache of the core
+instead (Cache_FunctionalAccess), so the sampled simulation finds the TSRAM,
+DSRAM and MESI states a detailed run would have left.
+*****************************************************************************/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include "../headers/FunctionalSim.h"
+#include "../headers/OpcodeHandlers.h"
+#include "../headers/BlockCache.h"
+
+/* Static Functions */
+static bool all_cores_halted(const Functional_Core* states, uint32_t numOfCores); // Check if every core executed HALT
+static inline void branch(Functional_Core* state, uint32_t* regs, const Block_Op* op, uint32_t rd, bool taken); // Resolve a branch
+static uint32_t load_word(Functional_Core* state, ProcessorCore* core, Main_Memory* memory, uint32_t address); // Read data through the cache or the memory
+static void store_word(Functional_Core* state, ProcessorCore* core, Main_Memory* memory, uint32_t address, uint32_t data); // Write data through the cache or the memory
+
+/* Functions implementations */
+void FunctionalCore_Init(Functional_Core* state, const ProcessorCore* core) {
+    state->pc = core->pc;
+    state->next_pc = core->pc + 1;
+    state->halted = core->isHalted;
+    state->instructions = 0;
+    state->warm_caches = false;
+}
+
+void FunctionalCore_Sync(Functional_Core* state, const ProcessorCore* core) {
+    state->pc = core->pc;
+    state->next_pc = core->pc + 1;
+    state->halted = core->isHalted;
+}
+
+uint32_t FunctionalCore_LeaveDelaySlot(Functional_Core* state, ProcessorCore* core, Main_Memory* memory) {
+    // The next instruction is in a delay slot while the one after it is not sequential
+    uint32_t executed = 0;
+    while (!state->halted && state->next_pc != state->pc + 1) {
+        executed += FunctionalCore_Run(state, core, memory, 1);
+    }
+    return executed;
+}
+
+static inline void branch(Functional_Core* state, uint32_t* regs, const Block_Op* op, uint32_t rd, bool taken) {
+    // A taken branch redirects the instruction after the delay slot to the low bits of rd
+    if (taken) {
+        state->next_pc = rd & 0x1FF;
+    }
+    regs[op->wb_reg] = rd;
+}
+
+static uint32_t load_word(Functional_Core* state, ProcessorCore* core, Main_Memory* memory, uint32_t address) {
+    if (state->warm_caches) {
+        return Cache_FunctionalAccess(&core->pipelineController.data_in_cache, address, false, 0);
+    }
+    return MainMemoryRead(memory, address);
+}
+
+static void store_word(Functional_Core* state, ProcessorCore* core, Main_Memory* memory, uint32_t address, uint32_t data) {
+    if (state->warm_caches) {
+        Cache_FunctionalAccess(&core->pipelineController.data_in_cache, address, true, data);
+    } else {
+        MainMemoryWrite(memory, address, data);
+    }
+}
+
+uint32_t FunctionalCore_Run(Functional_Core* state, ProcessorCore* core, Main_Memory* memory, uint32_t max_instructions) {
+    uint32_t* regs = core->registers;
+
+    uint32_t executed = 0;
+    while (executed < max_instructions && !state->halted) {
+        // Run the block at the PC until it ends, the budget ends or the control leaves its straight line
+        uint32_t length = 0;
+        const Block_Op* op = BlockCache_Lookup(&core->block_cache, state->pc, &length);
+        const Block_Op* end = op + ((length < max_instructions - executed) ? length : max_instructions - executed);
+        bool sequential = true;
+        for (; op < end && sequential && !state->halted; op++) {
+            uint32_t pc = state->pc;
+            state->pc = state->next_pc;
+            state->next_pc++;
+            executed++;
+
+            // Read the operands, the immediate register holds the immediate of the instruction
+            regs[IMM_REG] = op->imm;
+            uint32_t rd = regs[op->rd];
+            uint32_t rs = regs[op->rs];
+            uint32_t rt = regs[op->rt];
+
+            switch (op->kind) {
+            case BLOCK_OP_ADD: regs[op->rd] = rs + rt; break;
+            case BLOCK_OP_SUB: regs[op->rd] = rs - rt; break;
+            case BLOCK_OP_AND: regs[op->rd] = rs & rt; break;
+            case BLOCK_OP_OR:  regs[op->rd] = rs | rt; break;
+            case BLOCK_OP_XOR: regs[op->rd] = rs ^ rt; break;
+            case BLOCK_OP_MUL: regs[op->rd] = rs * rt; break;
+            case BLOCK_OP_SLL: regs[op->rd] = rs << rt; break;
+            case BLOCK_OP_SRA: regs[op->rd] = (uint32_t)((int32_t)rs >> rt); break;
+            case BLOCK_OP_SRL: regs[op->rd] = rs >> rt; break;
+            case BLOCK_OP_BEQ: branch(state, regs, op, rd, rs == rt); break;
+            case BLOCK_OP_BNE: branch(state, regs, op, rd, rs != rt); break;
+            case BLOCK_OP_BLT: branch(state, regs, op, rd, rs < rt); break;
+            case BLOCK_OP_BGT: branch(state, regs, op, rd, rs > rt); break;
+            case BLOCK_OP_BLE: branch(state, regs, op, rd, rs <= rt); break;
+            case BLOCK_OP_BGE: branch(state, regs, op, rd, rs >= rt); break;
+            case BLOCK_OP_JAL: branch(state, regs, op, rd, true); break;
+            case BLOCK_OP_LW:  regs[op->rd] = load_word(state, core, memory, rs + rt); break;
+            case BLOCK_OP_SW:  store_word(state, core, memory, rs + rt, rd); break;
+            case BLOCK_OP_HALT: state->halted = true; break;
+            default: break; // An invalid opcode changes nothing
+            }
+
+            sequential = (state->pc == pc + 1);
+        }
+    }
+    state->instructions += executed;
+
+    // Leave the core at the next instruction, halted once it executed HALT
+    core->pc = state->pc;
+    core->isHalted = state->halted;
+    return executed;
+}
+
+static bool all_cores_halted(const Functional_Core* states, uint32_t numOfCores) {
+    for (uint32_t i = 0; i < numOfCores; i++) {
+        if (!states[i].halted) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t FunctionalSim_RunTurns(Functional_Core* states, ProcessorCore* cores, uint32_t numOfCores, Main_Memory* memory,
+    uint32_t quantum, uint64_t max_instructions) {
+    // Round robin over the cores, a quantum of instructions at a time, until every core ran max_instructions
+    uint64_t instructions = 0;
+    uint64_t turn_instructions = 0;
+    while (turn_instructions < max_instructions && !all_cores_halted(states, numOfCores)) {
+        uint64_t remaining = max_instructions - turn_instructions;
+        uint32_t turn = (remaining < quantum) ? (uint32_t)remaining : quantum;
+        for (uint32_t i = 0; i < numOfCores; i++) {
+            instructions += FunctionalCore_Run(&states[i], &cores[i], memory, turn);
+        }
+        turn_instructions += turn;
+    }
+    return instructions;
+}
+
+uint64_t FunctionalSim_Run(ProcessorCore* cores, uint32_t numOfCores, Main_Memory* memory, uint32_t quantum) {
+    Functional_Core* states = malloc(numOfCores * sizeof(Functional_Core));
+    if (states == NULL) {
+        printf("Error allocating the functional cores\n");
+        return 0;
+    }
+    for (uint32_t i = 0; i < numOfCores; i++) {
+        FunctionalCore_Init(&states[i], &cores[i]);
+    }
+
+    uint64_t instructions = FunctionalSim_RunTurns(states, cores, numOfCores, memory, quantum, UINT64_MAX);
+    free(states);
+    return instructions;
+}
@@ -4,52 +4,139 @@ file MainMemory.c
 
 Implementation of the main memory for the multicore processor simulator.
 
-This file defines the main memory of size 2^20 bytes and provides initialization,
+This file defines the main memory of size 2^20 words and provides initialization,
 transaction handling via the bus and printing.
+
+The memory is sparse: it is split into pages that are allocated on the first 
+write that changes them, so an instance only holds the pages its workload 
+touches. Until then a page reads from the memin image, which is used in place.
+
+With the split transaction bus the memory holds the reads in flight, at most one
+per core. A read is queued with the cycle at which its latency ends, and the bus
+sends its block once it is ready and the bus has no other data to move.
+
+With banks the latency of a block comes from the bank that holds it and its
+row buffer, instead of the fixed latency. A read waits for its bank, and a
+block that the bus writes at once still keeps its bank busy, so a read of
+another bank proceeds while a read of the same bank waits. With the split
+bus the reads of different banks overlap and may become ready out of order.
+The accesses reach the banks through the memory controller, which queues
+them and picks the next access of each free bank by its policy.
 ************************************************************/
 
 /* Includes */
 #ifdef _MSC_VER
 #define _CRT_SECURE_NO_WARNINGS
+#endif
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#endif
 #include "../headers/MainMemory.h"
 #include "../headers/BusController.h"
-#include "../headers/FilesManager.h"
-
-/* Global Variables */
-static uint32_t mainMemory[MAIN_MEMORY_SIZE]; // Main memory of size 2^20 bytes
-static uint32_t numOfCycles = 0; // Number of cycles taken by the main memory
-static bool gIsMemoryBusy = false; // Flag to indicate if the memory is busy
-uint32_t totalLines = 0; // Line in the program
 
 /* Static Functions */
-static size_t countMemoryLines(void); 
-static bool initialize_memory_transaction(bool direct_transaction);
-static bool process_memory_command(bus_transaction* transactionet);
-static void valuesToChange(bus_transaction* transaction);
-static bool bus_transaction_handler(bus_transaction* packet, bool direct_transaction);
+static size_t countMemoryLines(Main_Memory* memory); 
+static uint32_t block_ready_cycle(Main_Memory* memory, const bus_transaction* transaction, uint32_t cycle);
+static void update_ready_cycles(Main_Memory* memory, uint32_t cycle);
+static bool initialize_memory_transaction(Main_Memory* memory, const bus_transaction* transaction, bool direct_transaction, uint32_t cycle);
+static bool process_memory_command(Main_Memory* memory, bus_transaction* transactionet);
+static bool bus_transaction_handler(void* memory, bus_transaction* packet, bool direct_transaction, uint32_t cycle);
+static uint32_t latency_cycles_left(void* memory);
+static void skip_latency_cycles(void* memory, uint32_t cycles);
+static bool queue_read(void* memory, const bus_transaction* packet, uint32_t cycle);
+static bool take_ready_read(void* memory, uint32_t cycle, bus_transaction* packet);
+static uint32_t next_ready_cycle(void* memory, uint32_t cycle);
 
 /*Functions implementations*/
-void MainMemoryInit() {
-    // Initialize the main memory to the values from the input file. The rest of the memory is set to 0.
-    memset((uint8_t*)mainMemory, 0, sizeof(mainMemory));
-
-    // Read memory data from MemIn and load it into mainMemory
-    for (totalLines = 0; totalLines < MAIN_MEMORY_SIZE; totalLines++) {
-        if (fscanf(MemIn, "%08x", (uint32_t*)&(mainMemory[totalLines])) == EOF) {
-            break;  // Exit the loop if end of file is reached
-        }
+bool MainMemoryInit(Main_Memory* memory, Bus_Controller* bus, const Mem_Image* memin, const Dram_Config* dram, const Mc_Config* controller) {
+    // Initialize the main memory to the values of the input image. The rest of the memory reads as 0.
+    // The image is not copied: the pages read from it until they are first written.
+    memset(memory, 0, sizeof(Main_Memory));
+    memory->image = memin->words;
+    memory->imageWords = (memin->numOfWords < MAIN_MEMORY_SIZE) ? memin->numOfWords : MAIN_MEMORY_SIZE;
+    memory->highestWritten = memory->imageWords;
+    memory->blockWords = bus->layout.block_words; // The blocks of the bus
+    memory->maxPendingReads = bus->num_of_cores; // A core has one transaction at a time
+    memory->pendingReads = calloc(memory->maxPendingReads, sizeof(Memory_Read));
+    if (memory->pendingReads == NULL || !Dram_Init(&memory->dram, dram)) {
+        return false;
+    }
+    if (memory->dram.banks != NULL && !MemoryController_Init(&memory->controller, controller, &memory->dram, bus->num_of_cores)) {
+        return false;
+    }
+
+    ConfigureMemoryCallback_for_bus(bus, memory, bus_transaction_handler); // Register the memory callback function.
+    ConfigureMemoryTimingCallbacks_for_bus(bus, latency_cycles_left, skip_latency_cycles); // Register the fast forward callbacks.
+    ConfigureSplitMemoryCallbacks_for_bus(bus, queue_read, take_ready_read, next_ready_cycle); // Register the reads of the split bus.
+    return true;
+}
+
+
+void MainMemoryFree(Main_Memory* memory) {
+    for (uint32_t i = 0; i < MAIN_MEMORY_NUM_OF_PAGES; i++) {
+        free(memory->pages[i]);
+        memory->pages[i] = NULL;
+    }
+    free(memory->pendingReads);
+    memory->pendingReads = NULL;
+    memory->numOfPendingReads = 0;
+    MemoryController_Free(&memory->controller);
+    Dram_Free(&memory->dram);
+    memory->image = NULL;
+    memory->imageWords = 0;
+    memory->highestWritten = 0;
+}
+
+
+uint32_t MainMemoryRead(Main_Memory* memory, uint32_t address) {
+    // Words of pages that were never written come from the image, or read as 0 past its end.
+    address &= MAIN_MEMORY_SIZE - 1;
+    uint32_t* page = memory->pages[address >> MAIN_MEMORY_PAGE_BITS];
+    if (page != NULL) {
+        return page[address & (MAIN_MEMORY_PAGE_SIZE - 1)];
+    }
+    return (address < memory->imageWords) ? memory->image[address] : 0;
 }
-    ConfigureMemoryCallback_for_bus(bus_transaction_handler); // Register the memory callback function.
+
+
+bool MainMemoryWrite(Main_Memory* memory, uint32_t address, uint32_t value) {
+    // Allocate the page on the first write that changes it and keep track of the highest written address.
+    address &= MAIN_MEMORY_SIZE - 1;
+    uint32_t** page = &memory->pages[address >> MAIN_MEMORY_PAGE_BITS];
+    if (*page == NULL) {
+        if (MainMemoryRead(memory, address) == value) {
+            return true; // The page already holds the value
+        }
+        *page = calloc(MAIN_MEMORY_PAGE_SIZE, sizeof(uint32_t));
+        if (*page == NULL) {
+            printf("Error: Failed to allocate a main memory page.\n");
+            return false;
+        }
+        // Copy the part of the page that the image covers
+        uint32_t page_start = address & ~(uint32_t)(MAIN_MEMORY_PAGE_SIZE - 1);
+        if (page_start < memory->imageWords) {
+            uint32_t image_words = memory->imageWords - page_start;
+            image_words = (image_words < MAIN_MEMORY_PAGE_SIZE) ? image_words : MAIN_MEMORY_PAGE_SIZE;
+            memcpy(*page, memory->image + page_start, image_words * sizeof(uint32_t));
+        }
+    }
+    (*page)[address & (MAIN_MEMORY_PAGE_SIZE - 1)] = value;
+    if (value != 0 && address >= memory->highestWritten) {
+        memory->highestWritten = address + 1;
+    }
+    return true;
 }
 
 
-static size_t countMemoryLines(void) {
-    // Traverse the memory in reverse to count non-empty lines.
-    for (size_t i = MAIN_MEMORY_SIZE; i-- > 0;) {
-        if (mainMemory[i] != 0) { // Check if the memory location is not empty.
+static size_t countMemoryLines(Main_Memory* memory) {
+    // Traverse the memory in reverse, starting from the highest address that may be non zero, to count the used lines.
+    // Pages that were never written and lie past the image are skipped as a whole.
+    for (size_t i = memory->highestWritten; i-- > 0;) {
+        if (memory->pages[i >> MAIN_MEMORY_PAGE_BITS] == NULL && i >= memory->imageWords) {
+            i &= ~(size_t)(MAIN_MEMORY_PAGE_SIZE - 1); // Skip the rest of the page
+            continue;
+        }
+        if (MainMemoryRead(memory, (uint32_t)i) != 0) { // Check if the memory location is not empty.
             return i + 1; // Return the total number of used lines.
         }
     }
@@ -57,21 +144,53 @@ static size_t countMemoryLines(void) {
 }
 
 
-static bool initialize_memory_transaction(bool direct_transaction) {
+static uint32_t block_ready_cycle(Main_Memory* memory, const bus_transaction* transaction, uint32_t cycle) {
+    // Cycle of the first word of the block that the bus waits for, after the fixed latency or from its bank.
+    // Nothing reaches the controller while the bus waits, so it serves the request at once.
+    if (memory->dram.banks == NULL) {
+        return cycle + MAIN_MEMORY_LATENCY;
+    }
+    MemoryController_Request(&memory->controller, transaction->bus_addr, transaction->origid, transaction->bus_cmd != flush, true, cycle);
+    return MemoryController_Serve(&memory->controller, transaction->origid);
+}
+
+
+static void update_ready_cycles(Main_Memory* memory, uint32_t cycle) {
+    // The banks pick their requests until the cycle, the reads of the split bus learn their ready cycles.
+    if (memory->dram.banks == NULL) {
+        return;
+    }
+    MemoryController_Advance(&memory->controller, cycle);
+    for (uint32_t i = 0; i < memory->numOfPendingReads; i++) {
+        Memory_Read* read = &memory->pendingReads[i];
+        if (read->readyCycle == MC_NOT_SERVED) {
+            read->readyCycle = MemoryController_ReadyCycle(&memory->controller, read->request.origid);
+        }
+    }
+}
+
+
+static bool initialize_memory_transaction(Main_Memory* memory, const bus_transaction* transaction, bool direct_transaction, uint32_t cycle) {
     //This function initializes the transaction state.
-    if (!gIsMemoryBusy) {
-        gIsMemoryBusy = true;
-        if (direct_transaction) { 
-            numOfCycles = 16; 
+    if (!memory->isMemoryBusy) {
+        memory->isMemoryBusy = true;
+        memory->numOfCycles = 0;
+        if (!direct_transaction) {
+            memory->latency = block_ready_cycle(memory, transaction, cycle) - cycle;
         } else {
-            numOfCycles = 0; 
+            // The words move at once. A written block still occupies its bank, the block of a
+            // split read was accessed when the read was queued.
+            memory->latency = 0;
+            if (memory->dram.banks != NULL && transaction->bus_cmd == flush && !transaction->cache_to_cache) {
+                MemoryController_Request(&memory->controller, transaction->bus_addr, transaction->origid, false, false, cycle);
+            }
         }
     }
-    return gIsMemoryBusy;
+    return memory->isMemoryBusy;
 }
 
 
-static bool process_memory_command(bus_transaction* transaction) { 
+static bool process_memory_command(Main_Memory* memory, bus_transaction* transaction) { 
     // Process the memory command based on its type.
     if (transaction->bus_cmd == busRd || transaction->bus_cmd == busRdX)
 
@@ -79,60 +198,128 @@ static bool process_memory_command(bus_transaction* transaction) {
 			// send the memory value
 			transaction->origid = main_memory;
 			transaction->bus_cmd = flush;
-			transaction->bus_data = mainMemory[transaction->bus_addr];
+			transaction->bus_data = MainMemoryRead(memory, transaction->bus_addr);
 		}
-		else if (transaction->bus_cmd == flush)
+		else if (transaction->bus_cmd == flush && !transaction->cache_to_cache)
 		{
-			// write data to memory
-			mainMemory[transaction->bus_addr] = transaction->bus_data;
+			// write data to memory, unless a MOESI owner passes the block to another cache
+			MainMemoryWrite(memory, transaction->bus_addr, transaction->bus_data);
 		}
     return true;
 }
 
 
-
-
-static void valuesToChange(bus_transaction* transaction){ 
-    //This function changes the values of the packet.
-    transaction->origid = main_memory;
-    transaction->bus_cmd = flush;
-    transaction->bus_data = mainMemory[transaction->bus_addr];
-
-}
-
-
-static bool bus_transaction_handler(bus_transaction* transaction, bool direct_transaction) { 
+static bool bus_transaction_handler(void* data, bus_transaction* transaction, bool direct_transaction, uint32_t cycle) { 
     //This function handles the bus transaction for the main memory.
+    Main_Memory* memory = (Main_Memory*)data;
     if (transaction->bus_cmd == no_cmd) {
         return false; // No command to process
     }
     // Initialize transaction if needed
-    initialize_memory_transaction(direct_transaction);
+    initialize_memory_transaction(memory, transaction, direct_transaction, cycle);
     
     // Check if the transaction delay has been satisfied.
-    if (numOfCycles >= 16) {
+    if (memory->numOfCycles >= memory->latency) {
         // Process the memory command.
-        process_memory_command(transaction);
+        process_memory_command(memory, transaction);
 
-        // Mark transaction complete after 19 cycles.
-        if (numOfCycles == 19) {
-            gIsMemoryBusy = false;
+        // Mark transaction complete after the last word of the block.
+        if (memory->numOfCycles == memory->latency + memory->blockWords - 1) {
+            memory->isMemoryBusy = false;
         }
 
-        numOfCycles++;
+        memory->numOfCycles++;
         return true; // Transaction in progress or completed.
     }
 
-    numOfCycles++; // Increment delay counter.
+    memory->numOfCycles++; // Increment delay counter.
     return false;  // Waiting for delay to complete.
 }
 
 
-void MainMemoryPrint(FILE* file) {
+static uint32_t latency_cycles_left(void* data) {
+    // Number of coming bus iterations in which the memory only counts its delay.
+    // The first iteration of a transaction is never skipped, as the caches snoop it.
+    Main_Memory* memory = (Main_Memory*)data;
+    if (!memory->isMemoryBusy || memory->numOfCycles == 0 || memory->numOfCycles >= memory->latency) {
+        return 0;
+    }
+    return memory->latency - memory->numOfCycles;
+}
+
+
+static void skip_latency_cycles(void* data, uint32_t cycles) {
+    // Advance the delay counter as if the bus iterated the given number of cycles.
+    ((Main_Memory*)data)->numOfCycles += cycles;
+}
+
+
+static bool queue_read(void* data, const bus_transaction* packet, uint32_t cycle) {
+    // The split bus sent the request of a read, its block can be sent after the latency.
+    Main_Memory* memory = (Main_Memory*)data;
+    if (memory->numOfPendingReads == memory->maxPendingReads) {
+        return false;
+    }
+    Memory_Read* read = &memory->pendingReads[memory->numOfPendingReads++];
+    read->request = *packet;
+    read->readyCycle = cycle + MAIN_MEMORY_LATENCY;
+    if (memory->dram.banks != NULL) {
+        MemoryController_Request(&memory->controller, packet->bus_addr, packet->origid, true, true, cycle);
+        read->readyCycle = MC_NOT_SERVED; // Known once its bank picks it
+    }
+    return true;
+}
+
+
+static bool take_ready_read(void* data, uint32_t cycle, bus_transaction* packet) {
+    // Remove the oldest read whose latency elapsed, the bus sends its block from this cycle.
+    // The reads of different banks may become ready in another order than they were queued.
+    Main_Memory* memory = (Main_Memory*)data;
+    update_ready_cycles(memory, cycle);
+    for (uint32_t i = 0; i < memory->numOfPendingReads; i++) {
+        if (memory->pendingReads[i].readyCycle <= cycle) {
+            *packet = memory->pendingReads[i].request;
+            memory->numOfPendingReads--;
+            memmove(&memory->pendingReads[i], &memory->pendingReads[i + 1], (memory->numOfPendingReads - i) * sizeof(Memory_Read));
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static uint32_t next_ready_cycle(void* data, uint32_t cycle) {
+    // Bus cycle of the first read that becomes ready, UINT32_MAX if there is no read.
+    // The next pick of a bank may decide the ready cycle of a read, the bus doesn't skip it.
+    Main_Memory* memory = (Main_Memory*)data;
+    update_ready_cycles(memory, cycle);
+    uint32_t ready_cycle = UINT32_MAX;
+    for (uint32_t i = 0; i < memory->numOfPendingReads; i++) {
+        ready_cycle = (memory->pendingReads[i].readyCycle < ready_cycle) ? memory->pendingReads[i].readyCycle : ready_cycle;
+    }
+    if (memory->dram.banks != NULL) {
+        uint32_t decision_cycle = MemoryController_NextDecision(&memory->controller);
+        ready_cycle = (decision_cycle < ready_cycle) ? decision_cycle : ready_cycle;
+    }
+    return ready_cycle;
+}
+
+
+void MainMemoryPrint(Main_Memory* memory, FILE* file) {
     // Print the main memory contents in hexadecimal format.
-    uint32_t currentLines = 0;
-    currentLines = countMemoryLines();
+    uint32_t currentLines = (uint32_t)countMemoryLines(memory);
     for (uint32_t i = 0; i < currentLines; i++) {
-        fprintf(file, "%08X\n", mainMemory[i]);
+        fprintf(file, "%08X\n", MainMemoryRead(memory, i));
+    }
+}
+
+
+void MainMemoryPrintStats(Main_Memory* memory, FILE* file, uint32_t cycles) {
+    // Only the banked memory has statistics, the requests still queued are sent to their banks first.
+    if (memory->dram.banks == NULL) {
+        return;
     }
+    MemoryController_Advance(&memory->controller, UINT32_MAX);
+    Dram_PrintStats(&memory->dram, file, cycles);
+    MemoryController_PrintStats(&memory->controller, file, cycles);
 }
@@ -0,0 +1,196 @@
+/*!
+******************************************************************************
+file MemImage.c
+
+Loading of the instruction and data memory images.
+
+The images come either as the hex text files of the assignment (one word per 
+line) or as binary images with a small header. Binary images are mapped into 
+memory and used in place, so large data sets load without parsing or copying.
+The words of a binary image are stored in little endian order, which is the 
+byte order of the supported hosts.
+*****************************************************************************/
+
+/* Includes */
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../headers/MemImage.h"
+#ifdef _MSC_VER
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* Defines */
+#define TEXT_IMAGE_INITIAL_WORDS 1024
+
+/* Static Functions */
+static bool is_binary_image(FILE* file, Mem_Image_Header* header);
+static bool map_binary_image(Mem_Image* image, FILE* file, const Mem_Image_Header* header, uint32_t maxWords);
+static bool parse_text_image(Mem_Image* image, FILE* file, uint32_t maxWords);
+static bool write_binary_image(const Mem_Image* image, FILE* output);
+static bool write_text_image(const Mem_Image* image, FILE* output);
+
+/* Functions implementations */
+static bool is_binary_image(FILE* file, Mem_Image_Header* header) {
+    // Peek at the header, the file is rewound for the text parser if it is not a binary image
+    bool binary = fread(header, sizeof(*header), 1, file) == 1 &&
+                  memcmp(header->magic, MEM_IMAGE_MAGIC, MEM_IMAGE_MAGIC_LENGTH) == 0;
+    if (!binary) {
+        rewind(file);
+    }
+    return binary;
+}
+
+
+static bool map_binary_image(Mem_Image* image, FILE* file, const Mem_Image_Header* header, uint32_t maxWords) {
+    // Map the whole file read only, the words start right after the header
+    if (header->version != MEM_IMAGE_VERSION) {
+        printf("Error: Unsupported memory image version %u.\n", header->version);
+        return false;
+    }
+#ifdef _MSC_VER
+    LARGE_INTEGER size;
+    HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file));
+    if (handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(handle, &size)) {
+        return false;
+    }
+    image->mappingSize = (size_t)size.QuadPart;
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        return false;
+    }
+    image->mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping); // The view keeps the mapping alive
+    if (image->mapping == NULL) {
+        return false;
+    }
+#else
+    struct stat file_stat;
+    if (fstat(fileno(file), &file_stat) != 0) {
+        return false;
+    }
+    image->mappingSize = (size_t)file_stat.st_size;
+    image->mapping = mmap(NULL, image->mappingSize, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if (image->mapping == MAP_FAILED) {
+        image->mapping = NULL;
+        return false;
+    }
+#endif
+    // A truncated image only exposes the words that are present
+    size_t available = (image->mappingSize - sizeof(Mem_Image_Header)) / sizeof(uint32_t);
+    image->numOfWords = header->numOfWords;
+    if (image->numOfWords > available) {
+        printf("Warning: Memory image is truncated, loading %zu of %u words.\n", available, header->numOfWords);
+        image->numOfWords = (uint32_t)available;
+    }
+    if (image->numOfWords > maxWords) {
+        image->numOfWords = maxWords;
+    }
+    image->words = (const uint32_t*)((const char*)image->mapping + sizeof(Mem_Image_Header));
+    image->isBinary = true;
+    return true;
+}
+
+
+static bool parse_text_image(Mem_Image* image, FILE* file, uint32_t maxWords) {
+    // Parse one hex word per line into a buffer that grows as needed
+    uint32_t capacity = 0;
+    uint32_t value;
+    while (image->numOfWords < maxWords && fscanf(file, "%08x", &value) == 1) {
+        if (image->numOfWords == capacity) {
+            capacity = (capacity == 0) ? TEXT_IMAGE_INITIAL_WORDS : capacity * 2;
+            uint32_t* grown = realloc(image->buffer, (size_t)capacity * sizeof(uint32_t));
+            if (grown == NULL) {
+                printf("Error: Failed to allocate the memory image.\n");
+                return false;
+            }
+            image->buffer = grown;
+        }
+        image->buffer[image->numOfWords++] = value;
+    }
+    image->words = image->buffer;
+    return true;
+}
+
+
+bool MemImage_Load(Mem_Image* image, FILE* file, uint32_t maxWords) {
+    memset(image, 0, sizeof(Mem_Image));
+    Mem_Image_Header header;
+    bool loaded = is_binary_image(file, &header) ? map_binary_image(image, file, &header, maxWords)
+                                                  : parse_text_image(image, file, maxWords);
+    if (!loaded) {
+        MemImage_Release(image);
+    }
+    return loaded;
+}
+
+
+void MemImage_Release(Mem_Image* image) {
+    if (image->mapping != NULL) {
+#ifdef _MSC_VER
+        UnmapViewOfFile(image->mapping);
+#else
+        munmap(image->mapping, image->mappingSize);
+#endif
+    }
+    free(image->buffer);
+    memset(image, 0, sizeof(Mem_Image));
+}
+
+
+static bool write_binary_image(const Mem_Image* image, FILE* output) {
+    Mem_Image_Header header;
+    memcpy(header.magic, MEM_IMAGE_MAGIC, MEM_IMAGE_MAGIC_LENGTH);
+    header.version = MEM_IMAGE_VERSION;
+    header.numOfWords = image->numOfWords;
+    return fwrite(&header, sizeof(header), 1, output) == 1 &&
+           fwrite(image->words, sizeof(uint32_t), image->numOfWords, output) == image->numOfWords;
+}
+
+
+static bool write_text_image(const Mem_Image* image, FILE* output) {
+    // Same format as memout.txt
+    for (uint32_t i = 0; i < image->numOfWords; i++) {
+        if (fprintf(output, "%08X\n", image->words[i]) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+int MemImage_Convert(const char* inputPath, const char* outputPath) {
+    FILE* input = fopen(inputPath, "rb");
+    if (input == NULL) {
+        printf("Error: Failed to open %s.\n", inputPath);
+        return 1;
+    }
+    Mem_Image image;
+    if (!MemImage_Load(&image, input, UINT32_MAX)) {
+        printf("Error: Failed to load the memory image %s.\n", inputPath);
+        fclose(input);
+        return 1;
+    }
+
+    // The output takes the other format
+    FILE* output = fopen(outputPath, image.isBinary ? "w" : "wb");
+    bool written = output != NULL && (image.isBinary ? write_text_image(&image, output) : write_binary_image(&image, output));
+    if (output != NULL && fclose(output) != 0) {
+        written = false;
+    }
+    if (!written) {
+        printf("Error: Failed to write %s.\n", outputPath);
+    } else {
+        printf("Converted %u words from %s to %s (%s).\n", image.numOfWords, inputPath, outputPath, image.isBinary ? "text" : "binary");
+    }
+    MemImage_Release(&image);
+    fclose(input);
+    return written ? 0 : 1;
+}
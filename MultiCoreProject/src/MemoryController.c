@@ -0,0 +1,241 @@
+/*!
+******************************************************************************
+file MemoryController.c
+
+Request scheduler of the banked main memory.
+
+The accesses of the bus wait in a bounded queue in front of the banks. When
+a bank is free, it picks one of the requests that wait for it by the policy:
+the oldest (FCFS), a request of its open row before the oldest (FR-FCFS), or
+a request of the core that got the fewest bank cycles so far (fair). A
+request that waited past the starvation cap goes first in its bank, whatever
+the policy prefers. A full queue makes room with the next pick of the bank
+that is free first, made before the bank is free.
+
+The picks are made lazily, in the order of their cycles, when the memory
+asks for the requests before a cycle. A pick only uses the requests that
+arrived until its cycle, so the order doesn't depend on when it is made and
+the fast forward of the bus gives the same results.
+*****************************************************************************/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include "../headers/MemoryController.h"
+
+/* Static Functions */
+static uint64_t service_of(const Memory_Controller* controller, uint32_t core); // Bank cycles of a core, 0 for none
+static bool is_preferred(const Memory_Controller* controller, const Mc_Request* request, const Mc_Request* older);
+static uint32_t pick_request(Memory_Controller* controller, uint32_t bank, uint32_t cycle);
+static void issue_request(Memory_Controller* controller, uint32_t index, uint32_t cycle);
+static uint32_t next_decision(const Memory_Controller* controller, uint32_t* bank);
+static bool decide_next(Memory_Controller* controller, uint32_t before_cycle);
+
+/* Functions implementations */
+void MemoryController_DefaultConfig(Mc_Config* config) {
+    config->policy = MC_POLICY_FR_FCFS;
+    config->queue_size = DEFAULT_MC_QUEUE_SIZE;
+    config->starvation_cap = DEFAULT_MC_STARVATION_CAP;
+}
+
+
+bool MemoryController_ParsePolicy(const char* name, Mc_Policy* policy) {
+    if (strcmp(name, "fcfs") == 0) {
+        *policy = MC_POLICY_FCFS;
+    } else if (strcmp(name, "frfcfs") == 0) {
+        *policy = MC_POLICY_FR_FCFS;
+    } else if (strcmp(name, "fair") == 0) {
+        *policy = MC_POLICY_FAIR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+bool MemoryController_CheckConfig(const Mc_Config* config) {
+    if (config->queue_size == 0 || config->queue_size > MAX_MC_QUEUE_SIZE) {
+        printf("Error: The memory controller queue must hold 1 to %d requests\n", MAX_MC_QUEUE_SIZE);
+        return false;
+    }
+    return true;
+}
+
+
+bool MemoryController_Init(Memory_Controller* controller, const Mc_Config* config, Dram* dram, uint32_t num_cores) {
+    memset(controller, 0, sizeof(Memory_Controller));
+    controller->config = *config;
+    controller->dram = dram;
+    controller->num_cores = num_cores;
+    controller->queue = calloc(config->queue_size, sizeof(Mc_Request));
+    controller->cores = calloc(num_cores, sizeof(Mc_Core));
+    return controller->queue != NULL && controller->cores != NULL;
+}
+
+
+void MemoryController_Free(Memory_Controller* controller) {
+    free(controller->queue);
+    free(controller->cores);
+    controller->queue = NULL;
+    controller->cores = NULL;
+    controller->count = 0;
+}
+
+
+static uint64_t service_of(const Memory_Controller* controller, uint32_t core) {
+    return (core < controller->num_cores) ? controller->cores[core].service_cycles : 0;
+}
+
+
+static bool is_preferred(const Memory_Controller* controller, const Mc_Request* request, const Mc_Request* older) {
+    // Check if the policy picks the request over an older one of the same bank
+    if (controller->config.policy == MC_POLICY_FAIR) {
+        uint64_t service = service_of(controller, request->core);
+        uint64_t older_service = service_of(controller, older->core);
+        if (service != older_service) {
+            return service < older_service;
+        }
+    }
+    if (controller->config.policy == MC_POLICY_FCFS) {
+        return false;
+    }
+    return Dram_IsRowOpen(controller->dram, request->address) && !Dram_IsRowOpen(controller->dram, older->address);
+}
+
+
+static uint32_t pick_request(Memory_Controller* controller, uint32_t bank, uint32_t cycle) {
+    // The queue is kept oldest first, the first request of the bank is its oldest
+    uint32_t oldest = UINT32_MAX;
+    uint32_t picked = UINT32_MAX;
+    for (uint32_t i = 0; i < controller->count; i++) {
+        const Mc_Request* request = &controller->queue[i];
+        if (request->arrival > cycle || Dram_BankOf(controller->dram, request->address) != bank) {
+            continue;
+        }
+        if (oldest == UINT32_MAX) {
+            oldest = i;
+            picked = i;
+        } else if (is_preferred(controller, request, &controller->queue[picked])) {
+            picked = i;
+        }
+    }
+    // The oldest request goes first once it waited past the cap
+    uint32_t cap = controller->config.starvation_cap;
+    if (picked != oldest && cap > 0 && cycle - controller->queue[oldest].arrival >= cap) {
+        controller->starved_issues++;
+        picked = oldest;
+    }
+    return picked;
+}
+
+
+static void issue_request(Memory_Controller* controller, uint32_t index, uint32_t cycle) {
+    // Remove the request from the queue in the cycle, its bank starts it once it is free
+    Mc_Request request = controller->queue[index];
+    uint32_t start = Dram_FreeCycle(controller->dram, Dram_BankOf(controller->dram, request.address));
+    start = (start > cycle) ? start : cycle;
+    uint32_t ready = Dram_Access(controller->dram, request.address, start);
+    controller->requests++;
+    controller->wait_cycles += cycle - request.arrival;
+    if (request.core < controller->num_cores) {
+        Mc_Core* core = &controller->cores[request.core];
+        core->service_cycles += ready - start;
+        if (request.is_tracked) {
+            core->ready_cycle = ready;
+        }
+        if (request.is_read) {
+            core->reads++;
+            core->read_cycles += ready - request.arrival;
+        }
+    }
+    controller->count--;
+    memmove(&controller->queue[index], &controller->queue[index + 1], (controller->count - index) * sizeof(Mc_Request));
+}
+
+
+static uint32_t next_decision(const Memory_Controller* controller, uint32_t* bank) {
+    // The bank that is free first with a request waiting for it picks before the others
+    uint32_t decision_cycle = UINT32_MAX;
+    *bank = 0;
+    for (uint32_t i = 0; i < controller->count; i++) {
+        uint32_t request_bank = Dram_BankOf(controller->dram, controller->queue[i].address);
+        uint32_t cycle = Dram_FreeCycle(controller->dram, request_bank);
+        cycle = (cycle > controller->queue[i].arrival) ? cycle : controller->queue[i].arrival;
+        if (cycle < decision_cycle || (cycle == decision_cycle && request_bank < *bank)) {
+            decision_cycle = cycle;
+            *bank = request_bank;
+        }
+    }
+    return decision_cycle;
+}
+
+
+static bool decide_next(Memory_Controller* controller, uint32_t before_cycle) {
+    uint32_t bank;
+    uint32_t decision_cycle = next_decision(controller, &bank);
+    if (decision_cycle >= before_cycle) {
+        return false;
+    }
+    issue_request(controller, pick_request(controller, bank, decision_cycle), decision_cycle);
+    return true;
+}
+
+
+void MemoryController_Request(Memory_Controller* controller, uint32_t address, uint32_t core, bool is_read, bool is_tracked, uint32_t cycle) {
+    // The queue holds what is still waiting in the cycle, a full queue makes room with its oldest request
+    MemoryController_Advance(controller, cycle);
+    if (controller->count == controller->config.queue_size) {
+        uint32_t bank;
+        uint32_t decision_cycle = next_decision(controller, &bank);
+        controller->full_issues++;
+        issue_request(controller, pick_request(controller, bank, decision_cycle), cycle);
+    }
+    Mc_Request* request = &controller->queue[controller->count++];
+    request->address = address;
+    request->core = core;
+    request->arrival = cycle;
+    request->is_read = is_read;
+    request->is_tracked = is_tracked;
+    if (is_tracked && core < controller->num_cores) {
+        controller->cores[core].ready_cycle = MC_NOT_SERVED;
+    }
+    controller->max_occupancy = (controller->count > controller->max_occupancy) ? controller->count : controller->max_occupancy;
+}
+
+
+void MemoryController_Advance(Memory_Controller* controller, uint32_t cycle) {
+    while (decide_next(controller, cycle)) {
+    }
+}
+
+
+uint32_t MemoryController_Serve(Memory_Controller* controller, uint32_t core) {
+    while (controller->cores[core].ready_cycle == MC_NOT_SERVED && decide_next(controller, UINT32_MAX)) {
+    }
+    return controller->cores[core].ready_cycle;
+}
+
+
+uint32_t MemoryController_ReadyCycle(const Memory_Controller* controller, uint32_t core) {
+    return controller->cores[core].ready_cycle;
+}
+
+
+uint32_t MemoryController_NextDecision(const Memory_Controller* controller) {
+    uint32_t bank;
+    return next_decision(controller, &bank);
+}
+
+
+void MemoryController_PrintStats(const Memory_Controller* controller, FILE* file, uint32_t cycles) {
+    fprintf(file, "mc_requests %llu\n", (unsigned long long)controller->requests);
+    fprintf(file, "mc_avg_occupancy %.4f\n", (cycles == 0) ? 0.0 : (double)controller->wait_cycles / cycles);
+    fprintf(file, "mc_max_occupancy %u\n", controller->max_occupancy);
+    fprintf(file, "mc_full_issues %u\n", controller->full_issues);
+    fprintf(file, "mc_starved_issues %u\n", controller->starved_issues);
+    for (uint32_t i = 0; i < controller->num_cores; i++) {
+        const Mc_Core* core = &controller->cores[i];
+        fprintf(file, "core%u_reads %u\n", i, core->reads);
+        fprintf(file, "core%u_avg_read_latency %.4f\n", i, (core->reads == 0) ? 0.0 : (double)core->read_cycles / core->reads);
+    }
+}
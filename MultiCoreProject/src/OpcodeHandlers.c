@@ -1,5 +1,6 @@
 /* Includes */
 #include "../headers/OpcodeHandlers.h"
+#include "../headers/sim.h"
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -163,3 +164,41 @@ bool IsOpcodeBranch(uint16_t opcode) {
 bool IsOpcodeMemory(uint16_t opcode) {
     return opcode == LW || opcode == SW;
 }
+
+/* Decode Functions */
+
+/* DecodeInstruction: Splits an instruction word into its fields, class, handler and register masks.
+ * The immediate register receives the 12 bits immediate field as is.
+ * Inputs: cmd - the instruction word, decoded - the output
+ * Return: None
+ */
+void DecodeInstruction(uint32_t cmd, Decoded_Instruction* decoded) {
+    Format_of_instruction instruction = { .cmd = cmd };
+    uint8_t opcode = (uint8_t)instruction.received_op.opcode;
+
+    decoded->opcode = opcode;
+    decoded->rd = (uint8_t)instruction.received_op.rd;
+    decoded->rs = (uint8_t)instruction.received_op.rs;
+    decoded->rt = (uint8_t)instruction.received_op.rt;
+    decoded->imm = instruction.received_op.imm;
+    decoded->wb_reg = (opcode == JAL) ? PC_REG : decoded->rd;
+
+    if (opcode == HALT) {
+        decoded->op_class = OPCLASS_HALT;
+    } else if (IsOpcodeBranch(opcode)) {
+        decoded->op_class = OPCLASS_BRANCH;
+    } else if (IsOpcodeMemory(opcode)) {
+        decoded->op_class = OPCLASS_MEMORY;
+    } else if (opcode < NUMBER_OPCODES && OpcodeFunctionTable[opcode] != NULL) {
+        decoded->op_class = OPCLASS_ALU;
+    } else {
+        decoded->op_class = OPCLASS_INVALID;
+    }
+    decoded->operation = (opcode < NUMBER_OPCODES) ? OpcodeFunctionTable[opcode] : NULL;
+
+    // The zero and immediate registers never cause a hazard
+    decoded->write_mask = (decoded->rd == ZERO_REG || decoded->rd == IMM_REG) ? 0 : (uint16_t)(1u << decoded->rd);
+    decoded->read_mask_rs_rt = (uint16_t)((1u << decoded->rs) | (1u << decoded->rt));
+    decoded->read_mask = (opcode <= SRL || opcode == LW) ? decoded->read_mask_rs_rt
+                                                         : (uint16_t)(decoded->read_mask_rs_rt | (1u << decoded->rd));
+}
@@ -22,7 +22,7 @@ static void writeback(Pipe_fig* pipeline);
 static void execute_pipe_stages(Pipe_fig* pipeline);
 static void enter_params_to_regs(Pipe_fig* pipeline, Pipe_figstate stage);
 static bool checkfor_data_hazards(Pipe_fig* pipeline);
-static bool check_hazrads_by_comparing_regs(Pipe_fig* pipeline, Pipe_figstate stage);
+static bool check_hazrads_by_comparing_regs(Pipe_fig* pipeline, Pipe_figstate stage, uint16_t read_mask);
 static void stats_update(Pipe_fig* pipeline);
 
 // Array of function pointers corresponding to each pipeline stage.
@@ -49,8 +49,9 @@ void Pipe_Init(Pipe_fig *pipeline) {
     // Clear the params_of_op structure
 	memset((uint8_t *) &pipeline->params_of_op, 0, sizeof(pipeline->params_of_op));
 
-    // Clear the stages of the pipeline
+    // Clear the stages of the pipeline, they hold the zero instruction word until the first fetch
     memset((uint8_t*) pipeline->stages_in_pipe, 0, sizeof(pipeline->stages_in_pipe));
+    DecodeInstruction(0, &pipeline->empty_instruction);
 
     // Set the halt flag to the is_halted flag
 	pipeline->params_of_op.halt = &pipeline->is_halted;
@@ -64,6 +65,7 @@ void Pipe_Init(Pipe_fig *pipeline) {
 
     // Set the program counter to a default value
     pipeline->stages_in_pipe[stage].pc = UINT16_MAX;
+    pipeline->stages_in_pipe[stage].decoded = &pipeline->empty_instruction;
 }
 
     // Set the program counter of the fetch stage to 0
@@ -72,6 +74,44 @@ void Pipe_Init(Pipe_fig *pipeline) {
 
 }
 
+/* void Pipe_Restart(Pipe_fig* pipeline) : empty the pipeline and start fetching at the current PC */
+void Pipe_Restart(Pipe_fig* pipeline) {
+
+    // Clear the flags, the cache, the stats and the pointers to the core stay as they are
+    pipeline->is_halted = false;
+    pipeline->data_stall = false;
+    pipeline->mem_stall = false;
+    pipeline->decode_pending = false;
+    pipeline->drain_requested = false;
+    pipeline->is_draining = false;
+    pipeline->last_decoded_branch = false;
+
+    // Empty the stages, the fetch stage is valid so the pipeline doesn't look flushed before the first fetch
+    for (int stage = FETCH; stage < PIPE_SIZE; stage++) {
+        pipeline->stages_in_pipe[stage].pc = UINT16_MAX;
+        pipeline->stages_in_pipe[stage].decoded = &pipeline->empty_instruction;
+    }
+    pipeline->stages_in_pipe[FETCH].pc = *(pipeline->params_of_op.pc);
+}
+
+/* void Pipe_RequestDrain(Pipe_fig* pipeline) : stop fetching at the next instruction boundary */
+void Pipe_RequestDrain(Pipe_fig* pipeline) {
+    pipeline->drain_requested = true;
+}
+
+/* bool Pipe_IsDrained(Pipe_fig* pipeline) : true once the drain stopped the fetch and the older instructions left the pipeline */
+bool Pipe_IsDrained(Pipe_fig* pipeline) {
+    if (!pipeline->is_draining) {
+        return false;
+    }
+    for (int stage = FETCH; stage < PIPE_SIZE; stage++) {
+        if (pipeline->stages_in_pipe[stage].pc != UINT16_MAX) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /* void Pipe_iteration_exe(Pipe_fig* pipeline) : execute an iteration of the pipeline based on it's condition */
 void Pipe_iteration_exe(Pipe_fig* pipeline) {
 
@@ -108,6 +148,20 @@ bool Pipe_Flush(Pipe_fig* pipeline){
 
 }
 
+/* bool Pipe_IsWaitingForMemory(Pipe_fig* pipeline) : true if the next cycles only repeat the memory stall, 
+   as the MEM stage can't proceed until the bus serves the cache */
+bool Pipe_IsWaitingForMemory(Pipe_fig* pipeline){
+
+    // A memory stall leaves a bubble in the WRITE_BACK stage, so nothing but the MEM stage is active
+    return pipeline->mem_stall && Cache_IsWaitingForBus(&pipeline->data_in_cache);
+}
+
+/* void Pipe_SkipMemStallCycles(Pipe_fig* pipeline, uint32_t cycles) : update the stats for skipped stalled cycles */
+void Pipe_SkipMemStallCycles(Pipe_fig* pipeline, uint32_t cycles){
+    pipeline->stats.stalls_in_mem += cycles;
+    pipeline->stats.stalls_in_bus_queue += Cache_IsWaitingForBusQueue(&pipeline->data_in_cache) ? cycles : 0;
+}
+
 /* void Pipe_ToTrace(Pipe_fig* pipeline, FILE *trace_file) : making the pipeline tracing file */
 
 void Pipe_ToTrace(Pipe_fig* pipeline, FILE *trace_file){
@@ -123,8 +177,7 @@ void Pipe_ToTrace(Pipe_fig* pipeline, FILE *trace_file){
 /*void BubbleStage(Pipe_instruction_stage* dest, const Pipe_instruction_stage* src) : bubbling condition to next stage */
 void BubbleStage(Pipe_instruction_stage* dest, const Pipe_instruction_stage* src) {
     dest->pc = src->pc;
-    dest->instruction.cmd = src->instruction.cmd;
-    dest->operation = *src->operation;
+    dest->decoded = src->decoded;
     dest->result_of_execution = src->result_of_execution;
 }
 
@@ -136,7 +189,8 @@ void Pipe_Bubbles(Pipe_fig* pipeline) {
         if (pipeline->mem_stall) {
             pipeline->stages_in_pipe[WRITE_BACK].pc = UINT16_MAX;
             break; // Stop processing further stages
-        } else if (pipeline->data_stall && stage == EXECUTE) {
+        } else if ((pipeline->data_stall || pipeline->decode_pending) && stage == EXECUTE) {
+            // The instruction in decode waits for its hazard, or a memory stall started before it could be decoded
             pipeline->stages_in_pipe[EXECUTE].pc = UINT16_MAX;
             break; // Stop processing further stages
         } else if (pipeline->stages_in_pipe[stage - 1].pc == UINT16_MAX) {
@@ -146,8 +200,8 @@ void Pipe_Bubbles(Pipe_fig* pipeline) {
         }
     }
 
-    // Handle halted pipeline state
-    if (pipeline->is_halted) {
+    // Handle halted or draining pipeline state
+    if (pipeline->is_halted || pipeline->is_draining) {
         pipeline->stages_in_pipe[FETCH].pc = UINT16_MAX;
         pipeline->stages_in_pipe[DECODE].pc = UINT16_MAX;
     }
@@ -166,8 +220,8 @@ static void fetch(Pipe_fig* pipeline)
     // Fetch the program counter (PC) value from the pipeline's opcode parameters
 	pipeline->stages_in_pipe[FETCH].pc = *(pipeline->params_of_op.pc);
     
-    // Use the current PC value to fetch the instruction from the instruction memory.
-	pipeline->stages_in_pipe[FETCH].instruction.cmd = pipeline->insturcionts_pnt[*(pipeline->params_of_op.pc)];
+    // Use the current PC value to fetch the decoded instruction from the instruction memory.
+	pipeline->stages_in_pipe[FETCH].decoded = &pipeline->insturcionts_pnt[*(pipeline->params_of_op.pc) & (INSTRUCTIONMEMORYSIZE - 1)];
 
     // If there is no data stall, increment the program counter (PC) to point to the next instruction.
 	if (!pipeline->data_stall) 
@@ -179,39 +233,44 @@ static void fetch(Pipe_fig* pipeline)
 /* void decode(Pipe_fig* pipeline) : Decode stage of the pipeline. use functions from OpcodeHandlers */
 static void decode(Pipe_fig* pipeline)
 {
-	
-    // Get the opcode from the instruction in the decode stage
-    uint16_t opcode = pipeline->stages_in_pipe[DECODE].instruction.received_op.opcode;
+    const Decoded_Instruction* decoded = pipeline->stages_in_pipe[DECODE].decoded;
+
+    // A requested drain stops here, unless the instruction is in the delay slot of the branch decoded before it.
+    // The instruction is dropped and the PC points back to it, the older instructions complete.
+    if (pipeline->drain_requested && !pipeline->last_decoded_branch)
+    {
+        pipeline->is_draining = true;
+        *(pipeline->params_of_op.pc) = pipeline->stages_in_pipe[DECODE].pc;
+        pipeline->stages_in_pipe[DECODE].pc = UINT16_MAX;
+        return;
+    }
+    pipeline->last_decoded_branch = (decoded->op_class == OPCLASS_BRANCH);
 
     //if the opcode means HALT, set the pipeline to halt
-	if (opcode == HALT) 
+	if (decoded->op_class == OPCLASS_HALT) 
 	{
 		pipeline->is_halted = true;
 		return;
 	}
 
-	// decode the instruction
-    pipeline->stages_in_pipe[DECODE].operation = OpcodeFunctionTable[opcode];
-    
-    // If the opcode is of branch operation, prepare the registers parameters
-    if (IsOpcodeBranch(pipeline->stages_in_pipe[DECODE].instruction.received_op.opcode))
+    // If the opcode is of branch operation, prepare the registers parameters and resolve the branch
+    if (decoded->op_class == OPCLASS_BRANCH)
 	{
 		enter_params_to_regs(pipeline, DECODE);
-		pipeline->stages_in_pipe[DECODE].operation(&pipeline->params_of_op);
+		decoded->operation(&pipeline->params_of_op);
 	}
 }
 
 /* void execute(Pipe_fig* pipeline) : Execute stage of the pipeline*/
 static void execute(Pipe_fig* pipeline)
 {
-    // Extract the opcode of the instruction currently in the EXECUTE stage.
-    uint16_t opcode = pipeline->stages_in_pipe[EXECUTE].instruction.received_op.opcode;
+    const Decoded_Instruction* decoded = pipeline->stages_in_pipe[EXECUTE].decoded;
 
     // If the opcode is not a branch or memory operation, prepare the registers parameters and perform the operation
-	if (!IsOpcodeBranch(opcode) && !IsOpcodeMemory(opcode) && opcode != HALT)
+	if (decoded->op_class == OPCLASS_ALU)
 	{
 		enter_params_to_regs(pipeline, EXECUTE);
-		pipeline->stages_in_pipe[EXECUTE].operation(&pipeline->params_of_op);
+		decoded->operation(&pipeline->params_of_op);
 	}
 }
 
@@ -219,11 +278,10 @@ static void execute(Pipe_fig* pipeline)
 /* void mem(Pipe_fig* pipeline) : Memory stage of the pipeline */
 static void mem(Pipe_fig* pipeline){ 
 
-    // Extract the opcode of the instruction currently in the MEM stage.
-    uint16_t opcode = pipeline->stages_in_pipe[MEM].instruction.received_op.opcode;
+    const Decoded_Instruction* decoded = pipeline->stages_in_pipe[MEM].decoded;
 
     // Check if the opcode corresponds to a memory-related instruction.
-    if (IsOpcodeMemory(opcode))
+    if (decoded->op_class == OPCLASS_MEMORY)
     {
         // Prepare the necessary parameters (register values) for the memory operation.
         enter_params_to_regs(pipeline, MEM);
@@ -238,13 +296,13 @@ static void mem(Pipe_fig* pipeline){
         // - If the opcode is LW (Load Word), read data from the cache.
         // - Otherwise, write data to the cache (SW).
         bool success;
-        if (opcode == LW)
+        if (decoded->opcode == LW)
         {
-            success = Read_Data_from_Cache(&pipeline->data_in_cache, adr, data);
+            success = Read_Data_from_Cache(&pipeline->data_in_cache, pipeline->stages_in_pipe[MEM].pc, adr, data);
         }
         else
         {
-            success = Write_Data_to_Cache(&pipeline->data_in_cache, adr, *data);
+            success = Write_Data_to_Cache(&pipeline->data_in_cache, pipeline->stages_in_pipe[MEM].pc, adr, *data);
         }
 
         // If the operation was not successful, the pipeline stalls.
@@ -256,26 +314,10 @@ static void mem(Pipe_fig* pipeline){
 /* void writeback(Pipe_fig* pipeline) : Write back stage of the pipeline */
 static void writeback(Pipe_fig* pipeline){
 
-    // Extract the instruction currently in the WRITE_BACK stage.
-    Format_of_instruction instruction = { 
-        .cmd = pipeline->stages_in_pipe[WRITE_BACK].instruction.cmd 
-    };
-
-    // Determine the register index to update:
-    // - If the instruction is JAL (Jump and Link), the target is the program counter register.
-    // - Otherwise, it's the destination register (rd).
-    int chosen_reg;
-    if (instruction.received_op.opcode == JAL)
-    {
-        chosen_reg = PC_REG;
-    }
-    else
-    {
-        chosen_reg = instruction.received_op.rd;
-    }
-
-    // Write the result from the EXECUTE stage into the determined register.
-    pipeline->regs_pnt[chosen_reg] = pipeline->stages_in_pipe[WRITE_BACK].result_of_execution;
+    // Write the result from the EXECUTE stage into the register of the instruction,
+    // the program counter register for JAL (Jump and Link) and the destination register (rd) otherwise.
+    const Pipe_instruction_stage* stage = &pipeline->stages_in_pipe[WRITE_BACK];
+    pipeline->regs_pnt[stage->decoded->wb_reg] = stage->result_of_execution;
 }
 
 
@@ -283,19 +325,18 @@ static void writeback(Pipe_fig* pipeline){
 /*void enter_params_to_regs(Pipe_fig* pipeline, Pipe_figstate stage) : transfer parameters to registers for the operations */
 static void enter_params_to_regs(Pipe_fig* pipeline, Pipe_figstate stage)
 {
-    // Extract the instruction from the given pipeline stage
-    Format_of_instruction instuction = {.cmd = pipeline->stages_in_pipe[stage].instruction.cmd};
+    const Decoded_Instruction* decoded = pipeline->stages_in_pipe[stage].decoded;
 
     // Store the immediate value from the instruction 
-    pipeline->regs_pnt[IMM_REG] = instuction.received_op.imm;
+    pipeline->regs_pnt[IMM_REG] = decoded->imm;
 
     // Set the execute result of the current pipeline stage to the value in the register 'rd'
-    pipeline->stages_in_pipe[stage].result_of_execution = pipeline->regs_pnt[instuction.received_op.rd];
+    pipeline->stages_in_pipe[stage].result_of_execution = pipeline->regs_pnt[decoded->rd];
 
     // Load the register values
     pipeline->params_of_op.rd = &pipeline->stages_in_pipe[stage].result_of_execution;
-    pipeline->params_of_op.rs = pipeline->regs_pnt[instuction.received_op.rs];
-    pipeline->params_of_op.rt = pipeline->regs_pnt[instuction.received_op.rt];
+    pipeline->params_of_op.rs = pipeline->regs_pnt[decoded->rs];
+    pipeline->params_of_op.rt = pipeline->regs_pnt[decoded->rt];
 }
 
 
@@ -313,8 +354,11 @@ static void execute_pipe_stages(Pipe_fig* pipeline){
         stage = DECODE; // No stalls so we can execute the DECODE stage
     }
 
-    // If the pipeline is not halted, fetch the next instruction
-    if(!pipeline->is_halted){
+    // The instruction in decode stays there until it is decoded, even if a memory stall ends first
+    pipeline->decode_pending = (stage == MEM) ? pipeline->decode_pending : (stage == EXECUTE);
+
+    // If the pipeline is not halted or draining, fetch the next instruction
+    if(!pipeline->is_halted && !pipeline->is_draining){
         stage_to_exe[FETCH](pipeline);
     }
 
@@ -330,48 +374,15 @@ static void execute_pipe_stages(Pipe_fig* pipeline){
 }
 
 
-/*bool check_hazrads_by_comparing_regs(Pipe_fig* pipeline, Pipe_figstate stage) : looking for potential hazards by comparing registers
-in differents stages of the pipeline*/
-static bool check_hazrads_by_comparing_regs(Pipe_fig* pipeline, Pipe_figstate stage)
+/*bool check_hazrads_by_comparing_regs(Pipe_fig* pipeline, Pipe_figstate stage, uint16_t read_mask) : looking for potential hazards by 
+comparing the register written by a stage with the registers read by the instruction in decode*/
+static bool check_hazrads_by_comparing_regs(Pipe_fig* pipeline, Pipe_figstate stage, uint16_t read_mask)
 {
-    bool is_hazard = false;
-    
     // Check if the PC is invalid (no instruction in the stage)
     if (pipeline->stages_in_pipe[stage].pc == UINT16_MAX) return false;
-    
-
-    // Extract the destination register (rd) of the instruction at the given pipeline stage
-    uint16_t reg = pipeline->stages_in_pipe[stage].instruction.received_op.rd;
 
-
-    // Retrieve the instruction from the DECODE stage to check for register dependencies
-    Format_of_instruction ins_in_decode = pipeline->stages_in_pipe[DECODE].instruction;
-
-    // Extract the opcode of the instruction in the WRITE_BACK stage
-    uint16_t op = pipeline->stages_in_pipe[WRITE_BACK].instruction.received_op.opcode;
-
-    // Immediate register and zero register aren't involved in hazards
-    if (reg == IMM_REG || reg == ZERO_REG )
-    {
-        is_hazard = false;
-    }
-
-    // for operations that use rs and rt we need to check if the destination register is one of them
-    else if (ins_in_decode.received_op.opcode <= SRL || ins_in_decode.received_op.opcode == LW ||
-             (ins_in_decode.received_op.opcode == SW && op == SW))
-    {
-        is_hazard = (reg == ins_in_decode.received_op.rs 
-                    || reg == ins_in_decode.received_op.rt);
-    }
-    else
-    {
-        // for operations that use rd as well, we need to check if the destination register is any of the three
-        is_hazard = (reg == ins_in_decode.received_op.rd 
-                    || reg == ins_in_decode.received_op.rs 
-                    || reg == ins_in_decode.received_op.rt );
-    }
-
-    return is_hazard;
+    // The immediate register and zero register aren't in the write mask, so they aren't involved in hazards
+    return (pipeline->stages_in_pipe[stage].decoded->write_mask & read_mask) != 0;
 }
 
 
@@ -379,10 +390,15 @@ static bool check_hazrads_by_comparing_regs(Pipe_fig* pipeline, Pipe_figstate st
 /* bool checkfor_data_hazards(Pipe_fig* pipeline) : look for data hazards  */
 static bool checkfor_data_hazards(Pipe_fig* pipeline)
 {
+    // The registers the instruction in decode depends on. A store after a store in WRITE_BACK only depends on rs and rt.
+    const Decoded_Instruction* ins_in_decode = pipeline->stages_in_pipe[DECODE].decoded;
+    uint16_t read_mask = (ins_in_decode->opcode == SW && pipeline->stages_in_pipe[WRITE_BACK].decoded->opcode == SW)
+                       ? ins_in_decode->read_mask_rs_rt : ins_in_decode->read_mask;
+
     // Check in stages actively deal with operations that modify or depend on register/memory data
-    return check_hazrads_by_comparing_regs(pipeline, EXECUTE) 
-        || check_hazrads_by_comparing_regs(pipeline, MEM)
-        || check_hazrads_by_comparing_regs(pipeline, WRITE_BACK);
+    return check_hazrads_by_comparing_regs(pipeline, EXECUTE, read_mask) 
+        || check_hazrads_by_comparing_regs(pipeline, MEM, read_mask)
+        || check_hazrads_by_comparing_regs(pipeline, WRITE_BACK, read_mask);
     
 }
 
@@ -392,6 +408,7 @@ static void stats_update(Pipe_fig* pipeline)
 {
     pipeline->stats.stalls_in_decode += (pipeline->data_stall && !pipeline->mem_stall) ? 1 : 0;
     pipeline->stats.stalls_in_mem += pipeline->mem_stall ? 1 : 0;
+    pipeline->stats.stalls_in_bus_queue += (pipeline->mem_stall && Cache_IsWaitingForBusQueue(&pipeline->data_in_cache)) ? 1 : 0;
 }
 
 
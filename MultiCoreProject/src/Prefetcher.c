@@ -0,0 +1,99 @@
+/*!
+******************************************************************************
+file Prefetcher.c
+
+Per PC stride prefetcher of the data caches.
+
+Each load or store instruction has an entry with its last address and the
+stride between its last two addresses. Once the same stride repeats, every
+access queues the block that lies distance strides ahead, unless the entry
+queued it already. The cache issues the queued blocks as busRd transactions
+in the cycles in which the bus has nothing else to do.
+*****************************************************************************/
+
+/* Includes */
+#include <string.h>
+#include "../headers/Prefetcher.h"
+#include "../headers/AddressLayout.h"
+
+/* Static Functions */
+static void queue_block(Prefetcher* prefetcher, uint32_t block_address); // Add a candidate once, dropping the oldest when full
+
+/* Functions implementations */
+void Prefetcher_Init(Prefetcher* prefetcher, uint32_t distance, uint32_t offset_bits) {
+    memset(prefetcher, 0, sizeof(Prefetcher));
+    prefetcher->distance = distance;
+    prefetcher->offset_bits = offset_bits;
+}
+
+static void queue_block(Prefetcher* prefetcher, uint32_t block_address) {
+    // The accesses of an unrolled loop predict the same block
+    for (uint32_t i = 0; i < prefetcher->queue_count; i++) {
+        if (prefetcher->queue[(prefetcher->queue_head + i) % PREFETCH_QUEUE_SIZE] == block_address) {
+            return;
+        }
+    }
+    if (prefetcher->queue_count == PREFETCH_QUEUE_SIZE) {
+        prefetcher->queue_head = (prefetcher->queue_head + 1) % PREFETCH_QUEUE_SIZE;
+        prefetcher->queue_count--;
+    }
+    prefetcher->queue[(prefetcher->queue_head + prefetcher->queue_count) % PREFETCH_QUEUE_SIZE] = block_address;
+    prefetcher->queue_count++;
+}
+
+void Prefetcher_Train(Prefetcher* prefetcher, uint16_t pc, uint32_t address) {
+    if (prefetcher->distance == 0 || prefetcher->stopped) {
+        return;
+    }
+    // A stalled access is retried every cycle with the same pc and address
+    if (prefetcher->has_trained && prefetcher->trained_pc == pc && prefetcher->trained_address == address) {
+        return;
+    }
+    prefetcher->has_trained = true;
+    prefetcher->trained_pc = pc;
+    prefetcher->trained_address = address;
+
+    Stride_Entry* entry = &prefetcher->table[pc % PREFETCH_TABLE_SIZE];
+    if (!entry->valid || entry->pc != pc) {
+        memset(entry, 0, sizeof(Stride_Entry));
+        entry->valid = true;
+        entry->pc = pc;
+        entry->last_address = address;
+        entry->last_block = UINT32_MAX;
+        return;
+    }
+
+    int32_t stride = (int32_t)(address - entry->last_address);
+    entry->last_address = address;
+    if (stride == entry->stride) {
+        entry->confidence += (entry->confidence < PREFETCH_CONFIDENCE) ? 1 : 0;
+    } else {
+        entry->stride = stride;
+        entry->confidence = 0;
+    }
+    if (entry->confidence < PREFETCH_CONFIDENCE || stride == 0) {
+        return;
+    }
+
+    uint32_t target = (address + (uint32_t)(stride * (int32_t)prefetcher->distance)) & ((1u << ADDRESS_BITS) - 1);
+    uint32_t block = target >> prefetcher->offset_bits;
+    if (block != entry->last_block && block != (address >> prefetcher->offset_bits)) {
+        entry->last_block = block;
+        queue_block(prefetcher, block << prefetcher->offset_bits);
+    }
+}
+
+bool Prefetcher_Next(Prefetcher* prefetcher, uint32_t* block_address) {
+    if (prefetcher->queue_count == 0) {
+        return false;
+    }
+    *block_address = prefetcher->queue[prefetcher->queue_head];
+    prefetcher->queue_head = (prefetcher->queue_head + 1) % PREFETCH_QUEUE_SIZE;
+    prefetcher->queue_count--;
+    return true;
+}
+
+void Prefetcher_Stop(Prefetcher* prefetcher) {
+    prefetcher->stopped = true;
+    prefetcher->queue_count = 0;
+}
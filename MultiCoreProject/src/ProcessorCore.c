@@ -18,19 +18,17 @@ Implementation of Processor Core functionality.
 
 /* Defines */
 #define REGISTERCOUNT 16 // 16 registers per core
-#define INSTRUCTIONMEMORYSIZE 1024 // 1K words
 
 /* Functions Prototypes */
 static void Print_tracking_info(ProcessorCore* core);
-static void Print_registers(ProcessorCore* core);
 static int InstMem_init(ProcessorCore* core);
 static void write_trace(ProcessorCore *core, uint32_t* reg);
-static void write_trace_reg(ProcessorCore* core, uint32_t* reg);
+static void get_stage_pcs(ProcessorCore* core, uint16_t* stage_pc);
 static void update_tracking_info(ProcessorCore* core);
 
 
 /* Functions implementations */
-void ProcessorCore_Init(ProcessorCore* core, uint32_t coreId){
+bool ProcessorCore_Init(ProcessorCore* core, uint32_t coreId, Bus_Controller* bus, const Cache_Config* cache_config){
     // Initialize the core
     core->pc = 0; // Initialize the program counter to 0
     core->isHalted = false; // Initialize the halt flag to false
@@ -38,50 +36,50 @@ void ProcessorCore_Init(ProcessorCore* core, uint32_t coreId){
 
     memset(&core->registers, 0, sizeof(REGISTERCOUNT)); // Initialize registers to 0
     int num_loaded_instructions = InstMem_init(core); // Load instructions from file
-    if (num_loaded_instructions == 0) {
-        core->isHalted = true; // Halt the core if no instructions are loaded
-        return;
-    }
 
     // Initialize the Pipeline Controller
     memset(&core->pipelineController, 0, sizeof(PIPE_SIZE));
     Pipe_Init(&core->pipelineController);
     // Initialize the cache
     memset(&core->pipelineController.data_in_cache, 0, sizeof(Cache_Data)); 
-    CacheController_Init(&core->pipelineController.data_in_cache, coreId);
+    if (!CacheController_Init(&core->pipelineController.data_in_cache, coreId, bus, cache_config)) {
+        return false;
+    }
     // Initialize the tracking info
     memset(&core->tracking_info_core, 0, sizeof(tracking_info_core));
     core-> tracking_info_core.cycles = -1; 
 
-    Cache_InitializeBusCallbacks();
+    Cache_InitializeBusCallbacks(bus);
 
     core->pipelineController.regs_pnt = core->registers;
-	core->pipelineController.insturcionts_pnt = core->instruction_memory;
+	core->pipelineController.insturcionts_pnt = core->decoded_instructions;
 	core->pipelineController.params_of_op.pc = (uint16_t *)&(core->pc);
+
+    // Halt the core if no instructions are loaded, its cache still answers the snoops of the bus
+    if (num_loaded_instructions == 0) {
+        core->isHalted = true;
+    }
+    return true;
 }
 
-static int InstMem_init(ProcessorCore* core){
-    int loaded_instructions = 0; // Tracks the number of loaded instructions
+void ProcessorCore_Free(ProcessorCore* core){
+    // Release the SRAMs of the cache
+    CacheController_Free(&core->pipelineController.data_in_cache);
+}
 
-    // Loop until we reach the memory size limit or end of the input file
-    while (loaded_instructions < INSTRUCTIONMEMORYSIZE) 
-    {
-        // Read the next instruction from the file
-        int read_status = fscanf(
-            core->fileHandles.instructionMemoryFile, 
-            "%08x", 
-            (uint32_t*)&(core->instruction_memory[loaded_instructions])
-        );
-
-        // Stop if the end of file is reached
-        if (read_status == EOF) {
-            break;
-        }
-
-        // Increment the count of successfully loaded instructions
-        loaded_instructions++;
+static int InstMem_init(ProcessorCore* core){
+    // Copy the instructions from the image, the rest of the instruction memory is 0
+    const Mem_Image* image = &core->fileHandles.instructionMemory;
+    int loaded_instructions = (image->numOfWords < INSTRUCTIONMEMORYSIZE) ? (int)image->numOfWords : INSTRUCTIONMEMORYSIZE;
+    memset(core->instruction_memory, 0, sizeof(core->instruction_memory));
+    if (loaded_instructions > 0) {
+        memcpy(core->instruction_memory, image->words, loaded_instructions * sizeof(uint32_t));
     }
-
+    // Decode every word once, the pipeline only reads the decoded instructions
+    for (int i = 0; i < INSTRUCTIONMEMORYSIZE; i++) {
+        DecodeInstruction(core->instruction_memory[i], &core->decoded_instructions[i]);
+    }
+    BlockCache_Init(&core->block_cache, core->decoded_instructions);
     return loaded_instructions;
 }
 void core_run_single_cycle(ProcessorCore* core){
@@ -90,15 +88,23 @@ void core_run_single_cycle(ProcessorCore* core){
     if (Pipe_Flush(&core->pipelineController)) { 
         // Flush the pipeline if needed, halt the core if the pipeline is flushed and return
         core -> isHalted= true;
+        Cache_StopPrefetching(&core->pipelineController.data_in_cache);
         return;
     }
-    // make a copy of the registers
+    // make a copy of the registers, only if the cycle is traced
+    uint32_t cycle = core->tracking_info_core.cycles + 1;
+    bool traced = Trace_IsCycleTraced(core->trace, cycle);
     uint32_t regC[REGISTERCOUNT];
-    memcpy(regC, core->registers, sizeof(core->registers));
+    if (traced) {
+        memcpy(regC, core->registers, sizeof(core->registers));
+    }
 
     update_tracking_info(core); // Update the performance statistics
     Pipe_iteration_exe(&core->pipelineController); // Run the pipeline for a single cycle
-    write_trace(core, regC); 
+    if (traced) {
+        write_trace(core, regC);
+    }
+    Trace_CheckPcTrigger(core->trace, cycle, core->pipelineController.stages_in_pipe[FETCH].pc);
     Pipe_Bubbles(&core->pipelineController); // Bubble the pipeline stages if needed
 }
 
@@ -107,24 +113,53 @@ bool core_is_halted(ProcessorCore* core){
     return core->isHalted;
 }
 
-static void write_trace(ProcessorCore *core, uint32_t* reg){
-    // Write the trace to the file
-    fprintf(core->fileHandles.executionTraceFile, "%d ", core->tracking_info_core.cycles);
-    Pipe_ToTrace(&core->pipelineController, core->fileHandles.executionTraceFile);
-    write_trace_reg(core, reg);
-    fprintf(core->fileHandles.executionTraceFile, "\n");
+bool core_can_fast_forward(ProcessorCore* core){
+    // Check if the next cycles of the core only repeat a memory stall
+    return core_is_halted(core) || Pipe_IsWaitingForMemory(&core->pipelineController);
 }
 
-static void write_trace_reg(ProcessorCore* core, uint32_t* reg){
-    // Write the register values to the trace file
-    if (reg == NULL) {
-        reg = core->registers;
-    }
-    for (int i = START_MUTABLE_REG; i < REGISTERCOUNT; i++) {
-        fprintf(core->fileHandles.executionTraceFile, "%08X ",reg[i]);
+void core_fast_forward(ProcessorCore* core, uint32_t cycles){
+    // Account for cycles in which the core stays stalled in the MEM stage, the trace lines 
+    // of these cycles differ only by the cycle number
+    if (core_is_halted(core) || cycles == 0) { return; }
+
+    uint16_t stage_pc[TRACE_NUM_OF_STAGES];
+    get_stage_pcs(core, stage_pc);
+    Trace_WriteCoreRepeated(core->trace, core->tracking_info_core.cycles + 1, cycles, stage_pc, &core->registers[START_MUTABLE_REG]);
+    core->tracking_info_core.cycles += cycles;
+    Pipe_SkipMemStallCycles(&core->pipelineController, cycles);
+}
+
+void core_restart(ProcessorCore* core){
+    // Start the pipeline again at the PC of the core, which the functional execution moved
+    if (core_is_halted(core)) { return; }
+    Pipe_Restart(&core->pipelineController);
+}
+
+void core_request_drain(ProcessorCore* core){
+    // Stop fetching at the next instruction boundary, the PC of the core is left at the first instruction that didn't run
+    Pipe_RequestDrain(&core->pipelineController);
+}
+
+bool core_is_drained(ProcessorCore* core){
+    // Check if the core has no instruction in flight after a drain, a halted core counts as drained
+    return core_is_halted(core) || Pipe_IsDrained(&core->pipelineController);
+}
+
+static void get_stage_pcs(ProcessorCore* core, uint16_t* stage_pc){
+    // The PC of each pipeline stage, UINT16_MAX for a stage without an instruction
+    for (int stage = FETCH; stage < PIPE_SIZE; stage++) {
+        stage_pc[stage] = core->pipelineController.stages_in_pipe[stage].pc;
     }
 }
 
+static void write_trace(ProcessorCore *core, uint32_t* reg){
+    // Write the trace line of the cycle: the stage PCs after the cycle and the registers before it
+    uint16_t stage_pc[TRACE_NUM_OF_STAGES];
+    get_stage_pcs(core, stage_pc);
+    Trace_WriteCore(core->trace, core->tracking_info_core.cycles, stage_pc, &reg[START_MUTABLE_REG]);
+}
+
 static void update_tracking_info(ProcessorCore* core){
     // Update the performance statistics for the core
     core->tracking_info_core.cycles++;
@@ -137,7 +172,7 @@ static void update_tracking_info(ProcessorCore* core){
 
 void Core_Shutdown(ProcessorCore* core){
     // Shutdown the core
-    Print_registers(core); // Output the register values to the trace file
+    Core_PrintRegisters(core); // Output the register values to the trace file
     // Output the cache data (dsram and tsram) to their respective files
     print_Cache_Data(
         &core->pipelineController.data_in_cache,       // Cache data structure
@@ -148,7 +183,7 @@ void Core_Shutdown(ProcessorCore* core){
     Print_tracking_info(core);// Log the performance statistics for the core
 }
 
-static void Print_registers(ProcessorCore* core){
+void Core_PrintRegisters(ProcessorCore* core){
     // Print the register values for the core into the trace file
     for (int i = START_MUTABLE_REG; i < REGISTERCOUNT; i++) {
         fprintf(core->fileHandles.registerOutputFile, "%08X\n", core->registers[i]);
@@ -164,5 +199,15 @@ static void Print_tracking_info(ProcessorCore* core){
     fprintf(core->fileHandles.coreStatsFile, "write_miss %d\n", core->pipelineController.data_in_cache.tracking_info.write_misses);
     fprintf(core->fileHandles.coreStatsFile, "decode_stall %d\n", core->pipelineController.stats.stalls_in_decode);
     fprintf(core->fileHandles.coreStatsFile, "mem_stall %d\n", core->pipelineController.stats.stalls_in_mem);
+    if (core->pipelineController.data_in_cache.victim_lines > 0) {
+        // Misses served by the victim buffer, counted neither as hits nor as misses
+        fprintf(core->fileHandles.coreStatsFile, "victim_hit %d\n", core->pipelineController.data_in_cache.tracking_info.victim_hits);
+    }
+    if (core->pipelineController.data_in_cache.prefetcher.distance > 0) {
+        const Prefetch_Stats* prefetch = &core->pipelineController.data_in_cache.prefetcher.stats;
+        fprintf(core->fileHandles.coreStatsFile, "prefetch_issued %u\n", prefetch->issued);
+        fprintf(core->fileHandles.coreStatsFile, "prefetch_useful %u\n", prefetch->useful);
+        fprintf(core->fileHandles.coreStatsFile, "prefetch_late %u\n", prefetch->late);
+    }
 }
 
@@ -0,0 +1,149 @@
+/*!
+******************************************************************************
+file ReplacementPolicy.c
+
+Replacement policies of the set-associative data caches.
+
+The cache keeps the replacement state next to its TSRAM and passes the state of
+the accessed set to the policy. The policies only choose among valid ways, the
+cache fills an invalid way first. With a single way every policy chooses it.
+*****************************************************************************/
+
+/* Includes */
+#include <string.h>
+#include "../headers/ReplacementPolicy.h"
+
+/* Defines */
+#define SRRIP_MAX_RRPV 3        // Distant re-reference, evicted first
+#define SRRIP_INSERTION_RRPV 2  // Long re-reference, for a block that was just brought
+
+/* Static Functions */
+static void lru_init(Replacement_Set* set);
+static void lru_on_hit(Replacement_Set* set, uint32_t way);
+static uint32_t lru_victim(Replacement_Set* set);
+static void plru_init(Replacement_Set* set);
+static void plru_on_hit(Replacement_Set* set, uint32_t way);
+static uint32_t plru_victim(Replacement_Set* set);
+static void random_init(Replacement_Set* set);
+static void random_on_hit(Replacement_Set* set, uint32_t way);
+static uint32_t random_victim(Replacement_Set* set);
+static void srrip_init(Replacement_Set* set);
+static void srrip_on_hit(Replacement_Set* set, uint32_t way);
+static void srrip_on_fill(Replacement_Set* set, uint32_t way);
+static uint32_t srrip_victim(Replacement_Set* set);
+
+static const Replacement_Policy policies[NUM_OF_REPLACEMENT_POLICIES] = {
+    // A fill is an access for the LRU based policies
+    { "lru",    lru_init,    lru_on_hit,    lru_on_hit,    lru_victim },
+    { "plru",   plru_init,   plru_on_hit,   plru_on_hit,   plru_victim },
+    { "random", random_init, random_on_hit, random_on_hit, random_victim },
+    { "srrip",  srrip_init,  srrip_on_hit,  srrip_on_fill, srrip_victim }
+};
+
+/* Functions implementations */
+const Replacement_Policy* Replacement_GetPolicy(Replacement_Policy_Id id) {
+    return &policies[(id < NUM_OF_REPLACEMENT_POLICIES) ? id : REPLACEMENT_LRU];
+}
+
+bool Replacement_ParsePolicy(const char* name, Replacement_Policy_Id* id) {
+    for (int policy = 0; policy < NUM_OF_REPLACEMENT_POLICIES; policy++) {
+        if (strcmp(name, policies[policy].name) == 0) {
+            *id = (Replacement_Policy_Id)policy;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* LRU: the age of a way is the number of ways accessed after it */
+static void lru_init(Replacement_Set* set) {
+    for (uint32_t way = 0; way < set->ways; way++) {
+        set->line_state[way] = (uint8_t)way;
+    }
+}
+
+static void lru_on_hit(Replacement_Set* set, uint32_t way) {
+    uint8_t age = set->line_state[way];
+    for (uint32_t other = 0; other < set->ways; other++) {
+        set->line_state[other] += (set->line_state[other] < age) ? 1 : 0;
+    }
+    set->line_state[way] = 0;
+}
+
+static uint32_t lru_victim(Replacement_Set* set) {
+    uint32_t victim = 0;
+    for (uint32_t way = 1; way < set->ways; way++) {
+        victim = (set->line_state[way] > set->line_state[victim]) ? way : victim;
+    }
+    return victim;
+}
+
+/* Tree PLRU: each node points to the half that was accessed less recently (0 - left, 1 - right) */
+static void plru_init(Replacement_Set* set) {
+    *set->tree = 0;
+}
+
+static void plru_on_hit(Replacement_Set* set, uint32_t way) {
+    // Walk from the leaf of the way to the root, pointing every node away from it
+    uint32_t node = way + set->ways - 1;
+    while (node > 0) {
+        uint32_t parent = (node - 1) / 2;
+        bool from_right = (node == 2 * parent + 2);
+        *set->tree = from_right ? (*set->tree & ~(1ull << parent)) : (*set->tree | (1ull << parent));
+        node = parent;
+    }
+}
+
+static uint32_t plru_victim(Replacement_Set* set) {
+    uint32_t node = 0;
+    while (node < set->ways - 1) {
+        node = 2 * node + 1 + (uint32_t)((*set->tree >> node) & 1);
+    }
+    return node - (set->ways - 1);
+}
+
+/* Random: a xorshift generator per cache, so a run is reproducible */
+static void random_init(Replacement_Set* set) {
+    (void)set;
+}
+
+static void random_on_hit(Replacement_Set* set, uint32_t way) {
+    (void)set;
+    (void)way;
+}
+
+static uint32_t random_victim(Replacement_Set* set) {
+    uint32_t x = *set->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *set->random = x;
+    return x & (set->ways - 1);
+}
+
+/* SRRIP: a hit predicts a near re-reference, a fill a long one, the victim is a distant one */
+static void srrip_init(Replacement_Set* set) {
+    memset(set->line_state, SRRIP_MAX_RRPV, set->ways);
+}
+
+static void srrip_on_hit(Replacement_Set* set, uint32_t way) {
+    set->line_state[way] = 0;
+}
+
+static void srrip_on_fill(Replacement_Set* set, uint32_t way) {
+    set->line_state[way] = SRRIP_INSERTION_RRPV;
+}
+
+static uint32_t srrip_victim(Replacement_Set* set) {
+    // Age every way until one reaches the distant prediction
+    for (;;) {
+        for (uint32_t way = 0; way < set->ways; way++) {
+            if (set->line_state[way] >= SRRIP_MAX_RRPV) {
+                return way;
+            }
+        }
+        for (uint32_t way = 0; way < set->ways; way++) {
+            set->line_state[way]++;
+        }
+    }
+}
@@ -0,0 +1,245 @@
+/*!
+******************************************************************************
+file SampledSim.c
+
+Sampled simulation: functional fast forward with detailed measurement windows.
+
+The cores alternate between two modes. In a functional period every core runs
+sample_period instructions through FunctionalSim, with the loads and stores
+going through its data cache, so the TSRAM, DSRAM and MESI states stay warm.
+Then the pipelines restart at the PC the functional execution reached and run
+in full detail: sample_warmup cycles fill the pipelines and the bus queue, and
+the counters of the next sample_window cycles are one sample. The pipelines
+drain before the next functional period, which resumes from the first
+instruction that didn't complete.
+
+Each window gives one value of the CPI, the miss rates and the stalls per
+instruction of every core. Their mean is the estimate and the spread of the
+values gives its 95% confidence interval, using the Student t distribution.
+*****************************************************************************/
+
+/* Includes */
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "../headers/SampledSim.h"
+#include "../headers/FunctionalSim.h"
+
+/* Types */
+// Core_Counters - The counters of a core at the start or the end of a window
+typedef struct {
+    uint32_t cycles;
+    uint32_t instructions;
+    uint32_t read_hits;
+    uint32_t read_misses;
+    uint32_t write_hits;
+    uint32_t write_misses;
+    uint32_t decode_stalls;
+    uint32_t mem_stalls;
+} Core_Counters;
+
+/* Consts */
+// Two sided 95% quantiles of the Student t distribution for 1 .. 30 degrees of freedom
+static const double t_quantiles_95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+#define NUM_OF_T_QUANTILES (sizeof(t_quantiles_95) / sizeof(t_quantiles_95[0]))
+#define NORMAL_QUANTILE_95 1.96
+
+static const char* metric_names[NUM_OF_SAMPLE_METRICS] = {
+    "cpi", "read_miss_rate", "write_miss_rate", "mem_stall_per_instruction", "decode_stall_per_instruction"
+};
+
+/* Static Functions */
+static bool all_cores_halted(SimContext* context); // Check if every core is halted
+static bool all_cores_drained(SimContext* context); // Check if every core drained its pipeline and the bus is idle
+static uint32_t run_cycles(SimContext* context, uint32_t cycles); // Run detailed cycles, stops early when all cores halt
+static void read_counters(ProcessorCore* core, Core_Counters* counters); // Snapshot the counters of a core
+static void add_value(Sample_Metric* metric, uint32_t numerator, uint32_t denominator); // Add a ratio to a metric if it is defined
+static void record_window(Sampled_Stats* samples, SimContext* context, const Core_Counters* start); // Add the samples of a window
+static double confidence_interval_95(const Sample_Metric* metric); // Half width of the 95% confidence interval of the mean
+
+/* Functions implementations */
+static bool all_cores_halted(SimContext* context) {
+    for (uint32_t i = 0; i < context->numOfCores; i++) {
+        if (!core_is_halted(&context->cores[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool all_cores_drained(SimContext* context) {
+    for (uint32_t i = 0; i < context->numOfCores; i++) {
+        if (!core_is_drained(&context->cores[i])) {
+            return false;
+        }
+    }
+    return Bus_IsIdle(&context->bus);
+}
+
+static uint32_t run_cycles(SimContext* context, uint32_t cycles) {
+    uint32_t advanced = 0;
+    while (advanced < cycles && !all_cores_halted(context)) {
+        advanced += SimContext_Step(context, cycles - advanced);
+    }
+    return advanced;
+}
+
+static void read_counters(ProcessorCore* core, Core_Counters* counters) {
+    const tracking_info* cache_info = &core->pipelineController.data_in_cache.tracking_info;
+    counters->cycles = core->tracking_info_core.cycles;
+    counters->instructions = core->tracking_info_core.instructions;
+    counters->read_hits = cache_info->read_hits;
+    counters->read_misses = cache_info->read_misses;
+    counters->write_hits = cache_info->write_hits;
+    counters->write_misses = cache_info->write_misses;
+    counters->decode_stalls = core->pipelineController.stats.stalls_in_decode;
+    counters->mem_stalls = core->pipelineController.stats.stalls_in_mem;
+}
+
+static void add_value(Sample_Metric* metric, uint32_t numerator, uint32_t denominator) {
+    // A window without instructions or accesses says nothing about the ratio
+    if (denominator == 0) {
+        return;
+    }
+    double value = (double)numerator / (double)denominator;
+    metric->count++;
+    metric->sum += value;
+    metric->sum_of_squares += value * value;
+}
+
+static void record_window(Sampled_Stats* samples, SimContext* context, const Core_Counters* start) {
+    for (uint32_t i = 0; i < context->numOfCores; i++) {
+        Core_Counters end;
+        read_counters(&context->cores[i], &end);
+        Sample_Metric* metrics = samples->cores[i].metrics;
+        uint32_t instructions = end.instructions - start[i].instructions;
+        uint32_t reads = (end.read_hits - start[i].read_hits) + (end.read_misses - start[i].read_misses);
+        uint32_t writes = (end.write_hits - start[i].write_hits) + (end.write_misses - start[i].write_misses);
+
+        add_value(&metrics[SAMPLE_CPI], end.cycles - start[i].cycles, instructions);
+        add_value(&metrics[SAMPLE_READ_MISS_RATE], end.read_misses - start[i].read_misses, reads);
+        add_value(&metrics[SAMPLE_WRITE_MISS_RATE], end.write_misses - start[i].write_misses, writes);
+        add_value(&metrics[SAMPLE_MEM_STALL_PER_INSTRUCTION], end.mem_stalls - start[i].mem_stalls, instructions);
+        add_value(&metrics[SAMPLE_DECODE_STALL_PER_INSTRUCTION], end.decode_stalls - start[i].decode_stalls, instructions);
+    }
+    samples->windows++;
+}
+
+static double confidence_interval_95(const Sample_Metric* metric) {
+    if (metric->count < 2) {
+        return 0.0;
+    }
+    double n = (double)metric->count;
+    double variance = (metric->sum_of_squares - metric->sum * metric->sum / n) / (n - 1.0);
+    variance = (variance < 0.0) ? 0.0 : variance; // Rounding of equal values
+    uint32_t degrees = metric->count - 1;
+    double quantile = (degrees <= NUM_OF_T_QUANTILES) ? t_quantiles_95[degrees - 1] : NORMAL_QUANTILE_95;
+    return quantile * sqrt(variance / n);
+}
+
+bool SampledSim_Run(SimContext* context) {
+    uint32_t numOfCores = context->numOfCores;
+    Sampled_Stats* samples = calloc(1, sizeof(Sampled_Stats));
+    Functional_Core* states = calloc(numOfCores, sizeof(Functional_Core));
+    Core_Counters* start = calloc(numOfCores, sizeof(Core_Counters));
+    Core_Counters* detailed_start = calloc(numOfCores, sizeof(Core_Counters));
+    if (samples != NULL) {
+        samples->cores = calloc(numOfCores, sizeof(Sampled_Core_Stats));
+        samples->numOfCores = numOfCores;
+    }
+    if (samples == NULL || samples->cores == NULL || states == NULL || start == NULL || detailed_start == NULL) {
+        SampledSim_Free(samples);
+        free(states);
+        free(start);
+        free(detailed_start);
+        printf("Warning: Failed to allocate the samples, running without sampling\n");
+        return false;
+    }
+    context->samples = samples;
+
+    for (uint32_t i = 0; i < numOfCores; i++) {
+        FunctionalCore_Init(&states[i], &context->cores[i]);
+        states[i].warm_caches = true;
+    }
+
+    const SimConfig* config = &context->config;
+    while (!all_cores_halted(context)) {
+        // Fast forward functionally, then move every core out of a branch delay slot so the pipeline can start at its PC
+        FunctionalSim_RunTurns(states, context->cores, numOfCores, &context->memory, config->quantum, config->sample_period);
+        for (uint32_t i = 0; i < numOfCores; i++) {
+            FunctionalCore_LeaveDelaySlot(&states[i], &context->cores[i], &context->memory);
+        }
+        if (all_cores_halted(context)) {
+            break;
+        }
+
+        // Warm the pipelines and the bus, then measure a window
+        for (uint32_t i = 0; i < numOfCores; i++) {
+            core_restart(&context->cores[i]);
+            read_counters(&context->cores[i], &detailed_start[i]);
+        }
+        run_cycles(context, config->sample_warmup);
+        for (uint32_t i = 0; i < numOfCores; i++) {
+            read_counters(&context->cores[i], &start[i]);
+        }
+        if (run_cycles(context, config->sample_window) == config->sample_window) {
+            record_window(samples, context, start); // A window cut short by the end of the programs is not a sample
+        }
+
+        // Let the instructions in flight and the bus transactions complete, the functional execution resumes after them
+        for (uint32_t i = 0; i < numOfCores; i++) {
+            core_request_drain(&context->cores[i]);
+        }
+        while (!all_cores_drained(context)) {
+            SimContext_Step(context, UINT32_MAX);
+        }
+        for (uint32_t i = 0; i < numOfCores; i++) {
+            Core_Counters end;
+            read_counters(&context->cores[i], &end);
+            samples->cores[i].instructions += end.instructions - detailed_start[i].instructions;
+            FunctionalCore_Sync(&states[i], &context->cores[i]);
+        }
+    }
+
+    for (uint32_t i = 0; i < numOfCores; i++) {
+        samples->cores[i].instructions += states[i].instructions;
+    }
+    free(states);
+    free(start);
+    free(detailed_start);
+    return true;
+}
+
+void SampledSim_Report(const Sampled_Stats* samples, uint32_t coreId, FILE* file) {
+    // The estimates follow the counters of the detailed cycles, a metric never defined in a window is left out
+    const Sampled_Core_Stats* core = &samples->cores[coreId];
+    const Sample_Metric* cpi = &core->metrics[SAMPLE_CPI];
+    fprintf(file, "sampled_windows %u\n", samples->windows);
+    fprintf(file, "sampled_instructions %llu\n", (unsigned long long)core->instructions);
+    if (cpi->count > 0) {
+        fprintf(file, "estimated_cycles %.0f\n", (double)core->instructions * cpi->sum / cpi->count);
+    }
+    for (int metric = 0; metric < NUM_OF_SAMPLE_METRICS; metric++) {
+        const Sample_Metric* values = &core->metrics[metric];
+        if (values->count == 0) {
+            continue;
+        }
+        fprintf(file, "%s %.4f\n", metric_names[metric], values->sum / values->count);
+        fprintf(file, "%s_ci95 %.4f\n", metric_names[metric], confidence_interval_95(values));
+    }
+}
+
+void SampledSim_Free(Sampled_Stats* samples) {
+    if (samples == NULL) {
+        return;
+    }
+    free(samples->cores);
+    free(samples);
+}
@@ -0,0 +1,327 @@
+/*!
+******************************************************************************
+file SimConfig.c
+
+Run time options of the simulator.
+
+Options are given before the file arguments in the form "--name" or 
+"--name=value". They are removed from argv so the positional file arguments 
+keep their original order.
+*****************************************************************************/
+
+/* Includes */
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include "../headers/SimConfig.h"
+#include "../headers/sim.h"
+
+/* Types */
+// Option_Result - What an option did to the configuration
+typedef enum {
+    OPTION_APPLIED,
+    OPTION_UNKNOWN,  // No option has this name
+    OPTION_INVALID   // The value of the option is invalid, the error was printed
+} Option_Result;
+
+/* Static Functions */
+static Option_Result parse_option(SimConfig* config, const char* option);
+static bool parse_uint32(const char* text, uint32_t* value, char** end);
+static bool parse_uint_option(const char* option, const char* name, uint32_t* value, bool* is_valid);
+static bool parse_string_option(const char* option, const char* name, const char** value);
+static bool parse_cycle_window(const char* window, uint32_t* first_cycle, uint32_t* last_cycle);
+static bool parse_trace_targets(const char* list, Trace_Options* options);
+
+/* Functions implementations */
+void SimConfig_Default(SimConfig* config) {
+    config->fast_forward = true;
+    config->functional = false;
+    config->quantum = DEFAULT_FUNCTIONAL_QUANTUM;
+    config->sample_period = 0;
+    config->sample_warmup = DEFAULT_SAMPLE_WARMUP;
+    config->sample_window = DEFAULT_SAMPLE_WINDOW;
+    config->num_cores = DEFAULT_NUM_OF_CORES;
+    Cache_DefaultConfig(&config->cache);
+    config->directory_coherence = false;
+    config->snoop_filter = true;
+    config->snoop_stats = false;
+    config->split_bus = false;
+    config->bus_stats = false;
+    BusArbiter_DefaultConfig(&config->arbiter);
+    config->bus_queue_size = 0;
+    Dram_DefaultConfig(&config->dram);
+    MemoryController_DefaultConfig(&config->controller);
+    config->dram_stats = false;
+    config->threads = 1;
+    config->batch_file = NULL;
+    config->jobs = 1;
+    config->convert = false;
+    config->decode_trace = false;
+    config->trace_format = TRACE_FORMAT_TEXT;
+    Trace_DefaultOptions(&config->trace_options);
+    config->query_trace = false;
+    config->query_first_cycle = 0;
+    config->query_last_cycle = 0;
+}
+
+
+static bool parse_uint32(const char* text, uint32_t* value, char** end) {
+    // Parse a decimal, hex or octal number that fits in 32 bits, a sign is invalid. On an error end points to the text.
+    errno = 0;
+    unsigned long long parsed = strtoull(text, end, 0);
+    if (!isdigit((unsigned char)text[0]) || errno == ERANGE || parsed > UINT32_MAX) {
+        *end = (char*)text;
+        return false;
+    }
+    *value = (uint32_t)parsed;
+    return true;
+}
+
+
+static bool parse_uint_option(const char* option, const char* name, uint32_t* value, bool* is_valid) {
+    // Parse an option of the form "--name=value", return false if the option has another name.
+    // An invalid value keeps the previous one and clears is_valid.
+    size_t name_length = strlen(name);
+    if (strncmp(option, name, name_length) != 0 || option[name_length] != '=') {
+        return false;
+    }
+    char* end = NULL;
+    uint32_t parsed = 0;
+    if (!parse_uint32(option + name_length + 1, &parsed, &end) || *end != '\0') {
+        printf("Error: Invalid value in option %s\n", option);
+        *is_valid = false;
+        return true;
+    }
+    *value = parsed;
+    return true;
+}
+
+
+static bool parse_string_option(const char* option, const char* name, const char** value) {
+    // Parse an option of the form "--name=value", the value points into the option string
+    size_t name_length = strlen(name);
+    if (strncmp(option, name, name_length) != 0 || option[name_length] != '=') {
+        return false;
+    }
+    *value = option + name_length + 1;
+    return true;
+}
+
+
+static bool parse_cycle_window(const char* window, uint32_t* first_cycle, uint32_t* last_cycle) {
+    // Parse "N", "N:M" or "N:", a single cycle, an inclusive window or all the cycles from N
+    char* end = NULL;
+    bool is_valid = parse_uint32(window, first_cycle, &end);
+    *last_cycle = *first_cycle;
+    if (is_valid && *end == ':') {
+        const char* last = end + 1;
+        *last_cycle = UINT32_MAX;
+        end = (char*)last;
+        is_valid = (*last == '\0') || parse_uint32(last, last_cycle, &end);
+    }
+    if (!is_valid || *end != '\0' || *last_cycle < *first_cycle) {
+        printf("Error: Invalid cycle window %s\n", window);
+        return false;
+    }
+    return true;
+}
+
+
+static bool parse_trace_targets(const char* list, Trace_Options* options) {
+    // Parse a comma separated list of core ids and "bus", or "all" / "none"
+    options->core_mask = 0;
+    options->bus_enabled = false;
+    if (strcmp(list, "all") == 0) {
+        options->core_mask = UINT64_MAX;
+        options->bus_enabled = true;
+        return true;
+    }
+    if (strcmp(list, "none") == 0) {
+        return true;
+    }
+    for (const char* item = list; *item != '\0'; item++) {
+        char* end = NULL;
+        if (strncmp(item, "bus", 3) == 0) {
+            options->bus_enabled = true;
+            end = (char*)item + 3;
+        } else {
+            unsigned long core = strtoul(item, &end, 10);
+            if (end == item || core >= MAX_NUM_OF_CORES) {
+                printf("Error: Invalid trace target list %s\n", list);
+                return false;
+            }
+            options->core_mask |= (uint64_t)1 << core;
+        }
+        if (*end != ',' && *end != '\0') {
+            printf("Error: Invalid trace target list %s\n", list);
+            return false;
+        }
+        item = (*end == '\0') ? end - 1 : end;
+    }
+    return true;
+}
+
+
+static Option_Result parse_option(SimConfig* config, const char* option) {
+    // Apply a single option to the configuration
+    bool is_valid = true;
+    if (strcmp(option, "--fast-forward") == 0) {
+        config->fast_forward = true;
+    } else if (strcmp(option, "--no-fast-forward") == 0) {
+        config->fast_forward = false;
+    } else if (strcmp(option, "--functional") == 0) {
+        config->functional = true;
+    } else if (parse_uint_option(option, "--quantum", &config->quantum, &is_valid)) {
+        config->quantum = (config->quantum == 0) ? 1 : config->quantum;
+    } else if (parse_uint_option(option, "--sample-period", &config->sample_period, &is_valid)) {
+        // 0 turns the sampled simulation off
+    } else if (parse_uint_option(option, "--sample-warmup", &config->sample_warmup, &is_valid)) {
+        // The warmup may be empty
+    } else if (parse_uint_option(option, "--sample-window", &config->sample_window, &is_valid)) {
+        config->sample_window = (config->sample_window == 0) ? 1 : config->sample_window;
+    } else if (parse_uint_option(option, "--cores", &config->num_cores, &is_valid)) {
+        if (config->num_cores == 0 || config->num_cores > MAX_NUM_OF_CORES) {
+            printf("Error: The number of cores must be between 1 and %d\n", MAX_NUM_OF_CORES);
+            return OPTION_INVALID;
+        }
+    } else if (parse_uint_option(option, "--cache-size", &config->cache.size_words, &is_valid)) {
+        // The organization is checked after all the options
+    } else if (parse_uint_option(option, "--cache-line", &config->cache.block_words, &is_valid)) {
+        // The organization is checked after all the options
+    } else if (parse_uint_option(option, "--cache-ways", &config->cache.ways, &is_valid)) {
+        // The organization is checked after all the options
+    } else if (parse_uint_option(option, "--victim-lines", &config->cache.victim_lines, &is_valid)) {
+        // The organization is checked after all the options
+    } else if (parse_uint_option(option, "--prefetch-distance", &config->cache.prefetch_distance, &is_valid)) {
+        // The organization is checked after all the options
+    } else if (strncmp(option, "--cache-policy=", strlen("--cache-policy=")) == 0) {
+        if (!Replacement_ParsePolicy(option + strlen("--cache-policy="), &config->cache.policy)) {
+            printf("Error: Unknown replacement policy %s\n", option + strlen("--cache-policy="));
+            return OPTION_INVALID;
+        }
+    } else if (strncmp(option, "--protocol=", strlen("--protocol=")) == 0) {
+        if (!Cache_ParseProtocol(option + strlen("--protocol="), &config->cache.protocol)) {
+            printf("Error: Unknown coherence protocol %s\n", option + strlen("--protocol="));
+            return OPTION_INVALID;
+        }
+    } else if (strcmp(option, "--coherence=snoop") == 0) {
+        config->directory_coherence = false;
+    } else if (strcmp(option, "--coherence=directory") == 0) {
+        config->directory_coherence = true;
+    } else if (strcmp(option, "--no-snoop-filter") == 0) {
+        config->snoop_filter = false;
+    } else if (strcmp(option, "--snoop-stats") == 0) {
+        config->snoop_stats = true;
+    } else if (strcmp(option, "--bus=atomic") == 0) {
+        config->split_bus = false;
+    } else if (strcmp(option, "--bus=split") == 0) {
+        config->split_bus = true;
+    } else if (strcmp(option, "--bus-stats") == 0) {
+        config->bus_stats = true;
+    } else if (strncmp(option, "--bus-arbiter=", strlen("--bus-arbiter=")) == 0) {
+        if (!BusArbiter_ParsePolicy(option + strlen("--bus-arbiter="), &config->arbiter.policy)) {
+            printf("Error: Unknown bus arbiter %s\n", option + strlen("--bus-arbiter="));
+            return OPTION_INVALID;
+        }
+    } else if (strncmp(option, "--bus-weights=", strlen("--bus-weights=")) == 0) {
+        if (!BusArbiter_ParseWeights(option + strlen("--bus-weights="), &config->arbiter)) {
+            printf("Error: Invalid bus weights %s, each core has a weight from 1 to %d\n", option + strlen("--bus-weights="), MAX_BUS_WEIGHT);
+            return OPTION_INVALID;
+        }
+    } else if (parse_uint_option(option, "--bus-queue", &config->bus_queue_size, &is_valid)) {
+        if (config->bus_queue_size != 0 && (config->bus_queue_size < BUS_ENTRIES_PER_MISS || config->bus_queue_size > MAX_BUS_QUEUE_SIZE)) {
+            printf("Error: The bus queue must hold %d to %d transactions (0 - a miss of every core)\n", BUS_ENTRIES_PER_MISS, MAX_BUS_QUEUE_SIZE);
+            return OPTION_INVALID;
+        }
+    } else if (parse_uint_option(option, "--dram-banks", &config->dram.banks, &is_valid)) {
+        // The organization is checked after all the options
+    } else if (parse_uint_option(option, "--dram-row", &config->dram.row_words, &is_valid)) {
+        // The organization is checked after all the options
+    } else if (strncmp(option, "--dram-timing=", strlen("--dram-timing=")) == 0) {
+        if (!Dram_ParseTiming(option + strlen("--dram-timing="), &config->dram)) {
+            printf("Error: Invalid memory latencies %s\n", option + strlen("--dram-timing="));
+            return OPTION_INVALID;
+        }
+    } else if (strcmp(option, "--dram-stats") == 0) {
+        config->dram_stats = true;
+    } else if (strncmp(option, "--mc-policy=", strlen("--mc-policy=")) == 0) {
+        if (!MemoryController_ParsePolicy(option + strlen("--mc-policy="), &config->controller.policy)) {
+            printf("Error: Unknown memory controller policy %s\n", option + strlen("--mc-policy="));
+            return OPTION_INVALID;
+        }
+    } else if (parse_uint_option(option, "--mc-queue", &config->controller.queue_size, &is_valid)) {
+        // The queue is checked after all the options
+    } else if (parse_uint_option(option, "--mc-starvation", &config->controller.starvation_cap, &is_valid)) {
+        // 0 turns the cap off
+    } else if (parse_uint_option(option, "--threads", &config->threads, &is_valid)) {
+        config->threads = (config->threads == 0) ? 1 : config->threads;
+    } else if (strcmp(option, "--convert") == 0) {
+        config->convert = true;
+    } else if (strcmp(option, "--decode-trace") == 0) {
+        config->decode_trace = true;
+    } else if (strcmp(option, "--trace-format=text") == 0) {
+        config->trace_format = TRACE_FORMAT_TEXT;
+    } else if (strcmp(option, "--trace-format=binary") == 0) {
+        config->trace_format = TRACE_FORMAT_BINARY;
+    } else if (strcmp(option, "--trace-format=delta") == 0) {
+        config->trace_format = TRACE_FORMAT_DELTA;
+    } else if (strncmp(option, "--trace-window=", strlen("--trace-window=")) == 0) {
+        is_valid = parse_cycle_window(option + strlen("--trace-window="), &config->trace_options.start_cycle, &config->trace_options.stop_cycle);
+    } else if (strncmp(option, "--trace=", strlen("--trace=")) == 0) {
+        is_valid = parse_trace_targets(option + strlen("--trace="), &config->trace_options);
+    } else if (parse_uint_option(option, "--trace-sample", &config->trace_options.sample_period, &is_valid)) {
+        config->trace_options.sample_period = (config->trace_options.sample_period == 0) ? 1 : config->trace_options.sample_period;
+    } else if (parse_uint_option(option, "--trace-trigger-addr", &config->trace_options.trigger_addr, &is_valid)) {
+        config->trace_options.has_trigger_addr = true;
+    } else if (strncmp(option, "--trace-trigger-pc=", strlen("--trace-trigger-pc=")) == 0) {
+        uint32_t pc = 0;
+        parse_uint_option(option, "--trace-trigger-pc", &pc, &is_valid);
+        config->trace_options.has_trigger_pc = is_valid;
+        config->trace_options.trigger_pc = (uint16_t)pc;
+    } else if (strncmp(option, "--query-trace=", strlen("--query-trace=")) == 0) {
+        config->query_trace = true;
+        is_valid = parse_cycle_window(option + strlen("--query-trace="), &config->query_first_cycle, &config->query_last_cycle);
+    } else if (parse_string_option(option, "--batch", &config->batch_file)) {
+        // The workloads are read from the list when the batch runs
+    } else if (parse_uint_option(option, "--jobs", &config->jobs, &is_valid)) {
+        config->jobs = (config->jobs == 0) ? 1 : config->jobs;
+    } else {
+        return OPTION_UNKNOWN;
+    }
+    return is_valid ? OPTION_APPLIED : OPTION_INVALID;
+}
+
+
+int ParseSimOptions(SimConfig* config, int* argc, char* argv[]) {
+    // Consume the options and compact the remaining arguments
+    int kept = 1;
+    for (int i = 1; i < *argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0) {
+            argv[kept++] = argv[i]; // Positional file argument
+            continue;
+        }
+        Option_Result result = parse_option(config, argv[i]);
+        if (result == OPTION_UNKNOWN) {
+            printf("Error: Unknown option %s\n", argv[i]);
+        }
+        if (result != OPTION_APPLIED) {
+            return 1;
+        }
+    }
+    argv[kept] = NULL;
+    *argc = kept;
+    // The size, the line and the ways of the caches depend on each other
+    if (!Cache_CheckConfig(&config->cache)) {
+        return 1;
+    }
+    // The rows of the memory banks hold whole cache lines
+    if (!Dram_CheckConfig(&config->dram, config->cache.block_words) || !MemoryController_CheckConfig(&config->controller)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,230 @@
+/*!
+******************************************************************************
+file SimContext.c
+
+A complete simulated machine: files, main memory, bus and cores.
+
+All the state of a simulation lives in its SimContext, so one process can run 
+many independent machines, one after the other or on different threads.
+*****************************************************************************/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../headers/SimContext.h"
+#include "../headers/FunctionalSim.h"
+#include "../headers/SampledSim.h"
+
+/* Static Functions */
+static bool initTraces(SimContext* context); // Create the trace streams
+static bool initCores(SimContext* context); // Initialize all cores
+static void freeCores(SimContext* context); // Release the cores
+static bool isProcessorHalted(SimContext* context); // Check if all cores are halted
+static uint32_t cyclesToFastForward(SimContext* context); // Number of cycles in which all cores wait for the memory
+
+/* Functions */
+static bool initTraces(SimContext* context){
+    // Create the trace streams over the trace files of the cores and the bus
+    FILE** coreTraceFiles = malloc(context->numOfCores * sizeof(FILE*));
+    if (coreTraceFiles == NULL){
+        return false;
+    }
+    for (uint32_t i = 0; i < context->numOfCores; i++){
+        coreTraceFiles[i] = context->files.coreFileHandlesArray[i].executionTraceFile;
+    }
+    bool started = TraceWriter_Start(&context->tracer, context->config.trace_format, &context->config.trace_options, coreTraceFiles, context->numOfCores, context->files.BusTrace);
+    free(coreTraceFiles);
+    return started;
+}
+
+static bool initCores(SimContext* context){
+    // Initialize all cores
+    context->cores = calloc(context->numOfCores, sizeof(ProcessorCore));
+    if (context->cores == NULL){
+        return false;
+    }
+    for (uint32_t i = 0; i < context->numOfCores; i++){
+        context->cores[i].fileHandles = context->files.coreFileHandlesArray[i]; // Assign the file handles
+        context->cores[i].trace = TraceWriter_CoreStream(&context->tracer, i);
+        if (!ProcessorCore_Init(&context->cores[i], i, &context->bus, &context->config.cache)){ // Initialize the core
+            return false;
+        }
+    }
+    return true;
+}
+
+static void freeCores(SimContext* context){
+    // Release the caches of the cores, the cores that failed to initialize have none
+    for (uint32_t i = 0; context->cores != NULL && i < context->numOfCores; i++){
+        ProcessorCore_Free(&context->cores[i]);
+    }
+    free(context->cores);
+    context->cores = NULL;
+}
+
+static bool isProcessorHalted(SimContext* context){
+    // Check if all cores are halted
+    bool allHalted = true;
+    for (uint32_t i = 0; i < context->numOfCores; i++){
+        if (!core_is_halted(&context->cores[i])){
+            allHalted = false;
+        }
+    } 
+    return allHalted;
+}
+
+static uint32_t cyclesToFastForward(SimContext* context){
+    // The cycles can be skipped only when every live core is stalled on the bus 
+    // and the bus only counts the memory latency
+    if (!context->config.fast_forward){
+        return 0;
+    }
+    for (uint32_t i = 0; i < context->numOfCores; i++){
+        if (!core_can_fast_forward(&context->cores[i])){
+            return 0;
+        }
+    }
+    return Bus_CyclesToNextEvent(&context->bus);
+}
+
+int SimContext_Init(SimContext* context, const SimConfig* config, char* argv[], int argc, const char* directory){
+    memset(context, 0, sizeof(SimContext));
+    context->config = *config;
+    context->numOfCores = config->num_cores;
+
+    // open all required files
+    if (OpenRequiredFiles(&context->files, argv, argc, config, directory) != 0){
+        printf("Error opening files\n");
+        return 1;
+    }
+
+    // Bus and Main Memory Initialization
+    if (!initTraces(context)){
+        printf("Error allocating the trace streams\n");
+        return 1;
+    }
+
+    if (!Bus_Init(&context->bus, context->numOfCores, config->cache.block_words, &config->arbiter, config->bus_queue_size, TraceWriter_BusStream(&context->tracer)) ||
+        !MainMemoryInit(&context->memory, &context->bus, &context->files.MemIn, &config->dram, &config->controller)){
+        printf("Error allocating the bus and the main memory\n");
+        return 1;
+    }
+    ConfigureSplitTransactions_for_bus(&context->bus, config->split_bus);
+    if (config->directory_coherence || config->snoop_filter){
+        uint32_t num_sets = config->cache.size_words / config->cache.block_words / config->cache.ways;
+        if (!Directory_Init(&context->sharer_directory, context->numOfCores, config->cache.block_words, num_sets)){
+            printf("Error allocating the directory\n");
+            return 1;
+        }
+        ConfigureDirectory_for_bus(&context->bus, &context->sharer_directory, config->directory_coherence);
+    }
+
+    // Core Initialization
+    if (!initCores(context)){
+        printf("Error allocating the cores\n");
+        return 1;
+    }
+    if (!CoreWorkers_Start(&context->workers, context->cores, (int)context->numOfCores, (int)config->threads)){
+        printf("Warning: Failed to start the core threads, running on a single thread\n");
+    }
+    return 0;
+}
+
+uint32_t SimContext_Step(SimContext* context, uint32_t max_cycles){
+    // Jump over the cycles in which nothing but the memory latency advances
+    uint32_t skipped_cycles = cyclesToFastForward(context);
+    skipped_cycles = (skipped_cycles >= max_cycles) ? max_cycles - 1 : skipped_cycles;
+    if (skipped_cycles > 0){
+        Bus_FastForward(&context->bus, skipped_cycles);
+        for (uint32_t i = 0; i < context->numOfCores; i++){
+            core_fast_forward(&context->cores[i], skipped_cycles);
+        }
+    }
+
+    // Run a single cycle for each core
+    Run_Bus_Iteration(&context->bus);
+    CoreWorkers_RunCycle(&context->workers);
+    return skipped_cycles + 1;
+}
+
+void SimContext_Run(SimContext* context){
+    // The functional mode executes the programs without the pipeline, the caches and the bus
+    if (context->config.functional){
+        FunctionalSim_Run(context->cores, context->numOfCores, &context->memory, context->config.quantum);
+        return;
+    }
+
+    // The sampled mode runs functionally and measures detailed windows in between
+    if (context->config.sample_period > 0 && SampledSim_Run(context)){
+        return;
+    }
+
+    // A prefetch may still be on the bus after the last halt, its flush must reach the memory
+    while (!isProcessorHalted(context) || !Bus_IsIdle(&context->bus)){
+        SimContext_Step(context, UINT32_MAX);
+    }
+}
+
+void SimContext_Finish(SimContext* context){
+    CoreWorkers_Stop(&context->workers);
+    for (uint32_t i = 0; context->cores != NULL && i < context->numOfCores; i++){
+        // Shutdown each core, a functional run has no cache contents or cycle statistics to report
+        if (context->config.functional){
+            Core_PrintRegisters(&context->cores[i]);
+        } else {
+            Core_Shutdown(&context->cores[i]);
+        }
+        if (context->samples != NULL){
+            SampledSim_Report(context->samples, i, context->cores[i].fileHandles.coreStatsFile);
+        }
+        if (context->config.snoop_stats){
+            fprintf(context->cores[i].fileHandles.coreStatsFile, "snoops_received %u\n", Bus_SnoopsReceived(&context->bus, i));
+            fprintf(context->cores[i].fileHandles.coreStatsFile, "snoops_filtered %u\n", Bus_SnoopsFiltered(&context->bus, i));
+        }
+        if (context->config.bus_stats){
+            fprintf(context->cores[i].fileHandles.coreStatsFile, "bus_transactions %u\n", Bus_TransactionsStarted(&context->bus, i));
+            fprintf(context->cores[i].fileHandles.coreStatsFile, "bus_queue_cycles %llu\n", (unsigned long long)Bus_QueueCycles(&context->bus, i));
+            Bus_PrintQueueWaits(&context->bus, i, context->cores[i].fileHandles.coreStatsFile);
+            fprintf(context->cores[i].fileHandles.coreStatsFile, "bus_queue_stall %u\n", context->cores[i].pipelineController.stats.stalls_in_bus_queue);
+        }
+    }
+    MainMemoryPrint(&context->memory, context->files.MemOut); // Print the contents of the main memory
+    if (context->files.DramStats != NULL){
+        MainMemoryPrintStats(&context->memory, context->files.DramStats, context->bus.iteration_count);
+    }
+    TraceWriter_Stop(&context->tracer); // Write the rest of the traces
+    closeFiles(&context->files); // Close all files
+    MainMemoryFree(&context->memory);
+    Bus_Shutdown(&context->bus);
+    Directory_Free(&context->sharer_directory);
+    SampledSim_Free(context->samples);
+    context->samples = NULL;
+    freeCores(context);
+}
+
+int SimContext_RunWorkload(const SimConfig* config, char* argv[], int argc, const char* directory){
+    // The context is large, keep it off the stack of the calling thread
+    SimContext* context = malloc(sizeof(SimContext));
+    if (context == NULL){
+        return 1;
+    }
+    int status = SimContext_Init(context, config, argv, argc, directory);
+    if (status == 0){
+        SimContext_Run(context);
+        printf("Processor halted\n");
+        SimContext_Finish(context);
+    } else {
+        // Release what was opened and allocated before the failure, without writing outputs
+        CoreWorkers_Stop(&context->workers);
+        TraceWriter_Stop(&context->tracer);
+        closeFiles(&context->files);
+        MainMemoryFree(&context->memory);
+        Bus_Shutdown(&context->bus);
+        Directory_Free(&context->sharer_directory);
+        SampledSim_Free(context->samples);
+        freeCores(context);
+    }
+    free(context);
+    return status;
+}
@@ -0,0 +1,179 @@
+/*!
+******************************************************************************
+file SimThreads.c
+
+Thin portability layer over the host threads (Win32 or pthreads) and the 
+atomic operations used by the parallel parts of the simulator.
+*****************************************************************************/
+
+/* Includes */
+#include <stdlib.h>
+#include "../headers/SimThreads.h"
+#ifndef _MSC_VER
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/* Defines */
+#define BARRIER_SPINS_BEFORE_YIELD 1024
+
+/* Types */
+typedef struct {
+    SimThread_Entry entry;
+    void* arg;
+} thread_start_info;
+
+/* Static Functions */
+#ifdef _MSC_VER
+static DWORD WINAPI thread_trampoline(LPVOID info);
+#else
+static void* thread_trampoline(void* info);
+#endif
+
+/* Functions implementations */
+#ifdef _MSC_VER
+static DWORD WINAPI thread_trampoline(LPVOID info)
+#else
+static void* thread_trampoline(void* info)
+#endif
+{
+    // Call the entry function of the thread with its argument
+    thread_start_info start = *(thread_start_info*)info;
+    free(info);
+    start.entry(start.arg);
+    return 0;
+}
+
+
+bool SimThread_Create(SimThread* thread, SimThread_Entry entry, void* arg) {
+    thread_start_info* info = malloc(sizeof(thread_start_info));
+    if (info == NULL) {
+        return false;
+    }
+    info->entry = entry;
+    info->arg = arg;
+#ifdef _MSC_VER
+    *thread = CreateThread(NULL, 0, thread_trampoline, info, 0, NULL);
+    if (*thread == NULL) {
+        free(info);
+        return false;
+    }
+#else
+    if (pthread_create(thread, NULL, thread_trampoline, info) != 0) {
+        free(info);
+        return false;
+    }
+#endif
+    return true;
+}
+
+
+void SimThread_Join(SimThread thread) {
+#ifdef _MSC_VER
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+
+void SimThread_Yield(void) {
+#ifdef _MSC_VER
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+
+void SimThread_Sleep(uint32_t milliseconds) {
+#ifdef _MSC_VER
+    Sleep(milliseconds);
+#else
+    struct timespec duration = { .tv_sec = milliseconds / 1000, .tv_nsec = (long)(milliseconds % 1000) * 1000000L };
+    nanosleep(&duration, NULL);
+#endif
+}
+
+
+int SimThread_HardwareConcurrency(void) {
+    // Number of logical processors of the host
+#ifdef _MSC_VER
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+
+int SimAtomic_Load(SimAtomic* value) {
+#ifdef _MSC_VER
+    return InterlockedCompareExchange(value, 0, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+
+void SimAtomic_Store(SimAtomic* value, int new_value) {
+#ifdef _MSC_VER
+    InterlockedExchange(value, new_value);
+#else
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+#endif
+}
+
+
+int SimAtomic_Increment(SimAtomic* value) {
+#ifdef _MSC_VER
+    return InterlockedIncrement(value);
+#else
+    return __atomic_add_fetch(value, 1, __ATOMIC_ACQ_REL);
+#endif
+}
+
+
+void SimAtomic_SetBits(SimAtomicBits* value, uint64_t bits) {
+#ifdef _MSC_VER
+    InterlockedOr64(value, (LONG64)bits);
+#else
+    __atomic_fetch_or(value, bits, __ATOMIC_RELAXED);
+#endif
+}
+
+
+void SimAtomic_ClearBits(SimAtomicBits* value, uint64_t bits) {
+#ifdef _MSC_VER
+    InterlockedAnd64(value, (LONG64)~bits);
+#else
+    __atomic_fetch_and(value, ~bits, __ATOMIC_RELAXED);
+#endif
+}
+
+
+void SimBarrier_Init(SimBarrier* barrier, int parties) {
+    barrier->arrived = 0;
+    barrier->generation = 0;
+    barrier->parties = parties;
+}
+
+
+void SimBarrier_Wait(SimBarrier* barrier) {
+    // The last thread to arrive opens the barrier by moving to the next generation
+    int generation = SimAtomic_Load(&barrier->generation);
+    if (SimAtomic_Increment(&barrier->arrived) == barrier->parties) {
+        SimAtomic_Store(&barrier->arrived, 0);
+        SimAtomic_Increment(&barrier->generation);
+        return;
+    }
+    for (uint32_t spins = 0; SimAtomic_Load(&barrier->generation) == generation; spins++) {
+        if (spins >= BARRIER_SPINS_BEFORE_YIELD) {
+            SimThread_Yield(); // Don't starve the other threads when the host is oversubscribed
+        }
+    }
+}
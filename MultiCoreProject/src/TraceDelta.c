@@ -0,0 +1,278 @@
+/*!
+******************************************************************************
+file TraceDelta.c
+
+Delta encoding of the core traces.
+
+Consecutive lines of a core trace are almost the same: the instructions move 
+one stage down the pipeline and few registers change. Each record is therefore 
+stored as the changes from the previous one:
+
+  uint16 header   - 2 bits per stage: same PC, PC of the previous stage in the 
+                    previous cycle (fetch: previous fetch PC + 1), no 
+                    instruction, or an explicit PC. Flags for a keyframe and for 
+                    an explicit cycle (when it is not the previous cycle + 1).
+  uint16 reg mask - One bit per changed register.
+  uint32 cycle    - Only with the explicit cycle flag.
+  uint16 pc       - For each stage with an explicit PC.
+  uint32 value    - For each changed register.
+
+Every TRACE_DELTA_KEYFRAME_INTERVAL records a keyframe holds the full record, 
+and the offsets of the keyframes are written in an index at the end of the 
+file, so a cycle is reached by decoding at most one interval.
+*****************************************************************************/
+
+/* Includes */
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../headers/TraceDelta.h"
+
+/* Defines */
+#define STAGE_SAME     0 // Same PC as in the previous cycle
+#define STAGE_SHIFT    1 // PC of the previous stage in the previous cycle, previous PC + 1 for fetch
+#define STAGE_NONE     2 // No instruction in the stage
+#define STAGE_EXPLICIT 3 // The PC follows
+#define HEADER_STAGE_BITS 2
+#define HEADER_STAGE_MASK 0x3
+#define HEADER_KEYFRAME       (1 << 10)
+#define HEADER_EXPLICIT_CYCLE (1 << 11)
+#define MAX_ENCODED_RECORD (2 + 2 + 4 + TRACE_NUM_OF_STAGES * 2 + TRACE_NUM_OF_REGS * 4)
+
+/* Static Functions */
+static uint16_t shifted_pc(const Core_Trace_Record* previous, int stage);
+static int put_u16(uint8_t* buffer, int length, uint16_t value);
+static int put_u32(uint8_t* buffer, int length, uint32_t value);
+static bool read_u16(FILE* input, uint64_t* position, uint16_t* value);
+static bool read_u32(FILE* input, uint64_t* position, uint32_t* value);
+static bool read_trailer(FILE* input, Trace_Delta_Trailer* trailer);
+static uint64_t find_keyframe(FILE* input, const Trace_Delta_Trailer* trailer, uint32_t cycle);
+static bool decode_record(FILE* input, uint64_t* position, Core_Trace_Record* record);
+
+/* Functions implementations */
+static uint16_t shifted_pc(const Core_Trace_Record* previous, int stage) {
+    // The PC a stage holds when the pipeline advances without a stall
+    return (stage == 0) ? (uint16_t)(previous->stage_pc[0] + 1) : previous->stage_pc[stage - 1];
+}
+
+
+static int put_u16(uint8_t* buffer, int length, uint16_t value) {
+    memcpy(buffer + length, &value, sizeof(value));
+    return length + (int)sizeof(value);
+}
+
+
+static int put_u32(uint8_t* buffer, int length, uint32_t value) {
+    memcpy(buffer + length, &value, sizeof(value));
+    return length + (int)sizeof(value);
+}
+
+
+void TraceDelta_Init(Trace_Delta_Encoder* encoder) {
+    memset(encoder, 0, sizeof(Trace_Delta_Encoder));
+    encoder->offset = sizeof(Trace_File_Header);
+}
+
+
+bool TraceDelta_Encode(Trace_Delta_Encoder* encoder, FILE* file, const Core_Trace_Record* record) {
+    uint8_t buffer[MAX_ENCODED_RECORD];
+    int length = 0;
+    const Core_Trace_Record* previous = &encoder->previous;
+
+    if (encoder->records % TRACE_DELTA_KEYFRAME_INTERVAL == 0) {
+        // Keyframe, remembered in the index
+        if (encoder->num_keyframes == encoder->index_capacity) {
+            uint32_t capacity = (encoder->index_capacity == 0) ? 64 : encoder->index_capacity * 2;
+            Trace_Keyframe* grown = realloc(encoder->index, capacity * sizeof(Trace_Keyframe));
+            if (grown != NULL) {
+                encoder->index = grown;
+                encoder->index_capacity = capacity;
+            }
+        }
+        if (encoder->num_keyframes < encoder->index_capacity) {
+            Trace_Keyframe keyframe = { .cycle = record->cycle, .reserved = 0, .offset = encoder->offset };
+            encoder->index[encoder->num_keyframes++] = keyframe;
+        }
+        length = put_u16(buffer, length, HEADER_KEYFRAME);
+        length = put_u32(buffer, length, record->cycle);
+        for (int stage = 0; stage < TRACE_NUM_OF_STAGES; stage++) {
+            length = put_u16(buffer, length, record->stage_pc[stage]);
+        }
+        for (int i = 0; i < TRACE_NUM_OF_REGS; i++) {
+            length = put_u32(buffer, length, record->regs[i]);
+        }
+    } else {
+        // Changes from the previous record
+        uint16_t header = (record->cycle != previous->cycle + 1) ? HEADER_EXPLICIT_CYCLE : 0;
+        uint16_t reg_mask = 0;
+        for (int stage = 0; stage < TRACE_NUM_OF_STAGES; stage++) {
+            uint16_t pc = record->stage_pc[stage];
+            uint16_t code = (pc == previous->stage_pc[stage]) ? STAGE_SAME :
+                            (pc == shifted_pc(previous, stage)) ? STAGE_SHIFT :
+                            (pc == TRACE_NO_PC) ? STAGE_NONE : STAGE_EXPLICIT;
+            header |= (uint16_t)(code << (stage * HEADER_STAGE_BITS));
+        }
+        for (int i = 0; i < TRACE_NUM_OF_REGS; i++) {
+            reg_mask |= (record->regs[i] != previous->regs[i]) ? (uint16_t)(1 << i) : 0;
+        }
+        length = put_u16(buffer, length, header);
+        length = put_u16(buffer, length, reg_mask);
+        if (header & HEADER_EXPLICIT_CYCLE) {
+            length = put_u32(buffer, length, record->cycle);
+        }
+        for (int stage = 0; stage < TRACE_NUM_OF_STAGES; stage++) {
+            if (((header >> (stage * HEADER_STAGE_BITS)) & HEADER_STAGE_MASK) == STAGE_EXPLICIT) {
+                length = put_u16(buffer, length, record->stage_pc[stage]);
+            }
+        }
+        for (int i = 0; i < TRACE_NUM_OF_REGS; i++) {
+            if (reg_mask & (1 << i)) {
+                length = put_u32(buffer, length, record->regs[i]);
+            }
+        }
+    }
+
+    encoder->previous = *record;
+    encoder->records++;
+    encoder->offset += (uint64_t)length;
+    return fwrite(buffer, 1, (size_t)length, file) == (size_t)length;
+}
+
+
+void TraceDelta_Finish(Trace_Delta_Encoder* encoder, FILE* file) {
+    // The index follows the records, and the trailer locates it from the end of the file
+    Trace_Delta_Trailer trailer;
+    trailer.index_offset = encoder->offset;
+    trailer.num_keyframes = encoder->num_keyframes;
+    trailer.interval = TRACE_DELTA_KEYFRAME_INTERVAL;
+    memcpy(trailer.magic, TRACE_DELTA_INDEX_MAGIC, TRACE_FILE_MAGIC_LENGTH);
+    fwrite(encoder->index, sizeof(Trace_Keyframe), encoder->num_keyframes, file);
+    fwrite(&trailer, sizeof(trailer), 1, file);
+    free(encoder->index);
+    encoder->index = NULL;
+    encoder->num_keyframes = 0;
+    encoder->index_capacity = 0;
+}
+
+
+static bool read_u16(FILE* input, uint64_t* position, uint16_t* value) {
+    *position += sizeof(*value);
+    return fread(value, sizeof(*value), 1, input) == 1;
+}
+
+
+static bool read_u32(FILE* input, uint64_t* position, uint32_t* value) {
+    *position += sizeof(*value);
+    return fread(value, sizeof(*value), 1, input) == 1;
+}
+
+
+static bool read_trailer(FILE* input, Trace_Delta_Trailer* trailer) {
+    // A trace that was not closed properly has no trailer
+    return TRACE_SEEK(input, -(long)sizeof(*trailer), SEEK_END) == 0 &&
+           fread(trailer, sizeof(*trailer), 1, input) == 1 &&
+           memcmp(trailer->magic, TRACE_DELTA_INDEX_MAGIC, TRACE_FILE_MAGIC_LENGTH) == 0;
+}
+
+
+static uint64_t find_keyframe(FILE* input, const Trace_Delta_Trailer* trailer, uint32_t cycle) {
+    // Binary search of the index for the last keyframe at or before the cycle
+    uint64_t offset = sizeof(Trace_File_Header);
+    uint32_t low = 0;
+    uint32_t high = trailer->num_keyframes;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        Trace_Keyframe keyframe;
+        if (TRACE_SEEK(input, (long long)(trailer->index_offset + (uint64_t)middle * sizeof(keyframe)), SEEK_SET) != 0 ||
+            fread(&keyframe, sizeof(keyframe), 1, input) != 1) {
+            break;
+        }
+        if (keyframe.cycle <= cycle) {
+            offset = keyframe.offset;
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return offset;
+}
+
+
+static bool decode_record(FILE* input, uint64_t* position, Core_Trace_Record* record) {
+    // Apply the next encoded record on top of the previous one
+    uint16_t header;
+    if (!read_u16(input, position, &header)) {
+        return false;
+    }
+    if (header & HEADER_KEYFRAME) {
+        bool complete = read_u32(input, position, &record->cycle);
+        for (int stage = 0; stage < TRACE_NUM_OF_STAGES; stage++) {
+            complete = complete && read_u16(input, position, &record->stage_pc[stage]);
+        }
+        for (int i = 0; i < TRACE_NUM_OF_REGS; i++) {
+            complete = complete && read_u32(input, position, &record->regs[i]);
+        }
+        return complete;
+    }
+
+    Core_Trace_Record previous = *record;
+    uint16_t reg_mask;
+    bool complete = read_u16(input, position, &reg_mask);
+    record->cycle = previous.cycle + 1;
+    if (header & HEADER_EXPLICIT_CYCLE) {
+        complete = complete && read_u32(input, position, &record->cycle);
+    }
+    for (int stage = 0; stage < TRACE_NUM_OF_STAGES; stage++) {
+        switch ((header >> (stage * HEADER_STAGE_BITS)) & HEADER_STAGE_MASK) {
+        case STAGE_SAME:
+            break;
+        case STAGE_SHIFT:
+            record->stage_pc[stage] = shifted_pc(&previous, stage);
+            break;
+        case STAGE_NONE:
+            record->stage_pc[stage] = TRACE_NO_PC;
+            break;
+        default:
+            complete = complete && read_u16(input, position, &record->stage_pc[stage]);
+            break;
+        }
+    }
+    for (int i = 0; i < TRACE_NUM_OF_REGS; i++) {
+        if (reg_mask & (1 << i)) {
+            complete = complete && read_u32(input, position, &record->regs[i]);
+        }
+    }
+    return complete;
+}
+
+
+uint32_t TraceDelta_Decode(FILE* input, FILE* output, uint32_t first_cycle, uint32_t last_cycle) {
+    // Locate the first keyframe to decode and the end of the records
+    uint64_t position = sizeof(Trace_File_Header);
+    uint64_t end = UINT64_MAX;
+    Trace_Delta_Trailer trailer;
+    if (read_trailer(input, &trailer)) {
+        end = trailer.index_offset;
+        position = find_keyframe(input, &trailer, first_cycle);
+    }
+    if (TRACE_SEEK(input, (long long)position, SEEK_SET) != 0) {
+        return 0;
+    }
+
+    uint32_t printed = 0;
+    Core_Trace_Record record;
+    memset(&record, 0, sizeof(record));
+    while (position < end && decode_record(input, &position, &record)) {
+        if (record.cycle > last_cycle) {
+            break;
+        }
+        if (record.cycle >= first_cycle) {
+            Trace_PrintCoreRecord(output, &record);
+            printed++;
+        }
+    }
+    return printed;
+}
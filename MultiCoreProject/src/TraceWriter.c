@@ -0,0 +1,475 @@
+/*!
+******************************************************************************
+file TraceWriter.c
+
+Output of the core and bus traces.
+
+In the text format the lines are formatted and written by the thread that runs 
+the core or the bus, as the assignment requires. In the binary format each 
+line becomes a fixed size record that is copied into a ring of its stream, and 
+a background thread writes the rings to the files. The simulation then never 
+waits for formatting or for the file system, unless a ring is full. 
+Trace_Decode turns a binary trace back into the exact text of the text format.
+*****************************************************************************/
+
+/* Includes */
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../headers/TraceWriter.h"
+#include "../headers/TraceDelta.h"
+
+/* Defines */
+#define TRACE_RING_RECORDS 4096 // Records per stream, a power of two
+#define TRACE_WRITER_IDLE_MS 1 // Sleep of the writer thread when all the rings are empty
+#define CORE_STATE_LENGTH (TRACE_NUM_OF_STAGES * 4 + TRACE_NUM_OF_REGS * 9 + 1)
+
+/* Static Functions */
+static bool init_stream(Trace_Stream* stream, FILE* file, Trace_Format format, Trace_Kind kind, Trace_Filter* filter, bool enabled);
+static void fire_trigger(Trace_Filter* filter, uint32_t cycle);
+static void free_stream(Trace_Stream* stream);
+static uint32_t ring_used(Trace_Stream* stream, uint32_t head, uint32_t tail);
+static void* reserve_record(Trace_Stream* stream);
+static void commit_record(Trace_Stream* stream);
+static uint32_t drain_stream(Trace_Stream* stream);
+static void writer_thread(void* arg);
+static void write_records(Trace_Stream* stream, const uint8_t* records, uint32_t count);
+static int format_core_state(char* line, const uint16_t* stage_pc, const uint32_t* regs);
+static bool read_trace_header(FILE* input, const char* inputPath, Trace_File_Header* header);
+static uint32_t query_fixed_records(FILE* input, FILE* output, uint32_t kind, uint32_t first_cycle, uint32_t last_cycle);
+
+/* Functions implementations */
+static bool init_stream(Trace_Stream* stream, FILE* file, Trace_Format format, Trace_Kind kind, Trace_Filter* filter, bool enabled) {
+    memset(stream, 0, sizeof(Trace_Stream));
+    stream->file = file;
+    stream->filter = filter;
+    stream->enabled = enabled && file != NULL;
+    stream->format = format;
+    stream->kind = kind;
+    stream->record_size = (kind == TRACE_KIND_CORE) ? sizeof(Core_Trace_Record) : sizeof(Bus_Trace_Record);
+    if (format == TRACE_FORMAT_TEXT || file == NULL) {
+        return true;
+    }
+
+    stream->capacity = TRACE_RING_RECORDS;
+    stream->ring = malloc((size_t)stream->capacity * stream->record_size);
+    if (stream->ring == NULL) {
+        return false;
+    }
+    if (format == TRACE_FORMAT_DELTA && kind == TRACE_KIND_CORE) {
+        // The ring still holds full records, the writer thread encodes them
+        stream->delta = malloc(sizeof(Trace_Delta_Encoder));
+        if (stream->delta == NULL) {
+            return false;
+        }
+        TraceDelta_Init(stream->delta);
+    }
+    Trace_File_Header header;
+    memcpy(header.magic, TRACE_FILE_MAGIC, TRACE_FILE_MAGIC_LENGTH);
+    header.version = TRACE_FILE_VERSION;
+    header.kind = (stream->delta != NULL) ? (uint32_t)TRACE_KIND_CORE_DELTA : (uint32_t)kind;
+    return fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+
+static void free_stream(Trace_Stream* stream) {
+    if (stream->delta != NULL) {
+        TraceDelta_Finish(stream->delta, stream->file);
+        free(stream->delta);
+        stream->delta = NULL;
+    }
+    free(stream->ring);
+    stream->ring = NULL;
+}
+
+
+static uint32_t ring_used(Trace_Stream* stream, uint32_t head, uint32_t tail) {
+    // The positions run modulo twice the capacity, so a full ring differs from an empty one
+    return (head + 2 * stream->capacity - tail) % (2 * stream->capacity);
+}
+
+
+static void* reserve_record(Trace_Stream* stream) {
+    // Wait for a free slot, the writer thread frees them as it writes the records
+    uint32_t head = (uint32_t)SimAtomic_Load(&stream->head);
+    while (ring_used(stream, head, (uint32_t)SimAtomic_Load(&stream->tail)) == stream->capacity) {
+        if (stream->has_writer) {
+            SimThread_Yield();
+        } else {
+            drain_stream(stream);
+        }
+    }
+    return stream->ring + (size_t)(head % stream->capacity) * stream->record_size;
+}
+
+
+static void commit_record(Trace_Stream* stream) {
+    // Publish the record to the writer thread
+    uint32_t head = (uint32_t)SimAtomic_Load(&stream->head);
+    SimAtomic_Store(&stream->head, (int)((head + 1) % (2 * stream->capacity)));
+}
+
+
+static uint32_t drain_stream(Trace_Stream* stream) {
+    // Write all the published records, in at most two chunks as the ring wraps around
+    if (stream->ring == NULL) {
+        return 0;
+    }
+    uint32_t tail = (uint32_t)SimAtomic_Load(&stream->tail);
+    uint32_t used = ring_used(stream, (uint32_t)SimAtomic_Load(&stream->head), tail);
+    if (used == 0) {
+        return 0;
+    }
+    uint32_t index = tail % stream->capacity;
+    uint32_t first_chunk = (used < stream->capacity - index) ? used : stream->capacity - index;
+    write_records(stream, stream->ring + (size_t)index * stream->record_size, first_chunk);
+    if (used > first_chunk) {
+        write_records(stream, stream->ring, used - first_chunk);
+    }
+    SimAtomic_Store(&stream->tail, (int)((tail + used) % (2 * stream->capacity)));
+    return used;
+}
+
+
+static void write_records(Trace_Stream* stream, const uint8_t* records, uint32_t count) {
+    // Write consecutive records of the ring, as they are or delta encoded
+    if (stream->delta == NULL) {
+        fwrite(records, stream->record_size, count, stream->file);
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        TraceDelta_Encode(stream->delta, stream->file, (const Core_Trace_Record*)(records + (size_t)i * stream->record_size));
+    }
+}
+
+
+static void writer_thread(void* arg) {
+    // Write the rings until the simulation stops and nothing is left to write
+    Trace_Writer* writer = (Trace_Writer*)arg;
+    for (;;) {
+        bool stopping = SimAtomic_Load(&writer->stop) != 0; // Read before draining, so no record is left behind
+        uint32_t written = 0;
+        for (uint32_t i = 0; i <= writer->num_of_cores; i++) {
+            written += drain_stream(&writer->streams[i]);
+        }
+        if (written == 0) {
+            if (stopping) {
+                break;
+            }
+            SimThread_Sleep(TRACE_WRITER_IDLE_MS);
+        }
+    }
+}
+
+
+void Trace_DefaultOptions(Trace_Options* options) {
+    memset(options, 0, sizeof(Trace_Options));
+    options->start_cycle = 0;
+    options->stop_cycle = UINT32_MAX;
+    options->core_mask = UINT64_MAX;
+    options->bus_enabled = true;
+    options->sample_period = 1;
+}
+
+
+bool TraceWriter_Start(Trace_Writer* writer, Trace_Format format, const Trace_Options* options, FILE** core_files, uint32_t num_of_cores, FILE* bus_file) {
+    memset(writer, 0, sizeof(Trace_Writer));
+    writer->num_of_cores = num_of_cores;
+    writer->filter.options = *options;
+    writer->filter.options.sample_period = (options->sample_period == 0) ? 1 : options->sample_period;
+    writer->filter.has_trigger = options->has_trigger_pc || options->has_trigger_addr;
+    writer->streams = calloc(num_of_cores + 1, sizeof(Trace_Stream));
+    if (writer->streams == NULL) {
+        return false;
+    }
+    bool initialized = true;
+    for (uint32_t i = 0; i < num_of_cores; i++) {
+        bool enabled = i < 64 && ((options->core_mask >> i) & 1);
+        initialized &= init_stream(&writer->streams[i], core_files[i], format, TRACE_KIND_CORE, &writer->filter, enabled);
+    }
+    initialized &= init_stream(&writer->streams[num_of_cores], bus_file, format, TRACE_KIND_BUS, &writer->filter, options->bus_enabled);
+    if (!initialized) {
+        printf("Error: Failed to initialize the trace streams.\n");
+        TraceWriter_Stop(writer);
+        return false;
+    }
+
+    if (format != TRACE_FORMAT_TEXT) {
+        writer->thread_started = SimThread_Create(&writer->thread, writer_thread, writer);
+        if (!writer->thread_started) {
+            printf("Warning: Failed to start the trace writer thread, writing the traces on the simulation threads\n");
+        }
+        for (uint32_t i = 0; i <= num_of_cores; i++) {
+            writer->streams[i].has_writer = writer->thread_started;
+        }
+    }
+    return true;
+}
+
+
+void TraceWriter_Stop(Trace_Writer* writer) {
+    if (writer->streams == NULL) {
+        return;
+    }
+    if (writer->thread_started) {
+        SimAtomic_Store(&writer->stop, 1);
+        SimThread_Join(writer->thread);
+        writer->thread_started = false;
+    }
+    for (uint32_t i = 0; i <= writer->num_of_cores; i++) {
+        drain_stream(&writer->streams[i]);
+        free_stream(&writer->streams[i]);
+    }
+    free(writer->streams);
+    writer->streams = NULL;
+}
+
+
+Trace_Stream* TraceWriter_CoreStream(Trace_Writer* writer, uint32_t core) {
+    return &writer->streams[core];
+}
+
+
+Trace_Stream* TraceWriter_BusStream(Trace_Writer* writer) {
+    return &writer->streams[writer->num_of_cores];
+}
+
+
+bool Trace_IsCycleTraced(Trace_Stream* stream, uint32_t cycle) {
+    if (!stream->enabled) {
+        return false;
+    }
+    Trace_Filter* filter = stream->filter;
+    if (cycle < filter->options.start_cycle || cycle > filter->options.stop_cycle ||
+        (filter->options.sample_period > 1 && cycle % filter->options.sample_period != 0)) {
+        return false;
+    }
+    if (filter->has_trigger) {
+        // A trigger fired in this cycle takes effect in the next one, whichever thread fired it
+        uint32_t triggered = (uint32_t)SimAtomic_Load(&filter->triggered);
+        return triggered != 0 && triggered - 1 < cycle;
+    }
+    return true;
+}
+
+
+static void fire_trigger(Trace_Filter* filter, uint32_t cycle) {
+    // Only the first trigger counts. The cores that fire in the same cycle store the same value.
+    if (SimAtomic_Load(&filter->triggered) == 0) {
+        SimAtomic_Store(&filter->triggered, (int)(cycle + 1));
+    }
+}
+
+
+void Trace_CheckPcTrigger(Trace_Stream* stream, uint32_t cycle, uint16_t fetch_pc) {
+    Trace_Filter* filter = stream->filter;
+    if (filter->options.has_trigger_pc && fetch_pc == filter->options.trigger_pc) {
+        fire_trigger(filter, cycle);
+    }
+}
+
+
+void Trace_CheckAddressTrigger(Trace_Stream* stream, uint32_t cycle, uint32_t bus_addr) {
+    Trace_Filter* filter = stream->filter;
+    if (filter->options.has_trigger_addr && bus_addr == filter->options.trigger_addr) {
+        fire_trigger(filter, cycle);
+    }
+}
+
+
+static int format_core_state(char* line, const uint16_t* stage_pc, const uint32_t* regs) {
+    // The part of a core trace line that follows the cycle: the stage PCs and the registers
+    int length = 0;
+    for (int stage = 0; stage < TRACE_NUM_OF_STAGES; stage++) {
+        length += (stage_pc[stage] == TRACE_NO_PC) ? sprintf(line + length, "--- ") : sprintf(line + length, "%03X ", stage_pc[stage]);
+    }
+    for (int i = 0; i < TRACE_NUM_OF_REGS; i++) {
+        length += sprintf(line + length, "%08X ", regs[i]);
+    }
+    return length;
+}
+
+
+void Trace_PrintCoreRecord(FILE* file, const Core_Trace_Record* record) {
+    char state[CORE_STATE_LENGTH];
+    format_core_state(state, record->stage_pc, record->regs);
+    fprintf(file, "%d %s\n", (int)record->cycle, state);
+}
+
+
+void Trace_PrintBusRecord(FILE* file, const Bus_Trace_Record* record) {
+    fprintf(file, "%d %d %d %05X %08X %d\n", (int)record->cycle, record->origid, record->bus_cmd,
+        record->bus_addr, record->bus_data, record->bus_shared);
+}
+
+
+void Trace_WriteCore(Trace_Stream* stream, uint32_t cycle, const uint16_t* stage_pc, const uint32_t* regs) {
+    Trace_WriteCoreRepeated(stream, cycle, 1, stage_pc, regs);
+}
+
+
+void Trace_WriteCoreRepeated(Trace_Stream* stream, uint32_t first_cycle, uint32_t count, const uint16_t* stage_pc, const uint32_t* regs) {
+    if (!stream->enabled) {
+        return;
+    }
+    if (stream->format == TRACE_FORMAT_TEXT) {
+        // The lines differ only by the cycle number, so the state is formatted once
+        char state[CORE_STATE_LENGTH];
+        bool formatted = false;
+        for (uint32_t i = 0; i < count; i++) {
+            if (!Trace_IsCycleTraced(stream, first_cycle + i)) {
+                continue;
+            }
+            if (!formatted) {
+                format_core_state(state, stage_pc, regs);
+                formatted = true;
+            }
+            fprintf(stream->file, "%d %s\n", (int)(first_cycle + i), state);
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!Trace_IsCycleTraced(stream, first_cycle + i)) {
+            continue;
+        }
+        Core_Trace_Record* record = reserve_record(stream);
+        record->cycle = first_cycle + i;
+        memcpy(record->stage_pc, stage_pc, sizeof(record->stage_pc));
+        record->reserved = 0;
+        memcpy(record->regs, regs, sizeof(record->regs));
+        commit_record(stream);
+    }
+}
+
+
+void Trace_WriteBus(Trace_Stream* stream, uint32_t cycle, uint32_t origid, uint32_t bus_cmd, uint32_t bus_addr, uint32_t bus_data, bool bus_shared) {
+    Trace_CheckAddressTrigger(stream, cycle, bus_addr);
+    if (!Trace_IsCycleTraced(stream, cycle)) {
+        return;
+    }
+    Bus_Trace_Record local_record;
+    Bus_Trace_Record* record = (stream->format == TRACE_FORMAT_TEXT) ? &local_record : reserve_record(stream);
+    record->cycle = cycle;
+    record->origid = (uint16_t)origid;
+    record->bus_cmd = (uint8_t)bus_cmd;
+    record->bus_shared = bus_shared ? 1 : 0;
+    record->bus_addr = bus_addr;
+    record->bus_data = bus_data;
+    if (stream->format == TRACE_FORMAT_TEXT) {
+        Trace_PrintBusRecord(stream->file, record);
+    } else {
+        commit_record(stream);
+    }
+}
+
+
+static bool read_trace_header(FILE* input, const char* inputPath, Trace_File_Header* header) {
+    if (fread(header, sizeof(*header), 1, input) != 1 || memcmp(header->magic, TRACE_FILE_MAGIC, TRACE_FILE_MAGIC_LENGTH) != 0 ||
+        header->version != TRACE_FILE_VERSION || header->kind > TRACE_KIND_CORE_DELTA) {
+        printf("Error: %s is not a binary trace.\n", inputPath);
+        return false;
+    }
+    return true;
+}
+
+
+static uint32_t query_fixed_records(FILE* input, FILE* output, uint32_t kind, uint32_t first_cycle, uint32_t last_cycle) {
+    // The cycles of the records only grow, so the first record of the window is found by a binary search
+    size_t record_size = (kind == TRACE_KIND_CORE) ? sizeof(Core_Trace_Record) : sizeof(Bus_Trace_Record);
+    if (TRACE_SEEK(input, 0, SEEK_END) != 0) {
+        return 0;
+    }
+    uint64_t num_records = ((uint64_t)TRACE_TELL(input) - sizeof(Trace_File_Header)) / record_size;
+    uint64_t low = 0;
+    uint64_t high = num_records;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        uint32_t cycle = 0; // The cycle is the first field of both records
+        if (TRACE_SEEK(input, (long long)(sizeof(Trace_File_Header) + middle * record_size), SEEK_SET) != 0 ||
+            fread(&cycle, sizeof(cycle), 1, input) != 1) {
+            return 0;
+        }
+        if (cycle < first_cycle) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    uint32_t printed = 0;
+    if (TRACE_SEEK(input, (long long)(sizeof(Trace_File_Header) + low * record_size), SEEK_SET) != 0) {
+        return 0;
+    }
+    Core_Trace_Record core_record;
+    Bus_Trace_Record bus_record;
+    void* record = (kind == TRACE_KIND_CORE) ? (void*)&core_record : (void*)&bus_record;
+    while (fread(record, record_size, 1, input) == 1 && *(uint32_t*)record <= last_cycle) {
+        if (kind == TRACE_KIND_CORE) {
+            Trace_PrintCoreRecord(output, &core_record);
+        } else {
+            Trace_PrintBusRecord(output, &bus_record);
+        }
+        printed++;
+    }
+    return printed;
+}
+
+
+int Trace_Decode(const char* inputPath, const char* outputPath) {
+    FILE* input = fopen(inputPath, "rb");
+    if (input == NULL) {
+        printf("Error: Failed to open %s.\n", inputPath);
+        return 1;
+    }
+    Trace_File_Header header;
+    if (!read_trace_header(input, inputPath, &header)) {
+        fclose(input);
+        return 1;
+    }
+    FILE* output = fopen(outputPath, "w");
+    if (output == NULL) {
+        printf("Error: Failed to open %s.\n", outputPath);
+        fclose(input);
+        return 1;
+    }
+
+    uint32_t records = 0;
+    if (header.kind == TRACE_KIND_CORE_DELTA) {
+        records = TraceDelta_Decode(input, output, 0, UINT32_MAX);
+    } else if (header.kind == TRACE_KIND_CORE) {
+        Core_Trace_Record record;
+        for (; fread(&record, sizeof(record), 1, input) == 1; records++) {
+            Trace_PrintCoreRecord(output, &record);
+        }
+    } else {
+        Bus_Trace_Record record;
+        for (; fread(&record, sizeof(record), 1, input) == 1; records++) {
+            Trace_PrintBusRecord(output, &record);
+        }
+    }
+    fclose(input);
+    bool written = fclose(output) == 0;
+    printf("Decoded %u %s trace records from %s to %s.\n", records, header.kind == TRACE_KIND_BUS ? "bus" : "core", inputPath, outputPath);
+    return written ? 0 : 1;
+}
+
+
+int Trace_Query(const char* inputPath, uint32_t first_cycle, uint32_t last_cycle, FILE* output) {
+    FILE* input = fopen(inputPath, "rb");
+    if (input == NULL) {
+        printf("Error: Failed to open %s.\n", inputPath);
+        return 1;
+    }
+    Trace_File_Header header;
+    if (!read_trace_header(input, inputPath, &header)) {
+        fclose(input);
+        return 1;
+    }
+    uint32_t printed = (header.kind == TRACE_KIND_CORE_DELTA) ? TraceDelta_Decode(input, output, first_cycle, last_cycle)
+                                                               : query_fixed_records(input, output, header.kind, first_cycle, last_cycle);
+    fclose(input);
+    return (printed > 0) ? 0 : 1;
+}
@@ -7,72 +7,57 @@ entire simulation by initializing, coordinating, and managing interactions
 between the various components, including cores, memory, caches, and the bus.
 
 Handles high-level tasks such as:
-- Opening and managing required files.
-- Initializing components (cores, memory, caches, and the bus).
-- Running the simulation loop.
-- Finalizing and printing results to output files.
+- Parsing the options of the simulation.
+- Running a single simulation with the given files (see SimContext).
+- Running a batch of workloads in one process (see BatchRunner).
+- Converting memory images between the hex text and binary formats (see MemImage).
+- Decoding binary traces back to the text format, or a window of cycles (see TraceWriter).
 *****************************************************************************/
 
 /* includes */
-#include "./MultiCoreProject/headers/FilesManager.h"
-#include "./MultiCoreProject/headers/ProcessorCore.h"
-#include "./MultiCoreProject/headers/MainMemory.h"
-#include "./MultiCoreProject/headers/BusController.h"
-#include <string.h>
+#include "./MultiCoreProject/headers/SimConfig.h"
+#include "./MultiCoreProject/headers/SimContext.h"
+#include "./MultiCoreProject/headers/BatchRunner.h"
+#include "./MultiCoreProject/headers/MemImage.h"
+#include "./MultiCoreProject/headers/TraceWriter.h"
+#include <stdio.h>
 
-/* Global Variables */
-ProcessorCore cores[NUM_OF_CORES]; // Array of cores
-
-/* static functions */
-static void initCores(); // Initialize all cores
-static bool isProcessorHalted(); // Check if all cores are halted
-
-/* Functions */
-static void initCores(){
-    // Initialize all cores
-    memset(cores, 0, sizeof(ProcessorCore) * NUM_OF_CORES);
-    for (int i = 0; i < NUM_OF_CORES; i++){
-        cores[i].fileHandles = coreFileHandlesArray[i]; // Assign the file handles
-        ProcessorCore_Init(&cores[i], i); // Initialize the core
-    }
-}
-
-static bool isProcessorHalted(){
-    // Check if all cores are halted
-    bool allHalted = true;
-    for (int i = 0; i < NUM_OF_CORES; i++){
-        if (!core_is_halted(&cores[i])){
-            allHalted = false;
-        }
-    } 
-    return allHalted;
-}
 /* MAIN FUNCTION */
 int main(int argc, char* argv[]){
-    // open all required files
-    if(OpenRequiredFiles(argv, argc) != 0){
-        printf("Error opening files\n");
+    // parse the options given before the file arguments
+    SimConfig config;
+    SimConfig_Default(&config);
+    if(ParseSimOptions(&config, &argc, argv) != 0){
         return 1;
     }
 
-    // Main Memory Initialization
-    MainMemoryInit();
-    // Core Initialization
-    initCores();
-
-    while (!isProcessorHalted()){
-        // Run a single cycle for each core
-        Run_Bus_Iteration();
-        for (int i = 0; i < NUM_OF_CORES; i++){
-            core_run_single_cycle(&cores[i]);
+    if (config.convert){
+        // sim --convert <input image> <output image>
+        if (argc != 3){
+            printf("Usage: %s --convert <input image> <output image>\n", argv[0]);
+            return 1;
+        }
+        return MemImage_Convert(argv[1], argv[2]);
+    }
+    if (config.decode_trace){
+        // sim --decode-trace <binary trace> <text trace>
+        if (argc != 3){
+            printf("Usage: %s --decode-trace <binary trace> <text trace>\n", argv[0]);
+            return 1;
         }
+        return Trace_Decode(argv[1], argv[2]);
     }
-    printf("Processor halted\n");
-    for (int i = 0; i < NUM_OF_CORES; i++){
-        // Shutdown each core
-        Core_Shutdown(&cores[i]);
+    if (config.query_trace){
+        // sim --query-trace=N[:M] <binary trace>
+        if (argc != 2){
+            printf("Usage: %s --query-trace=<cycle>[:<last cycle>] <binary trace>\n", argv[0]);
+            return 1;
+        }
+        return Trace_Query(argv[1], config.query_first_cycle, config.query_last_cycle, stdout);
+    }
+    if (config.batch_file != NULL){
+        // Every workload of the list runs in its own context
+        return (BatchRunner_Run(&config) == 0) ? 0 : 1;
     }
-    MainMemoryPrint(MemOut); // Print the contents of the main memory
-    closeFiles(); // Close all files
-    return 0;
-}
\ No newline at end of file
+    return SimContext_RunWorkload(&config, argv, argc, NULL);
+}